@@ -0,0 +1,288 @@
+#include "BenchUtil.h"
+#include "VideoEncoder.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QHash>
+#include <QImage>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#include <cerrno>
+#include <cstdlib>
+
+// 替换 malloc 系列函数以统计分配 (FFmpeg 的 av_malloc 使用 posix_memalign)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+std::atomic<uint64_t> g_allocCount{0};
+std::atomic<uint64_t> g_allocBytes{0};
+
+inline void recordAlloc(size_t size)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+}
+} // namespace
+
+extern "C" {
+void *malloc(size_t size)
+{
+    recordAlloc(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    recordAlloc(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    recordAlloc(size);
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    recordAlloc(size);
+    void *ptr = __libc_memalign(alignment, size);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    recordAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    recordAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+}
+#endif
+
+namespace Bench {
+
+const Resolution kResolutions[3] = {
+    { "480p", 854, 480 },
+    { "1080p", 1920, 1080 },
+    { "4K", 3840, 2160 },
+};
+
+int frameCountFor(const Resolution &resolution)
+{
+    return resolution.height >= 2160 ? 30 : (resolution.height >= 1080 ? 100 : 300);
+}
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool allocTrackingAvailable()
+{
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocStats allocStats()
+{
+#if defined(__GLIBC__)
+    return AllocStats{ g_allocCount.load(std::memory_order_relaxed), g_allocBytes.load(std::memory_order_relaxed) };
+#else
+    return AllocStats{ 0, 0 };
+#endif
+}
+
+int64_t peakRssBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return (int64_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return (int64_t)usage.ru_maxrss;            // macOS 单位为字节
+#else
+    return (int64_t)usage.ru_maxrss * 1024;     // Linux 单位为KB
+#endif
+#endif
+}
+
+Measure::Measure()
+    : m_startNs(nowNs())
+    , m_startAllocs(allocStats())
+{
+}
+
+Result Measure::finish(const QString &name, const QString &resolution, int64_t iterations) const
+{
+    AllocStats end = allocStats();
+    Result result;
+    result.name = name;
+    result.resolution = resolution;
+    result.iterations = iterations;
+    result.elapsedNs = nowNs() - m_startNs;
+    result.allocs.count = end.count - m_startAllocs.count;
+    result.allocs.bytes = end.bytes - m_startAllocs.bytes;
+    result.peakRss = peakRssBytes();
+    return result;
+}
+
+void printHeader()
+{
+    printf("%-32s %-7s %8s %12s %10s %12s %14s %12s\n",
+           "benchmark", "res", "frames", "ns/frame", "fps", "allocs/frame", "bytes/frame", "peakRSS(MB)");
+}
+
+void printResult(const Result &result)
+{
+    double iterations = result.iterations > 0 ? (double)result.iterations : 1.0;
+    double nsPerFrame = result.elapsedNs / iterations;
+    double fps = nsPerFrame > 0 ? 1e9 / nsPerFrame : 0.0;
+    double peakRssMb = result.peakRss / (1024.0 * 1024.0);
+    
+    if (allocTrackingAvailable()) {
+        printf("%-32s %-7s %8lld %12.0f %10.1f %12.2f %14.0f %12.1f\n",
+               result.name.toUtf8().constData(), result.resolution.toUtf8().constData(),
+               (long long)result.iterations, nsPerFrame, fps,
+               result.allocs.count / iterations, result.allocs.bytes / iterations, peakRssMb);
+    } else {
+        printf("%-32s %-7s %8lld %12.0f %10.1f %12s %14s %12.1f\n",
+               result.name.toUtf8().constData(), result.resolution.toUtf8().constData(),
+               (long long)result.iterations, nsPerFrame, fps, "n/a", "n/a", peakRssMb);
+    }
+    fflush(stdout);
+}
+
+AVFrame *makeTestFrame(int width, int height, int index)
+{
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < width; x++) {
+            row[x] = (uint8_t)(x + y + index * 3);
+        }
+    }
+    for (int y = 0; y < height / 2; y++) {
+        uint8_t *u = frame->data[1] + y * frame->linesize[1];
+        uint8_t *v = frame->data[2] + y * frame->linesize[2];
+        for (int x = 0; x < width / 2; x++) {
+            u[x] = (uint8_t)(128 + y + index * 2);
+            v[x] = (uint8_t)(64 + x + index * 5);
+        }
+    }
+    
+    return frame;
+}
+
+QString workDir()
+{
+    static const QString path = QString("%1/videoeditor_bench_%2")
+        .arg(QDir::tempPath())
+        .arg(QCoreApplication::applicationPid());
+    QDir().mkpath(path);
+    return path;
+}
+
+QString testClip(const Resolution &resolution)
+{
+    static QHash<QString, QString> clips;
+    if (clips.contains(resolution.name)) {
+        return clips.value(resolution.name);
+    }
+    
+    // 生成过程不计入测量: 渐变图案逐帧移动，码率约为每像素3比特
+    QString path = QString("%1/clip_%2.mp4").arg(workDir()).arg(resolution.name);
+    EncodeProfile profile = EncodeProfile::forKind(EncodeProfile::Throughput);
+    profile.rateControl = EncodeProfile::Vbr;
+    VideoEncoder encoder;
+    encoder.setProfile(profile);
+    if (!encoder.open(path, resolution.width, resolution.height, 25.0,
+                      (int64_t)resolution.width * resolution.height * 3)) {
+        return QString();
+    }
+    
+    const int frames = frameCountFor(resolution);
+    for (int i = 0; i < frames; i++) {
+        AVFrame *frame = makeTestFrame(resolution.width, resolution.height, i);
+        bool ok = frame && encoder.encodeFrame(frame);
+        av_frame_free(&frame);
+        if (!ok) {
+            encoder.close();
+            return QString();
+        }
+    }
+    
+    bool ok = encoder.finalize();
+    encoder.close();
+    if (!ok) {
+        return QString();
+    }
+    
+    clips.insert(resolution.name, path);
+    return path;
+}
+
+void removeWorkDir()
+{
+    QDir(workDir()).removeRecursively();
+}
+
+namespace {
+int g_failures = 0;
+}
+
+void reportFailure(const QString &name, const QString &resolution, const QString &message)
+{
+    g_failures++;
+    printf("%-32s %-7s 失败: %s\n", qPrintable(name), qPrintable(resolution), qPrintable(message));
+}
+
+int failureCount()
+{
+    return g_failures;
+}
+
+} // namespace Bench
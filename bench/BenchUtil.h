@@ -0,0 +1,86 @@
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <QString>
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+/**
+ * @brief 基准测试公共工具
+ * 
+ * 计时、分配统计、峰值内存和结果输出。分配统计通过替换 malloc 系列函数实现，
+ * 仅在 glibc 平台可用，其余平台输出 n/a
+ */
+namespace Bench {
+
+struct Resolution {
+    const char *name;
+    int width;
+    int height;
+};
+
+// 标准测试分辨率: 480p / 1080p / 4K
+extern const Resolution kResolutions[3];
+
+// 每项测试的帧数 (分辨率越高帧数越少，使各项耗时相近)
+int frameCountFor(const Resolution &resolution);
+
+// 进程启动以来的堆分配统计 (次数 / 字节)
+struct AllocStats {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+bool allocTrackingAvailable();
+AllocStats allocStats();
+
+// 进程峰值常驻内存 (字节)，无法获取时返回0
+int64_t peakRssBytes();
+
+// 单项测试结果
+struct Result {
+    QString name;
+    QString resolution;
+    int64_t iterations;
+    int64_t elapsedNs;
+    AllocStats allocs;
+    int64_t peakRss;
+};
+
+// 测量一段代码: 返回耗时和期间的分配次数
+class Measure
+{
+public:
+    Measure();
+    Result finish(const QString &name, const QString &resolution, int64_t iterations) const;
+
+private:
+    int64_t m_startNs;
+    AllocStats m_startAllocs;
+};
+
+void printHeader();
+void printResult(const Result &result);
+
+// 记录一项检查失败 (如两种方式的输出不一致)，有失败时基准测试以非零退出码结束
+void reportFailure(const QString &name, const QString &resolution, const QString &message);
+int failureCount();
+
+// 生成带运动渐变图案的YUV420P帧 (index控制图案偏移)
+AVFrame *makeTestFrame(int width, int height, int index);
+
+// 基准测试的临时文件夹 (进程内唯一)
+QString workDir();
+
+// 用VideoEncoder生成指定分辨率的测试视频 (同一分辨率只生成一次)，失败返回空字符串
+QString testClip(const Resolution &resolution);
+
+// 删除临时文件夹及生成的测试视频
+void removeWorkDir();
+
+} // namespace Bench
+
+#endif // BENCHUTIL_H
@@ -0,0 +1,253 @@
+#include "BenchUtil.h"
+#include "EncodeProfile.h"
+#include "FrameCache.h"
+#include "FrameConverter.h"
+#include "KeyframeIndex.h"
+#include "VideoDecoder.h"
+#include "VideoEncoder.h"
+#include <QFileInfo>
+#include <QImage>
+#include <cstdio>
+#include <vector>
+
+namespace Bench {
+
+void runDecodeBenchmarks(const Resolution &resolution)
+{
+    QString clip = testClip(resolution);
+    if (clip.isEmpty()) {
+        printf("%-32s %-7s 生成测试视频失败\n", "decode", resolution.name);
+        return;
+    }
+    
+    // decodeNextFrame: 解码 + 转换为RGB图像
+    {
+        VideoDecoder decoder;
+        if (!decoder.open(clip)) {
+            return;
+        }
+        QImage frame;
+        decoder.decodeNextFrame(frame);     // 预热 (创建转换上下文和图像缓冲区)
+        decoder.reset();
+        
+        Measure measure;
+        int frames = 0;
+        while (decoder.decodeNextFrame(frame)) {
+            frames++;
+        }
+        printResult(measure.finish("decode/decodeNextFrame", resolution.name, frames));
+    }
+    
+    // 只解码不转换: 与上一项的差值即为RGB转换的开销
+    {
+        VideoDecoder decoder;
+        if (!decoder.open(clip)) {
+            return;
+        }
+        
+        Measure measure;
+        int frames = decoder.decodeFrames([](const AVFrame *) {
+            return true;
+        });
+        printResult(measure.finish("decode/decodeOnly", resolution.name, frames));
+    }
+}
+
+void runEncodeBenchmarks(const Resolution &resolution)
+{
+    // 预先准备少量不同的源图像循环使用，测量中不包含图像生成
+    const int sourceCount = 4;
+    std::vector<QImage> sources;
+    FrameConverter converter;
+    converter.setPoolSize(sourceCount);
+    for (int i = 0; i < sourceCount; i++) {
+        AVFrame *frame = makeTestFrame(resolution.width, resolution.height, i * 8);
+        if (!frame) {
+            return;
+        }
+        sources.push_back(converter.convert(frame));
+        av_frame_free(&frame);
+    }
+    
+    const int frames = frameCountFor(resolution);
+    
+    // 每种编码配置各编码一遍相同的帧，比较速度和输出大小
+    const EncodeProfile::Kind kinds[] = {
+        EncodeProfile::Throughput, EncodeProfile::Archival, EncodeProfile::LowLatency, EncodeProfile::Size
+    };
+    for (EncodeProfile::Kind kind : kinds) {
+        QString name = EncodeProfile::kindName(kind);
+        QString outputPath = QString("%1/encode_%2_%3.mp4").arg(workDir()).arg(resolution.name).arg(name);
+        
+        VideoEncoder encoder;
+        encoder.setProfile(EncodeProfile::forKind(kind));
+        if (!encoder.open(outputPath, resolution.width, resolution.height, AVRational{25, 1},
+                          (int64_t)resolution.width * resolution.height * 3)) {
+            printf("%-32s %-7s 无法创建编码器\n", qPrintable("encode/profile/" + name), resolution.name);
+            continue;
+        }
+        
+        // 包含finalize: 编码器缓存的帧在冲刷时才真正编码
+        Measure measure;
+        bool ok = true;
+        for (int i = 0; i < frames && ok; i++) {
+            ok = encoder.encodeFrame(sources[i % sourceCount]);
+        }
+        encoder.finalize();
+        Result result = measure.finish("encode/profile/" + name, resolution.name, frames);
+        encoder.close();
+        if (!ok) {
+            continue;
+        }
+        printResult(result);
+        printf("%-32s %-7s %.1f KB/帧\n", "", resolution.name, QFileInfo(outputPath).size() / 1024.0 / frames);
+    }
+    
+    // 解码得到的YUV420P帧直接编码 (默认配置): 与encode/profile/throughput的差值即为RGB往返转换的开销
+    std::vector<AVFrame *> yuvSources;
+    for (int i = 0; i < sourceCount; i++) {
+        AVFrame *frame = makeTestFrame(resolution.width, resolution.height, i * 8);
+        if (!frame) {
+            break;
+        }
+        yuvSources.push_back(frame);
+    }
+    
+    QString outputPath = QString("%1/encode_%2_avframe.mp4").arg(workDir()).arg(resolution.name);
+    VideoEncoder encoder;
+    if ((int)yuvSources.size() == sourceCount
+        && encoder.open(outputPath, resolution.width, resolution.height, AVRational{25, 1},
+                        (int64_t)resolution.width * resolution.height * 3)) {
+        Measure measure;
+        bool ok = true;
+        for (int i = 0; i < frames && ok; i++) {
+            ok = encoder.encodeFrame(yuvSources[i % sourceCount]);
+        }
+        encoder.finalize();
+        Result result = measure.finish("encode/avframe", resolution.name, frames);
+        encoder.close();
+        if (ok) {
+            printResult(result);
+        }
+    }
+    for (AVFrame *frame : yuvSources) {
+        av_frame_free(&frame);
+    }
+}
+
+void runSeekBenchmarks(const Resolution &resolution)
+{
+    QString clip = testClip(resolution);
+    if (clip.isEmpty()) {
+        printf("%-32s %-7s 生成测试视频失败\n", "seek", resolution.name);
+        return;
+    }
+    
+    // 固定种子的伪随机跳转位置，每次运行相同
+    const int seekCount = 20;
+    std::vector<qint64> positions;
+    {
+        VideoDecoder decoder;
+        if (!decoder.open(clip) || decoder.getDuration() <= 0) {
+            return;
+        }
+        uint32_t seed = 12345;
+        for (int i = 0; i < seekCount; i++) {
+            seed = seed * 1103515245 + 12345;
+            positions.push_back((seed >> 8) % decoder.getDuration());
+        }
+    }
+    
+    // 无容器索引时的快速扫描 (只读数据包，不解码)
+    {
+        KeyframeIndex index;
+        Measure measure;
+        index.buildByScan(clip, 0);
+        printResult(measure.finish("seek/indexScan", resolution.name, 1));
+    }
+    
+    // 每项测量的是 跳转 + 得到一帧RGB图像 的延迟
+    // 只跳到关键帧: 得到的帧通常早于目标时间
+    {
+        VideoDecoder decoder;
+        if (!decoder.open(clip)) {
+            return;
+        }
+        QImage frame;
+        decoder.decodeNextFrame(frame);
+        
+        Measure measure;
+        for (qint64 position : positions) {
+            decoder.seek(position);
+            decoder.decodeNextFrame(frame);
+        }
+        printResult(measure.finish("seek/keyframe", resolution.name, seekCount));
+    }
+    
+    // 精确跳转: 关键帧 + 向后解码到目标帧
+    {
+        VideoDecoder decoder;
+        if (!decoder.open(clip)) {
+            return;
+        }
+        QImage frame;
+        decoder.decodeNextFrame(frame);
+        
+        Measure measure;
+        for (qint64 position : positions) {
+            decoder.seekToFrame(position);
+            decoder.decodeNextFrame(frame);
+        }
+        printResult(measure.finish("seek/accurate", resolution.name, seekCount));
+    }
+    
+    // 逐帧向后跳转 (拖动进度条): 同一GOP内不重新跳转
+    {
+        VideoDecoder decoder;
+        if (!decoder.open(clip)) {
+            return;
+        }
+        QImage frame;
+        decoder.decodeNextFrame(frame);
+        
+        qint64 step = decoder.getFrameRate() > 0 ? (qint64)(1000 / decoder.getFrameRate()) : 40;
+        int steps = 0;
+        Measure measure;
+        for (qint64 position = step; position < decoder.getDuration() && steps < seekCount; position += step) {
+            decoder.seekToFrame(position);
+            decoder.decodeNextFrame(frame);
+            steps++;
+        }
+        printResult(measure.finish("seek/accurateStepForward", resolution.name, steps));
+    }
+    
+    // 长GOP缓存: 测试视频只有一两个关键帧，按播放线程的方式放入解码帧，预算只够四分之一，占用不能超过预算
+    {
+        VideoDecoder decoder;
+        if (!decoder.open(clip)) {
+            return;
+        }
+        FrameCache cache((int64_t)resolution.width * resolution.height * 3 / 2 * frameCountFor(resolution) / 4);
+        int64_t maxBytes = 0;
+        qint64 gopStartMs = 0;
+        
+        Measure measure;
+        int frames = decoder.decodeFrames([&](const AVFrame *frame) {
+            qint64 frameMs = decoder.frameTimestamp(frame);
+            if (frame->flags & AV_FRAME_FLAG_KEY) {
+                gopStartMs = frameMs;
+            }
+            cache.insert(0, gopStartMs, frameMs, decoder.frameDuration(frame), frame);
+            maxBytes = qMax(maxBytes, cache.stats().bytes);
+            return true;
+        });
+        printResult(measure.finish("seek/cacheLongGop", resolution.name, frames));
+        
+        if (maxBytes > cache.budget()) {
+            reportFailure("seek/cacheLongGop", resolution.name,
+                          QString("缓存占用%1字节，超出预算%2字节").arg(maxBytes).arg(cache.budget()));
+        }
+    }
+}
+
+} // namespace Bench
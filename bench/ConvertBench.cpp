@@ -0,0 +1,80 @@
+#include "BenchUtil.h"
+#include "FrameConverter.h"
+#include <QImage>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+// 旧的转换实现 (每帧分配AVFrame和中间缓冲区，再逐行拷贝到新QImage)，作为对照
+QImage legacyConvert(SwsContext *swsContext, const AVFrame *frame)
+{
+    int width = frame->width;
+    int height = frame->height;
+    
+    AVFrame *rgbFrame = av_frame_alloc();
+    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB24, width, height, 1);
+    uint8_t *buffer = (uint8_t *)av_malloc(numBytes);
+    
+    av_image_fill_arrays(rgbFrame->data, rgbFrame->linesize, buffer, AV_PIX_FMT_RGB24, width, height, 1);
+    sws_scale(swsContext, frame->data, frame->linesize, 0, height, rgbFrame->data, rgbFrame->linesize);
+    
+    QImage image(width, height, QImage::Format_RGB888);
+    for (int y = 0; y < height; y++) {
+        memcpy(image.scanLine(y), rgbFrame->data[0] + y * rgbFrame->linesize[0], width * 3);
+    }
+    
+    av_free(buffer);
+    av_frame_free(&rgbFrame);
+    
+    return image;
+}
+
+} // namespace
+
+namespace Bench {
+
+void runConvertBenchmarks(const Resolution &resolution)
+{
+    AVFrame *frame = makeTestFrame(resolution.width, resolution.height, 0);
+    if (!frame) {
+        return;
+    }
+    const int frames = frameCountFor(resolution);
+    
+    // 旧实现
+    {
+        SwsContext *swsContext = sws_getContext(
+            frame->width, frame->height, AV_PIX_FMT_YUV420P,
+            frame->width, frame->height, AV_PIX_FMT_RGB24,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        legacyConvert(swsContext, frame);   // 预热
+        
+        Measure measure;
+        for (int i = 0; i < frames; i++) {
+            QImage image = legacyConvert(swsContext, frame);
+        }
+        printResult(measure.finish("convert/legacy", resolution.name, frames));
+        sws_freeContext(swsContext);
+    }
+    
+    // FrameConverter (VideoDecoder::avFrameToQImage 的实现): 调用方每帧释放图像，缓冲区被复用
+    {
+        FrameConverter converter;
+        converter.convert(frame);           // 预热 (创建上下文和首个缓冲区)
+        
+        Measure measure;
+        for (int i = 0; i < frames; i++) {
+            QImage image = converter.convert(frame);
+        }
+        printResult(measure.finish("convert/FrameConverter", resolution.name, frames));
+    }
+    
+    av_frame_free(&frame);
+}
+
+} // namespace Bench
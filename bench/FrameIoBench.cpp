@@ -0,0 +1,126 @@
+#include "BenchUtil.h"
+#include "FrameConverter.h"
+#include "FrameSink.h"
+#include "ImageLoadPipeline.h"
+#include <QDir>
+#include <QImage>
+#include <QStringList>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+QString framePath(const QString &dir, int index)
+{
+    return QString("%1/frame_%2.jpg").arg(dir).arg(index, 6, 10, QChar('0'));
+}
+
+} // namespace
+
+namespace Bench {
+
+void runFrameIoBenchmarks(const Resolution &resolution)
+{
+    const int sourceCount = 4;
+    std::vector<QImage> sources;
+    FrameConverter converter;
+    converter.setPoolSize(sourceCount);
+    for (int i = 0; i < sourceCount; i++) {
+        AVFrame *frame = makeTestFrame(resolution.width, resolution.height, i * 8);
+        if (!frame) {
+            return;
+        }
+        sources.push_back(converter.convert(frame));
+        av_frame_free(&frame);
+    }
+    
+    const int frames = frameCountFor(resolution);
+    QString framesDir = QString("%1/frames_%2").arg(workDir()).arg(resolution.name);
+    QDir().mkpath(framesDir);
+    
+    // 逐帧在调用线程中压缩写盘 (拆分功能原来的做法)
+    {
+        Measure measure;
+        for (int i = 0; i < frames; i++) {
+            sources[i % sourceCount].save(framePath(framesDir, i), "JPEG", 95);
+        }
+        printResult(measure.finish("io/jpegWrite", resolution.name, frames));
+    }
+    
+    sources.clear();
+    
+    // FrameSink: 拆分功能的各种帧输出格式 (直接写解码帧)，附带每帧平均大小
+    {
+        std::vector<AVFrame *> yuvFrames;
+        for (int i = 0; i < sourceCount; i++) {
+            yuvFrames.push_back(makeTestFrame(resolution.width, resolution.height, i * 8));
+        }
+        
+        const FrameSink::Format formats[] = {
+            FrameSink::Jpeg, FrameSink::Png, FrameSink::Raw, FrameSink::Y4m, FrameSink::Ffv1
+        };
+        for (FrameSink::Format format : formats) {
+            QString sinkDir = QString("%1/sink_%2_%3").arg(workDir(), FrameSink::formatName(format), resolution.name);
+            QDir().mkpath(sinkDir);
+            
+            FrameSink::Options options;
+            options.format = format;
+            std::unique_ptr<FrameSink> sink = FrameSink::create(options, sinkDir);
+            sink->setFrameRate(AVRational{25, 1});
+            
+            Measure measure;
+            bool ok = true;
+            for (int i = 0; ok && i < frames; i++) {
+                ok = yuvFrames[i % sourceCount] && sink->write(yuvFrames[i % sourceCount]);
+            }
+            ok = sink->finish() && ok;
+            Result result = measure.finish("io/FrameSink/" + FrameSink::formatName(format), resolution.name, frames);
+            if (ok) {
+                printResult(result);
+                printf("    %.1f KB/帧\n", sink->bytesWritten() / 1024.0 / qMax(1, sink->framesWritten()));
+            } else {
+                printf("%-32s %-7s 失败\n", qPrintable(result.name), resolution.name);
+            }
+            
+            sink.reset();
+            QDir(sinkDir).removeRecursively();
+        }
+        
+        for (AVFrame *frame : yuvFrames) {
+            av_frame_free(&frame);
+        }
+    }
+    
+    QStringList paths;
+    for (int i = 0; i < frames; i++) {
+        paths << framePath(framesDir, i);
+    }
+    const QSize size(resolution.width, resolution.height);
+    
+    // 逐张在调用线程中读取并转换格式 (合成功能原来的做法)
+    {
+        Measure measure;
+        for (const QString &path : paths) {
+            QImage image(path);
+            image = image.convertToFormat(QImage::Format_RGB888);
+        }
+        printResult(measure.finish("io/imageLoad", resolution.name, frames));
+    }
+    
+    // ImageLoadPipeline: 合成功能使用的并行预读
+    {
+        Measure measure;
+        ImageLoadPipeline loader(paths, size, QImage::Format_RGB32);
+        QImage image;
+        int loaded = 0;
+        while (loader.next(image)) {
+            loaded++;
+        }
+        printResult(measure.finish("io/ImageLoadPipeline", resolution.name, loaded));
+    }
+    
+    QDir(framesDir).removeRecursively();
+}
+
+} // namespace Bench
@@ -0,0 +1,103 @@
+#include "BenchUtil.h"
+#include "FrameSink.h"
+#include "ThreadingPolicy.h"
+#include "VideoDecoder.h"
+#include "VideoProcessor.h"
+#include <QDir>
+#include <QFile>
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+// 解码合成的视频，统计帧数和最后一帧的结束时间
+bool probeOutput(const QString &path, int *frames, qint64 *durationMs)
+{
+    VideoDecoder decoder;
+    if (!decoder.open(path)) {
+        return false;
+    }
+    
+    *frames = 0;
+    *durationMs = 0;
+    decoder.decodeFrames([&](const AVFrame *frame) {
+        (*frames)++;
+        *durationMs = qMax(*durationMs, decoder.frameTimestamp(frame) + decoder.frameDuration(frame));
+        return true;
+    });
+    return *frames > 0;
+}
+
+} // namespace
+
+namespace Bench {
+
+void runMergeBenchmarks(const Resolution &resolution)
+{
+    // 图片序列: 用jpeg输出写出测试帧 (不计入测量)
+    const int frames = frameCountFor(resolution);
+    QString imageDir = QString("%1/merge_%2").arg(workDir()).arg(resolution.name);
+    QDir().mkpath(imageDir);
+    {
+        FrameSink::Options options;
+        std::unique_ptr<FrameSink> sink = FrameSink::create(options, imageDir);
+        bool ok = true;
+        for (int i = 0; ok && i < frames; i++) {
+            AVFrame *frame = makeTestFrame(resolution.width, resolution.height, i);
+            ok = frame && sink->write(frame);
+            av_frame_free(&frame);
+        }
+        if (!sink->finish() || !ok) {
+            printf("%-32s %-7s 生成图片序列失败\n", "merge", resolution.name);
+            QDir(imageDir).removeRecursively();
+            return;
+        }
+    }
+    
+    // 同一图片序列分别用一个编码器和分段并行编码合成。两者的帧数和时长应相同，
+    // 说明拼接后的时间戳连续
+    const int workers = qMax(2, ThreadingPolicy::instance().coreCount() / 2);
+    const struct {
+        const char *name;
+        int workers;
+    } modes[] = {
+        { "merge/serial", 1 },
+        { "merge/chunked", workers }
+    };
+    
+    int decodedFrames[2] = { 0, 0 };
+    qint64 durationMs[2] = { 0, 0 };
+    for (int i = 0; i < 2; i++) {
+        QString outputPath = QString("%1/merge_%2_%3.mp4").arg(workDir()).arg(i).arg(resolution.name);
+        VideoProcessor processor;
+        processor.setMergeWorkers(modes[i].workers);
+        
+        Measure measure;
+        bool ok = processor.runMerge(imageDir, QString(), outputPath);
+        Result result = measure.finish(modes[i].name, resolution.name, frames);
+        if (ok && probeOutput(outputPath, &decodedFrames[i], &durationMs[i])) {
+            printResult(result);
+        } else {
+            reportFailure(modes[i].name, resolution.name, "合成失败");
+        }
+        
+        QFile::remove(outputPath);
+    }
+    
+    QDir(imageDir).removeRecursively();
+    
+    if (decodedFrames[0] == 0 || decodedFrames[1] == 0) {
+        return;
+    }
+    if (decodedFrames[0] == decodedFrames[1] && durationMs[0] == durationMs[1]) {
+        printf("    最多%d段，帧数和时长与不分段一致 (%d帧，%lld ms)\n", workers, decodedFrames[0], (long long)durationMs[0]);
+        return;
+    }
+    
+    // 拼接处重复或遗漏了帧
+    reportFailure("merge/chunked", resolution.name,
+                  QString("帧数 %1 / %2，时长 %3 / %4 ms，与不分段不一致")
+                      .arg(decodedFrames[0]).arg(decodedFrames[1]).arg(durationMs[0]).arg(durationMs[1]));
+}
+
+} // namespace Bench
@@ -0,0 +1,86 @@
+#include "BenchUtil.h"
+#include "ThreadingPolicy.h"
+#include "VideoProcessor.h"
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <cstdio>
+
+namespace {
+
+// 拆分到outputDir，返回拆分清单的内容 (失败时为空)
+QByteArray splitClip(const QString &clip, const QString &outputDir, int workers)
+{
+    VideoProcessor processor;
+    processor.setSplitWorkers(workers);
+    if (!processor.runSplit(clip, outputDir)) {
+        return QByteArray();
+    }
+    
+    QFile manifest(outputDir + "/frames/manifest.jsonl");
+    if (!manifest.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return manifest.readAll();
+}
+
+} // namespace
+
+namespace Bench {
+
+void runSplitBenchmarks(const Resolution &resolution)
+{
+    QString clip = testClip(resolution);
+    if (clip.isEmpty()) {
+        printf("%-32s %-7s 生成测试视频失败\n", "split", resolution.name);
+        return;
+    }
+    
+    // 同一个视频分别不分段和按关键帧分段并行拆分 (jpeg)。两者的清单记录了每帧的
+    // 序号、显示时间、大小和哈希，完全相同说明分段处既没有重复也没有遗漏的帧
+    const int frames = frameCountFor(resolution);
+    const int workers = qMax(2, ThreadingPolicy::instance().coreCount() / 2);
+    const struct {
+        const char *name;
+        int workers;
+    } modes[] = {
+        { "split/serial", 1 },
+        { "split/parallel", workers }
+    };
+    
+    QByteArray manifests[2];
+    for (int i = 0; i < 2; i++) {
+        QString outputDir = QString("%1/split_%2_%3").arg(workDir()).arg(i).arg(resolution.name);
+        
+        Measure measure;
+        manifests[i] = splitClip(clip, outputDir, modes[i].workers);
+        Result result = measure.finish(modes[i].name, resolution.name, frames);
+        if (manifests[i].isEmpty()) {
+            reportFailure(modes[i].name, resolution.name, "拆分失败");
+        } else {
+            printResult(result);
+        }
+        
+        QDir(outputDir).removeRecursively();
+    }
+    
+    if (manifests[0].isEmpty() || manifests[1].isEmpty()) {
+        return;
+    }
+    if (manifests[0] == manifests[1]) {
+        printf("    最多%d段，输出与不分段一致\n", workers);
+        return;
+    }
+    
+    // 指出第一条不同的记录 (分段处重复或遗漏的帧)
+    QList<QByteArray> serialLines = manifests[0].split('\n');
+    QList<QByteArray> parallelLines = manifests[1].split('\n');
+    int line = 0;
+    while (line < serialLines.size() && line < parallelLines.size() && serialLines[line] == parallelLines[line]) {
+        line++;
+    }
+    reportFailure("split/parallel", resolution.name,
+                  QString("清单第%1行与不分段不一致 (%2 / %3 行)").arg(line + 1).arg(serialLines.size()).arg(parallelLines.size()));
+}
+
+} // namespace Bench
@@ -0,0 +1,83 @@
+#include "BenchUtil.h"
+#include <QCoreApplication>
+#include <QStringList>
+#include <cstdio>
+
+namespace Bench {
+void runConvertBenchmarks(const Resolution &resolution);
+void runDecodeBenchmarks(const Resolution &resolution);
+void runEncodeBenchmarks(const Resolution &resolution);
+void runSeekBenchmarks(const Resolution &resolution);
+void runFrameIoBenchmarks(const Resolution &resolution);
+void runSplitBenchmarks(const Resolution &resolution);
+void runMergeBenchmarks(const Resolution &resolution);
+}
+
+// 用法: videoeditor_bench [convert] [decode] [encode] [seek] [io] [split] [merge] [480p] [1080p] [4K]
+// 不指定测试组或分辨率时运行全部
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    
+    QStringList groups;
+    QStringList resolutions;
+    for (const QString &argument : QCoreApplication::arguments().mid(1)) {
+        bool isResolution = false;
+        for (const Bench::Resolution &resolution : Bench::kResolutions) {
+            if (argument.compare(resolution.name, Qt::CaseInsensitive) == 0) {
+                resolutions << resolution.name;
+                isResolution = true;
+            }
+        }
+        if (!isResolution) {
+            groups << argument.toLower();
+        }
+    }
+    
+    auto enabled = [](const QStringList &selected, const QString &name) {
+        return selected.isEmpty() || selected.contains(name);
+    };
+    
+    if (!Bench::allocTrackingAvailable()) {
+        printf("注意: 当前平台不支持分配统计，allocs/bytes 列显示为 n/a\n");
+    }
+    printf("peakRSS 为进程启动以来的峰值，按分辨率从低到高运行\n\n");
+    
+    Bench::printHeader();
+    
+    for (const Bench::Resolution &resolution : Bench::kResolutions) {
+        if (!enabled(resolutions, resolution.name)) {
+            continue;
+        }
+        
+        if (enabled(groups, "convert")) {
+            Bench::runConvertBenchmarks(resolution);
+        }
+        if (enabled(groups, "decode")) {
+            Bench::runDecodeBenchmarks(resolution);
+        }
+        if (enabled(groups, "encode")) {
+            Bench::runEncodeBenchmarks(resolution);
+        }
+        if (enabled(groups, "seek")) {
+            Bench::runSeekBenchmarks(resolution);
+        }
+        if (enabled(groups, "io")) {
+            Bench::runFrameIoBenchmarks(resolution);
+        }
+        if (enabled(groups, "split")) {
+            Bench::runSplitBenchmarks(resolution);
+        }
+        if (enabled(groups, "merge")) {
+            Bench::runMergeBenchmarks(resolution);
+        }
+    }
+    
+    Bench::removeWorkDir();
+    
+    if (Bench::failureCount() > 0) {
+        printf("\n%d项检查失败\n", Bench::failureCount());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef AUDIOOUTPUT_H
+#define AUDIOOUTPUT_H
+
+#include <QIODevice>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAudioFormat>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+}
+
+class QAudioSink;
+class PlaybackClock;
+
+/**
+ * @brief 音频输出
+ * 
+ * 解码线程把解码后的音频重采样为设备格式写入环形缓冲区，
+ * QAudioSink以拉取方式读取。每次读取时用已交给设备的数据时间戳
+ * 减去设备缓冲延迟校正播放主时钟，实现音画同步。
+ * 设备控制 (start/suspend/resume/stop) 须在创建对象的线程中调用
+ */
+class AudioOutput : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit AudioOutput(PlaybackClock *clock, QObject *parent = nullptr);
+    ~AudioOutput();
+    
+    // 按解码器参数选择设备格式并创建QAudioSink，无可用设备时返回false
+    bool open(const AVCodecContext *decoderContext);
+    void close() override;
+    
+    // 设备控制
+    void start();
+    void suspend();
+    void stop();
+    
+    // 写入一帧解码后的音频 (解码线程调用)，缓冲区满时阻塞，abort后返回false
+    bool writeFrame(const AVFrame *frame, qint64 ptsMs);
+    
+    // 清空缓冲区并恢复写入 (跳转或重新播放时调用)，之后时间戳早于startMs的音频被丢弃
+    void flush(qint64 startMs);
+    
+    // 唤醒阻塞的写入线程 (停止播放时调用)
+    void abort();
+    
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    PlaybackClock *m_clock;
+    std::unique_ptr<QAudioSink> m_sink;
+    QAudioFormat m_format;
+    SwrContext *m_swrContext;
+    std::vector<uint8_t> m_convertBuffer;
+    
+    // 环形缓冲区 (约2秒音频)
+    mutable QMutex m_mutex;
+    QWaitCondition m_spaceAvailable;
+    std::vector<char> m_buffer;
+    size_t m_readPos;
+    size_t m_size;
+    qint64 m_bufferStartUs;     // 缓冲区中第一个字节的时间戳 (微秒)
+    qint64 m_minPtsMs;          // 跳转后丢弃早于此时间的音频
+    qint64 m_sinkLatencyMs;     // 设备缓冲延迟
+    int m_inputSampleRate;
+    bool m_aborted;
+};
+
+#endif // AUDIOOUTPUT_H
@@ -0,0 +1,49 @@
+#ifndef AUDIOREMUXER_H
+#define AUDIOREMUXER_H
+
+#include <QString>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+/**
+ * @brief 音频重封装器
+ * 
+ * 将输入音频流的数据包直接复制到输出文件 (不重新编码)。
+ * 数据包由调用方逐个送入，便于与视频解码共用同一次解复用
+ */
+class AudioRemuxer
+{
+public:
+    AudioRemuxer();
+    ~AudioRemuxer();
+
+    // 根据输入音频流创建输出文件
+    bool open(const AVStream *inputStream, const QString &outputPath);
+    
+    // 关闭并释放资源
+    void close();
+    
+    // 写入一个输入数据包 (时间戳为输入流时基，写入后数据包被清空)
+    bool writePacket(AVPacket *packet);
+    
+    // 写入文件尾
+    bool finalize();
+    
+    bool isOpen() const { return m_formatContext != nullptr; }
+
+private:
+    void cleanup();
+
+private:
+    AVFormatContext *m_formatContext;
+    AVStream *m_outputStream;
+    AVRational m_inputTimeBase;
+    bool m_headerWritten;
+    
+    QString m_outputPath;
+};
+
+#endif // AUDIOREMUXER_H
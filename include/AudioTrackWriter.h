@@ -0,0 +1,76 @@
+#ifndef AUDIOTRACKWRITER_H
+#define AUDIOTRACKWRITER_H
+
+#include <QString>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+#include <libavutil/audio_fifo.h>
+}
+
+/**
+ * @brief 音频轨写入器
+ * 
+ * 为VideoEncoder的输出文件添加一条音频轨。输出容器支持源音频编码时直接复制数据包，
+ * 否则通过libavcodec解码、libswresample重采样后编码为AAC。
+ * 音频按视频进度分段写入，与视频数据包交错，不需要对输出文件做第二遍处理
+ */
+class AudioTrackWriter
+{
+public:
+    AudioTrackWriter();
+    ~AudioTrackWriter();
+
+    // 打开音频文件 (查找音频流)
+    bool openInput(const QString &audioPath);
+    
+    // 在输出文件写入文件头之前添加音频流
+    bool addStream(AVFormatContext *outputContext);
+    
+    // 写入音频直到指定时间 (秒)，与已写入的视频保持交错
+    bool writeUntil(double seconds);
+    
+    // 写入剩余音频 (不超过endSeconds，即以视频时长为准) 并冲刷编码器
+    bool finish(double endSeconds);
+    
+    // 关闭并释放资源
+    void close();
+    
+    bool isStreamCopy() const { return m_streamCopy; }
+
+private:
+    bool initTranscoder();
+    bool readPacket();
+    bool copyPacket();
+    bool decodePacket(const AVPacket *packet);
+    bool resampleToFifo(const AVFrame *frame);
+    bool encodeFromFifo(bool flush);
+    bool encodeFrame(const AVFrame *frame);
+    void cleanup();
+
+private:
+    AVFormatContext *m_inputContext;
+    AVFormatContext *m_outputContext;
+    AVStream *m_inputStream;
+    AVStream *m_outputStream;
+    AVPacket *m_packet;
+    
+    // 转码路径
+    AVCodecContext *m_decoderContext;
+    AVCodecContext *m_encoderContext;
+    SwrContext *m_swrContext;
+    AVAudioFifo *m_fifo;
+    AVFrame *m_decodedFrame;
+    AVFrame *m_resampledFrame;
+    
+    int64_t m_startPts;             // 输入音频起始时间戳
+    int64_t m_samplesWritten;       // 已送入编码器的采样数
+    double m_writtenSeconds;        // 已写入的音频时长 (秒)
+    double m_limitSeconds;          // 音频截止时间 (秒)，小于0表示不限
+    bool m_streamCopy;
+    bool m_inputEof;
+};
+
+#endif // AUDIOTRACKWRITER_H
@@ -0,0 +1,60 @@
+#ifndef ENCODEPROFILE_H
+#define ENCODEPROFILE_H
+
+#include <QString>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief 视频编码配置
+ * 
+ * 按用途预设的编码参数 (码率控制、preset/tune、GOP、B帧、硬件编码):
+ * - throughput: 速度优先，CRF 23 + veryfast，帧级多线程和lookahead都可用 (默认)
+ * - archival: 画质优先，CRF 18 + slow，只用软件编码
+ * - low-latency: 平均码率 + zerolatency，短GOP、无B帧，输出延迟最小但多线程只能按片并行
+ * - size: 体积优先，CRF 28 + slower，只用软件编码
+ * 
+ * 各项可在预设的基础上单独修改。preset/tune/crf等私有选项编码器不支持时忽略，
+ * CRF不可用的编码器 (硬件编码器) 改用平均码率
+ */
+struct EncodeProfile
+{
+    enum Kind {
+        Throughput,
+        Archival,
+        LowLatency,
+        Size
+    };
+    
+    enum RateControl {
+        Crf,        // 恒定质量 (quality为CRF值)
+        Cqp,        // 恒定量化参数 (quality为QP值)
+        Vbr         // 平均码率 (bitRate，0表示使用open时指定的码率)
+    };
+    
+    Kind kind = Throughput;
+    RateControl rateControl = Crf;
+    int quality = 23;
+    int64_t bitRate = 0;
+    QString preset = "veryfast";
+    QString tune;
+    int gopSize = 250;          // 关键帧间隔 (帧)
+    int maxBFrames = 3;
+    int threads = 0;            // 编码线程数，0表示由ThreadingPolicy分配
+    bool hardware = true;       // 允许使用硬件编码器
+    
+    // 预设配置
+    static EncodeProfile forKind(Kind kind);
+    
+    // 配置名 (throughput / archival / low-latency / size) 与枚举互转
+    static bool parseKind(const QString &name, Kind *kind);
+    static QString kindName(Kind kind);
+    
+    // 设置编码器上下文的GOP、B帧、码率控制和私有选项 (须在avcodec_open2之前调用)，
+    // fallbackBitRate为平均码率未指定或CRF不可用时使用的码率
+    void apply(AVCodecContext *context, int64_t fallbackBitRate) const;
+};
+
+#endif // ENCODEPROFILE_H
@@ -0,0 +1,87 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <QMutex>
+#include <list>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+/**
+ * @brief 解码帧缓存
+ * 
+ * 按 (流, 显示时间) 保存解码器输出的原始帧 (YUV，只持有引用不拷贝)，
+ * 内存占用不超过设定的字节预算。淘汰以GOP为单位按最近最少使用进行:
+ * GOP中缺少任何一帧都需要从关键帧重新解码，只保留半个GOP意义不大。
+ * 单个GOP超出预算时只保留其开头放得下的帧。
+ * 可在多个线程中同时使用
+ */
+class FrameCache
+{
+public:
+    explicit FrameCache(int64_t budgetBytes = 256LL * 1024 * 1024);
+    ~FrameCache();
+    
+    // 字节预算，调小时立即淘汰
+    void setBudget(int64_t bytes);
+    int64_t budget() const;
+    
+    // 放入一帧 (增加引用计数)，gopStartMs为所在GOP关键帧的显示时间；已存在时忽略
+    void insert(int streamIndex, qint64 gopStartMs, qint64 ptsMs, qint64 durationMs, const AVFrame *frame);
+    
+    // 查找显示时间覆盖timeMs的帧，命中时返回新的引用 (调用方用av_frame_free释放)，未命中返回nullptr
+    AVFrame *lookup(int streamIndex, qint64 timeMs, qint64 *ptsMs = nullptr, qint64 *durationMs = nullptr);
+    
+    bool contains(int streamIndex, qint64 timeMs) const;
+    void clear();
+    
+    struct Stats {
+        int64_t hits = 0;
+        int64_t misses = 0;
+        int64_t evictedGops = 0;
+        int frames = 0;
+        int64_t bytes = 0;
+    };
+    Stats stats() const;
+
+private:
+    struct Key {
+        int stream;
+        qint64 timeMs;
+        bool operator<(const Key &other) const {
+            return stream != other.stream ? stream < other.stream : timeMs < other.timeMs;
+        }
+    };
+    
+    struct Entry {
+        AVFrame *frame;
+        qint64 durationMs;
+        qint64 gopStartMs;
+        int64_t bytes;
+    };
+    
+    struct Gop {
+        std::list<Key>::iterator lruPosition;   // 在m_lru中的位置
+        std::vector<qint64> frameTimes;
+        int64_t bytes = 0;
+    };
+    
+    std::map<Key, Entry>::const_iterator findCovering(int streamIndex, qint64 timeMs) const;
+    void touch(Gop &gop);
+    void evict(const Key &keep);
+    void removeGop(std::map<Key, Gop>::iterator it);
+    static int64_t frameBytes(const AVFrame *frame);
+
+private:
+    mutable QMutex m_mutex;
+    std::map<Key, Entry> m_frames;      // 键: (流, 帧显示时间)
+    std::map<Key, Gop> m_gops;          // 键: (流, GOP关键帧时间)
+    std::list<Key> m_lru;               // GOP使用顺序，最近使用的在前
+    int64_t m_budget;
+    Stats m_stats;
+};
+
+#endif // FRAMECACHE_H
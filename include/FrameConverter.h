@@ -0,0 +1,63 @@
+#ifndef FRAMECONVERTER_H
+#define FRAMECONVERTER_H
+
+#include <QImage>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+/**
+ * @brief 帧格式转换器
+ * 
+ * 将解码得到的AVFrame转换为RGB QImage，可同时缩放到显示尺寸 (预览时只转换实际显示的像素)。
+ * sws_scale直接写入目标图像的扫描行，
+ * 目标图像来自一个小的复用池: 调用方释放上一帧后，其缓冲区会被下一帧复用，
+ * 因此稳定运行时每帧没有堆分配，也没有额外的整帧拷贝
+ */
+class FrameConverter
+{
+public:
+    FrameConverter();
+    ~FrameConverter();
+
+    // 转换一帧 (源格式或尺寸变化时自动重建转换上下文)
+    QImage convert(const AVFrame *frame);
+    
+    // 转换到调用方提供的图像中 (尺寸、格式一致且没有其他引用时原地写入，否则重新分配)
+    bool convertInto(const AVFrame *frame, QImage &image);
+    
+    // 输出尺寸: 无效尺寸表示保持源尺寸，否则按源宽高比缩放到该尺寸以内 (尺寸变化时自动重建转换上下文)
+    void setOutputSize(const QSize &size);
+    QSize outputSize() const { return m_outputSize; }
+    
+    // 输出格式: Format_RGB888 (默认)、Format_RGB32 或 Format_ARGB32_Premultiplied
+    // 后两者是界面绘制的原生格式，绘制时不需要再转换
+    void setOutputFormat(QImage::Format format);
+    
+    // 源尺寸按宽高比 (含像素宽高比) 缩放到box以内的尺寸
+    static QSize fitSize(int width, int height, AVRational sampleAspectRatio, const QSize &box);
+    
+    // 复用池大小: 应不少于调用方同时持有的帧数 + 1
+    void setPoolSize(int size);
+    int poolSize() const { return (int)m_pool.size(); }
+    
+    // 释放转换上下文和复用池
+    void reset();
+
+private:
+    QSize prepare(const AVFrame *frame);    // 准备转换上下文，返回输出尺寸 (失败时返回无效尺寸)
+    void scale(const AVFrame *frame, QImage &image);
+    QImage &acquireImage(int width, int height);
+
+private:
+    SwsContext *m_swsContext;
+    QSize m_outputSize;
+    QImage::Format m_outputFormat;
+    std::vector<QImage> m_pool;
+    size_t m_nextSlot;
+};
+
+#endif // FRAMECONVERTER_H
@@ -0,0 +1,59 @@
+#ifndef FRAMEMAILBOX_H
+#define FRAMEMAILBOX_H
+
+#include <QImage>
+#include <atomic>
+
+/**
+ * @brief 显示帧信箱 (无锁三缓冲)
+ * 
+ * 显示线程 (唯一写入者) 把帧写入后台槽并发布，UI线程 (唯一读取者) 取走最新的帧。
+ * 三个槽预先分配、循环使用: 写入者持有后台槽，读取者持有前台槽，中间槽用原子交换传递。
+ * UI来不及取走时新帧覆盖旧帧 (计入丢弃数)，内存占用固定为三帧
+ */
+class FrameMailbox
+{
+public:
+    struct Stats {
+        int64_t published = 0;      // 发布的帧数
+        int64_t dropped = 0;        // 未被取走就被新帧覆盖的帧数
+        int64_t taken = 0;          // UI取走的帧数
+    };
+    
+    FrameMailbox();
+    
+    // 写入者: 取得后台槽的图像 (尺寸和格式一致时可原地写入)
+    QImage &writeSlot();
+    
+    // 写入者: 发布后台槽。上一帧已被取走时返回true，调用方需通知读取者；
+    // 否则说明已有一次通知尚未处理，本次覆盖旧帧并返回false
+    bool publish(qint64 ptsMs);
+    
+    // 读取者: 取走最新发布的帧，没有新帧时返回false
+    bool take(QImage &image, qint64 *ptsMs = nullptr);
+    
+    // 丢弃未取走的帧 (重新打开文件时调用，须在写入者停止后调用)
+    void reset();
+    
+    Stats stats() const;
+
+private:
+    struct Slot {
+        QImage image;
+        qint64 ptsMs = 0;
+    };
+    
+    static const int kFresh = 4;    // 中间槽中有未取走的新帧
+    static const int kIndexMask = 3;
+    
+    Slot m_slots[3];
+    int m_back;                     // 仅写入者使用
+    int m_front;                    // 仅读取者使用
+    std::atomic<int> m_middle;      // 槽序号 | kFresh
+    
+    std::atomic<int64_t> m_published;
+    std::atomic<int64_t> m_dropped;
+    std::atomic<int64_t> m_taken;
+};
+
+#endif // FRAMEMAILBOX_H
@@ -0,0 +1,65 @@
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <deque>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+/**
+ * @brief 待显示的解码帧
+ * 
+ * 保存解码器输出的原始帧 (YUV)，只有真正显示的帧才转换为RGB
+ */
+struct PlaybackFrame
+{
+    AVFrame *frame = nullptr;
+    qint64 ptsMs = 0;           // 显示时间 (毫秒)
+    qint64 durationMs = 0;      // 帧时长 (毫秒)
+    int serial = 0;             // 跳转序号，与播放器当前序号不同的帧已过期
+    bool preview = false;       // 拖动进度条时目标之前的关键帧，到达后立即显示
+};
+
+/**
+ * @brief 有界帧队列
+ * 
+ * 解码线程放入、显示线程取出。队列满时解码线程阻塞，
+ * 内存占用固定为 容量 × 单帧大小
+ */
+class FrameQueue
+{
+public:
+    explicit FrameQueue(int capacity = 8);
+    ~FrameQueue();
+    
+    // 放入一帧 (取得frame所有权)，队列满时阻塞；abort后返回false并释放该帧
+    bool push(const PlaybackFrame &item);
+    
+    // 取出一帧，最多等待timeoutMs毫秒，超时或abort后返回false
+    bool pop(PlaybackFrame &item, int timeoutMs);
+    
+    int size() const;
+    
+    // 释放队列中所有帧 (跳转时调用)，唤醒等待放入的线程
+    void clear();
+    
+    // 中止: 唤醒所有等待的线程，之后push/pop立即返回false，直到restart
+    void abort();
+    void restart();
+    
+    // 释放帧数据
+    static void release(PlaybackFrame &item) { av_frame_free(&item.frame); }
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notFull;
+    QWaitCondition m_notEmpty;
+    std::deque<PlaybackFrame> m_frames;
+    int m_capacity;
+    bool m_aborted;
+};
+
+#endif // FRAMEQUEUE_H
@@ -0,0 +1,115 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <QString>
+#include <functional>
+#include <memory>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+/**
+ * @brief 拆分时的帧输出格式
+ * 
+ * 解码帧直接交给输出，不经过QImage。各格式在速度和体积上取舍不同:
+ * - jpeg: libavcodec mjpeg编码 (多线程)，有损，体积最小
+ * - png: libavcodec png编码 (多线程)，无损，压缩级别可调
+ * - raw: 每帧一个文件，按解码的像素格式紧密存放各平面 (或RGB24)，不压缩，最快
+ * - y4m: 所有帧写入一个frames.y4m，流式读取方便
+ * - ffv1: 所有帧无损编码到一个frames.mkv，体积比png小、比raw慢
+ * 
+ * 输出在第一帧到来时按帧的尺寸和像素格式打开，write()在调用线程中执行
+ */
+class FrameSink
+{
+public:
+    enum Format {
+        Jpeg,
+        Png,
+        Raw,
+        Y4m,
+        Ffv1
+    };
+    
+    struct Options {
+        Format format = Jpeg;
+        int jpegQuality = 95;       // 1-100
+        int pngCompression = 3;     // zlib压缩级别 0-9，越大越小越慢
+        bool rawRgb = false;        // raw: 转换为RGB24 (默认保留解码的YUV平面)
+        int threads = 0;            // 编码线程数，0表示由ThreadingPolicy分配
+    };
+    
+    // 创建指定格式的输出，帧写到outputDir中
+    static std::unique_ptr<FrameSink> create(const Options &options, const QString &outputDir);
+    
+    // 格式名 (jpeg / png / raw / y4m / ffv1) 与枚举互转
+    static bool parseFormat(const QString &name, Format *format);
+    static QString formatName(Format format);
+    
+    virtual ~FrameSink();
+
+    // 每写完一个帧文件调用一次 (jpeg/png/raw)，参数为输出序号、文件名和写入的内容
+    using FileWrittenCallback = std::function<bool(int index, const QString &fileName, const uint8_t *data, int64_t size)>;
+    
+    // 帧率 (y4m/ffv1写入文件头)，须在第一次write之前设置
+    void setFrameRate(AVRational frameRate) { m_frameRate = frameRate; }
+    
+    // 第一帧的输出序号 (续拆时接在已有文件之后)，须在第一次write之前设置
+    void setFirstIndex(int index) { m_firstIndex = index; }
+    
+    void setFileWrittenCallback(FileWrittenCallback callback) { m_fileWritten = std::move(callback); }
+    
+    // 是否每帧一个文件 (只有这些格式可以续拆)
+    static bool writesFramePerFile(Format format) { return format == Jpeg || format == Png || format == Raw; }
+    
+    // 帧文件名 frame_000000.<suffix>
+    static QString frameFileName(int index, const char *suffix);
+    
+    // 写入一帧 (第一帧时打开输出)
+    bool write(const AVFrame *frame);
+    
+    // 写出编码器中剩余的帧并关闭文件
+    bool finish();
+    
+    Format format() const { return m_options.format; }
+    int framesWritten() const { return m_framesWritten; }
+    int64_t bytesWritten() const { return m_bytesWritten; }
+
+protected:
+    FrameSink(const Options &options, const QString &outputDir);
+    
+    virtual bool openSink(const AVFrame *frame) = 0;
+    virtual bool writeFrame(const AVFrame *frame) = 0;
+    virtual bool finishSink() = 0;
+    
+    // 转换为指定像素格式 (格式相同时直接返回原帧)，返回的帧在下次转换前有效
+    const AVFrame *convert(const AVFrame *frame, AVPixelFormat format);
+    
+    // outputDir下的帧文件路径
+    QString framePath(int index, const char *suffix) const;
+    
+    // 写完一个帧文件后调用，回调返回false时视为写入失败
+    bool fileWritten(int index, const char *suffix, const uint8_t *data, int64_t size);
+    
+    // 为编码器设置线程数
+    void applyThreads(AVCodecContext *context) const;
+
+protected:
+    Options m_options;
+    QString m_outputDir;
+    AVRational m_frameRate;
+    int m_firstIndex;
+    int m_framesWritten;
+    int64_t m_bytesWritten;
+
+private:
+    FileWrittenCallback m_fileWritten;
+    SwsContext *m_swsContext;
+    AVFrame *m_convertedFrame;
+    bool m_opened;
+    bool m_finished;
+};
+
+#endif // FRAMESINK_H
@@ -0,0 +1,63 @@
+#ifndef IMAGELOADPIPELINE_H
+#define IMAGELOADPIPELINE_H
+
+#include <QImage>
+#include <QSize>
+#include <QStringList>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief 图片预读流水线
+ * 
+ * 多个工作线程并行读取、解码、缩放并转换图片格式，结果按原顺序交付。
+ * 工作线程只预读 [下一帧, 下一帧 + 窗口) 范围内的图片，内存占用有上限，
+ * 窗口大小同时受帧数和内存预算限制 (4K序列会自动缩小窗口)
+ */
+class ImageLoadPipeline
+{
+public:
+    // targetSize: 尺寸不一致的图片缩放到此尺寸; format: 交付的像素格式
+    // threadCount <= 0 时由ThreadingPolicy分配, memoryBudget为预读窗口的字节上限
+    ImageLoadPipeline(const QStringList &paths, const QSize &targetSize, QImage::Format format,
+                      int threadCount = 0, qint64 memoryBudget = 512LL * 1024 * 1024);
+    ~ImageLoadPipeline();
+
+    // 按顺序取下一张图片，全部取完返回false (读取失败的图片返回空QImage)
+    bool next(QImage &image);
+    
+    // 停止预读并结束工作线程
+    void stop();
+    
+    int threadCount() const { return (int)m_threads.size(); }
+    int windowSize() const { return (int)m_slots.size(); }
+
+private:
+    struct Slot {
+        QImage image;
+        bool ready = false;
+    };
+    
+    void workerLoop();
+    QImage loadImage(const QString &path) const;
+
+private:
+    QStringList m_paths;
+    QSize m_targetSize;
+    QImage::Format m_format;
+    
+    std::vector<std::unique_ptr<QThread>> m_threads;
+    std::vector<Slot> m_slots;      // 环形重排序窗口，第i帧存放在 i % 窗口大小
+    
+    QMutex m_mutex;
+    QWaitCondition m_slotReady;     // 有帧加载完成
+    QWaitCondition m_windowMoved;   // 消费方取走帧，窗口前移
+    int m_nextToLoad;
+    int m_nextToDeliver;
+    bool m_stopped;
+};
+
+#endif // IMAGELOADPIPELINE_H
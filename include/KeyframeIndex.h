@@ -0,0 +1,77 @@
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include <QString>
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * @brief 关键帧索引
+ * 
+ * 记录视频流中每个关键帧的时间戳，用于精确跳转 (先跳到目标之前最近的关键帧，
+ * 再向后解码到目标帧) 和按GOP划分工作。优先读取容器自带的索引，
+ * 没有索引的格式 (如TS) 通过只读数据包、不解码的快速扫描建立
+ * 
+ * 每个关键帧记录两个时间: 跳转用的时间戳 (mp4索引中为解码时间) 和显示时间，
+ * 与帧的显示时间比较时只用后者。有B帧时关键帧的显示时间晚于解码时间，
+ * 容器索引不含显示时间，改为读取各关键帧的数据包 (只读关键帧，不解码)
+ */
+class KeyframeIndex
+{
+public:
+    struct Entry {
+        int64_t timestamp;      // 跳转用的时间戳 (流时间基，可直接用于av_seek_frame)
+        int64_t pts;            // 显示时间戳 (流时间基)
+        qint64 timeMs;          // 显示时间，相对流开始 (毫秒)
+    };
+    
+    KeyframeIndex();
+    
+    // 从容器索引读取 (mp4的stss、mkv的Cues等)。容器没有索引，或流有B帧 (索引时间不是显示时间) 时返回false
+    bool buildFromContainer(AVFormatContext *formatContext, int streamIndex);
+    
+    // 单独打开文件读取数据包建立索引 (不影响调用方的读取位置): 容器有索引时只读各关键帧的数据包，
+    // 否则扫描全部数据包。cancel置位时中止并返回false
+    bool buildByScan(const QString &filePath, int streamIndex, const std::atomic<bool> *cancel = nullptr);
+    
+    bool isReady() const { return m_ready; }
+    void clear();
+    int size() const;
+    
+    // 显示时间戳 (流时间基) 之前 (含) 最近的关键帧，索引未建立或目标早于第一个关键帧时返回false
+    bool keyframeBefore(int64_t pts, Entry *entry) const;
+    
+    // 所有关键帧的显示时间 (毫秒，升序)
+    std::vector<qint64> keyframeTimes() const;
+
+private:
+    struct Keyframe {
+        int64_t seekTimestamp;
+        int64_t pts;
+        bool operator<(const Keyframe &other) const { return pts < other.pts; }
+        bool operator==(const Keyframe &other) const { return pts == other.pts; }
+    };
+    
+    // 容器索引中每个关键帧的数据包的显示时间，cancel置位时返回false
+    static bool readKeyframePackets(AVFormatContext *formatContext, int streamIndex, std::vector<Keyframe> &keyframes,
+                                    const std::atomic<bool> *cancel);
+    static bool scanPackets(AVFormatContext *formatContext, int streamIndex, std::vector<Keyframe> &keyframes,
+                            const std::atomic<bool> *cancel);
+    
+    void setEntries(std::vector<Keyframe> &keyframes, AVStream *stream);
+    Entry makeEntry(const Keyframe &keyframe) const;
+
+private:
+    mutable QMutex m_mutex;
+    std::vector<Keyframe> m_keyframes;  // 按显示时间升序
+    AVRational m_timeBase;
+    int64_t m_startTime;
+    std::atomic<bool> m_ready;
+};
+
+#endif // KEYFRAMEINDEX_H
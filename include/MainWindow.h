@@ -16,6 +16,7 @@
 #include <memory>
 
 class VideoPlayer;
+class VideoView;
 class VideoProcessor;
 
 /**
@@ -45,13 +46,15 @@ private slots:
     void onSliderMoved(int value);  // 进度条拖动
     
     // 播放器事件
-    void onFrameReady(const QImage &frame);     // 新帧就绪
+    void onFrameReady();                        // 新帧就绪
     void onPositionChanged(qint64 position);    // 播放位置改变
     void onDurationChanged(qint64 duration);    // 总时长改变
     void onVideoInfoReady(const QString &info); // 视频信息就绪
+    void onPlaybackFinished();                  // 播放结束
     
     // 处理器事件
     void onProcessProgress(int progress);       // 处理进度更新
+    void onStreamProgress(int videoProgress, int audioProgress);  // 拆分时各流进度
     void onProcessFinished(bool success, const QString &message);  // 处理完成
 
 private:
@@ -66,7 +69,7 @@ private:
 private:
     // UI组件
     QWidget *centralWidget;
-    QLabel *videoLabel;              // 视频预览标签
+    VideoView *videoView;            // 视频预览
     QLabel *timeLabel;               // 时间显示标签
     QTextEdit *infoTextEdit;         // 视频信息显示区
     
@@ -89,7 +92,6 @@ private:
     bool isSliderPressed;            // 进度条是否被按下
     bool isPlaying;                  // 是否正在播放
     qint64 videoDuration;            // 视频总时长
-    QImage currentFrame;             // 当前帧
 };
 
 #endif // MAINWINDOW_H
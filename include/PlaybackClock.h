@@ -0,0 +1,44 @@
+#ifndef PLAYBACKCLOCK_H
+#define PLAYBACKCLOCK_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+
+/**
+ * @brief 播放主时钟
+ * 
+ * 以系统单调时钟推进播放位置，支持暂停和跳转。
+ * 有音频输出时由音频设备的实际播放位置校正 (音频为主时钟)，
+ * 视频帧按此时钟的时间显示
+ */
+class PlaybackClock
+{
+public:
+    PlaybackClock();
+    
+    // 设置当前播放位置 (毫秒)，保持暂停状态不变
+    void reset(qint64 positionMs);
+    
+    // 暂停/继续 (暂停时时钟停止)
+    void pause();
+    void resume();
+    bool isPaused() const;
+    
+    // 当前播放位置 (毫秒)
+    qint64 now() const;
+    
+    // 用音频设备的播放位置校正时钟: 偏差较大时直接对齐，否则逐步靠拢避免画面抖动
+    void sync(qint64 audioPositionMs);
+
+private:
+    qint64 positionLocked() const;
+
+private:
+    mutable QMutex m_mutex;
+    QElapsedTimer m_timer;
+    qint64 m_basePosition;      // m_baseElapsed时刻的播放位置
+    qint64 m_baseElapsed;       // 计时器读数 (毫秒)
+    bool m_paused;
+};
+
+#endif // PLAYBACKCLOCK_H
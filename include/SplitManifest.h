@@ -0,0 +1,60 @@
+#ifndef SPLITMANIFEST_H
+#define SPLITMANIFEST_H
+
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+#include <vector>
+
+/**
+ * @brief 拆分输出清单
+ * 
+ * 拆分时每写完一个帧文件就向清单 (每行一个JSON对象) 追加一条记录:
+ * 输出序号、显示时间、源视频中的帧序号、文件名、大小和内容哈希。
+ * 第一行记录源文件和拆分参数，参数不同的清单不能用于续拆。
+ * 
+ * 续拆时读取清单并校验已有文件 (全部检查大小，末尾的一段再检查哈希)，
+ * 从第一个无效的记录处截断，拆分从最后一个有效帧之后继续
+ */
+class SplitManifest
+{
+public:
+    struct Entry {
+        int index = 0;              // 输出序号
+        qint64 ptsMs = -1;          // 显示时间 (毫秒)
+        qint64 sourceFrame = 0;     // 源视频中的帧序号 (从区间起点开始计)
+        QString fileName;
+        qint64 size = 0;
+        quint64 hash = 0;
+    };
+    
+    SplitManifest();
+    ~SplitManifest();
+
+    // 读取已有清单并校验文件，header与记录的不同时返回false；有效记录通过entries()获取
+    bool load(const QString &path, const QJsonObject &header);
+    
+    // 写入header和当前的有效记录 (先写临时文件再替换)，之后以追加方式打开
+    bool open(const QString &path, const QJsonObject &header);
+    
+    // 追加一条记录 (不经过用户态缓冲，进程被杀时已追加的记录不会丢失)
+    bool append(const Entry &entry);
+    
+    void close();
+    
+    const std::vector<Entry> &entries() const { return m_entries; }
+    void clearEntries() { m_entries.clear(); }
+    
+    // 快速内容哈希 (64位FNV-1a)
+    static quint64 contentHash(const void *data, qint64 size);
+
+private:
+    bool verify(const QString &dir, const Entry &entry, bool checkHash) const;
+    static QJsonObject toJson(const Entry &entry);
+
+private:
+    QFile m_file;
+    std::vector<Entry> m_entries;
+};
+
+#endif // SPLITMANIFEST_H
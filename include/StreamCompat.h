@@ -0,0 +1,47 @@
+#ifndef STREAMCOMPAT_H
+#define STREAMCOMPAT_H
+
+#include <QString>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief 直接复制数据包时的流兼容性工具
+ * 
+ * 裁剪和拼接时，复制的数据包和重新编码的数据包写入同一条输出流。
+ * 这里检查两条流能否直接拼接，按源流参数打开编码器，
+ * 并把编码器输出转换为源流的码流格式 (mp4/mkv中H.264/HEVC的长度前缀格式)
+ */
+class StreamCompat
+{
+public:
+    // 两条流的数据包能否写入同一条输出流，不能时reason给出原因
+    static bool isCompatible(const AVCodecParameters *reference, const AVCodecParameters *params, QString *reason = nullptr);
+    
+    // 按源流参数打开视频编码器 (编码格式、尺寸、像素格式、码率、profile/level、色彩信息)。
+    // 不使用B帧 (解码顺序与显示顺序相同)，不使用全局头 (参数集随关键帧写入码流)
+    static AVCodecContext *openVideoEncoder(const AVCodecParameters *params, AVRational timeBase, AVRational frameRate, int64_t fallbackBitRate);
+    
+    // 按源流参数打开音频编码器 (编码格式、采样率、声道布局、采样格式、码率)
+    static AVCodecContext *openAudioEncoder(const AVCodecParameters *params, bool globalHeader);
+    
+    // 长度前缀的字节数 (mp4/mkv中的H.264/HEVC)，起始码格式返回0
+    static int nalLengthSize(const AVCodecParameters *params);
+    
+    // 源流的参数集 (SPS/PPS，HEVC还有VPS)，转换为数据包中使用的格式；其他编码格式返回空
+    static std::vector<uint8_t> parameterSets(const AVCodecParameters *params, int lengthSize);
+    
+    // 编码器输出的起始码格式转换为长度前缀格式 (lengthSize为0时不转换)
+    static bool convertEncodedPacket(AVPacket *packet, int lengthSize);
+    
+    // 在数据包前插入数据 (如参数集)，保留时间戳和标志
+    static bool prependToPacket(AVPacket *packet, const std::vector<uint8_t> &data);
+
+private:
+    static bool replacePacketData(AVPacket *packet, const std::vector<uint8_t> &data);
+};
+
+#endif // STREAMCOMPAT_H
@@ -0,0 +1,120 @@
+#ifndef STREAMCONCATENATOR_H
+#define STREAMCONCATENATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+#include <libswresample/swresample.h>
+#include <libavutil/audio_fifo.h>
+}
+
+class AudioTrackWriter;
+
+/**
+ * @brief 视频拼接器
+ * 
+ * 以第一个片段的视频/音频流参数为准检查其余片段: 参数兼容的片段直接复制数据包，
+ * 时间戳按前面片段的总时长顺延，不解码也不编码；不兼容的片段 (编码格式、分辨率、
+ * 采样率等不同) 解码后按第一个片段的参数重新编码，再接到同一条输出流中。
+ * 每个片段采用的方式和原因可通过results()查询
+ */
+class StreamConcatenator
+{
+public:
+    struct ClipResult {
+        QString path;
+        bool streamCopy = true;     // true: 直接复制数据包；false: 重新编码
+        QString reason;             // 重新编码的原因
+    };
+    
+    StreamConcatenator();
+    ~StreamConcatenator();
+
+    // 按顺序拼接所有片段写入输出文件
+    bool concat(const QStringList &inputPaths, const QString &outputPath);
+    
+    // 进度回调 (0-99)，在调用concat的线程中调用
+    void setProgressCallback(std::function<void(int)> callback) { m_progressCallback = std::move(callback); }
+    
+    // 以单独的音频文件作为输出的音频轨 (忽略片段中的音频)，按视频进度交错写入，不超过视频时长
+    void setAudioSource(const QString &audioPath) { m_audioSourcePath = audioPath; }
+    
+    const std::vector<ClipResult> &results() const { return m_results; }
+    int streamCopyCount() const;
+
+private:
+    bool probeClips(const QStringList &inputPaths);
+    bool openClip(const QString &path);
+    void closeClip();
+    bool openOutput(const QString &outputPath);
+    
+    bool copyClip(int clipIndex);
+    bool reencodeClip(int clipIndex);
+    bool openClipCodecs();
+    bool decodeVideo(const AVPacket *packet);   // nullptr表示冲刷解码器
+    bool encodeVideoFrame(AVFrame *frame);      // nullptr表示冲刷编码器
+    bool decodeAudio(const AVPacket *packet);
+    bool resampleAudio(const AVFrame *frame);
+    bool encodeAudioFromFifo(bool flush);
+    bool encodeAudioFrame(const AVFrame *frame);
+    
+    // 时间戳换算到输出流 (减去片段起点，加上前面片段的总时长) 后写入
+    bool writePacket(AVPacket *packet, AVStream *output, AVRational timeBase, int64_t clipStart);
+    void reportProgress(int clipIndex, const AVPacket *packet);
+    void cleanup();
+
+private:
+    // 输出
+    AVFormatContext *m_outputContext;
+    AVStream *m_videoOutput;
+    AVStream *m_audioOutput;
+    AVCodecParameters *m_videoReference;    // 第一个片段的流参数
+    AVCodecParameters *m_audioReference;
+    AVRational m_videoTimeBase;
+    int64_t m_offsetUs;             // 前面片段的总时长 (微秒)
+    int64_t m_lastVideoDts;
+    int64_t m_lastAudioDts;
+    
+    // 当前片段
+    AVFormatContext *m_inputContext;
+    int m_videoStreamIndex;
+    int m_audioStreamIndex;
+    int64_t m_clipStartUs;          // 片段起始时间
+    int64_t m_clipEndUs;            // 已写入的数据包的最大结束时间 (相对片段起点)
+    std::vector<uint8_t> m_parameterSets;   // 片段的参数集，插入到片段的第一个关键帧前
+    bool m_needParameterSets;
+    
+    // 重新编码
+    AVCodecContext *m_videoDecoder;
+    AVCodecContext *m_videoEncoder;
+    AVCodecContext *m_audioDecoder;
+    AVCodecContext *m_audioEncoder;
+    SwsContext *m_swsContext;
+    SwrContext *m_swrContext;
+    AVAudioFifo *m_fifo;
+    AVFrame *m_frame;
+    AVFrame *m_scaledFrame;
+    AVFrame *m_resampledFrame;
+    AVPacket *m_packet;
+    AVPacket *m_encodedPacket;
+    int64_t m_videoDelay;           // 按参考流的重排延迟推算解码时间戳 (片段时间基)
+    int64_t m_audioSamples;         // 下一个编码音频帧的时间 (采样数，相对片段起点)，-1表示尚未确定
+    int m_nalLengthSize;
+    
+    // 单独的音频源
+    QString m_audioSourcePath;
+    std::unique_ptr<AudioTrackWriter> m_audioWriter;
+    
+    std::vector<ClipResult> m_results;
+    std::function<void(int)> m_progressCallback;
+    int m_lastProgress;
+};
+
+#endif // STREAMCONCATENATOR_H
@@ -0,0 +1,101 @@
+#ifndef STREAMTRIMMER_H
+#define STREAMTRIMMER_H
+
+#include <QString>
+#include <functional>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+/**
+ * @brief 无损裁剪器 (智能渲染)
+ * 
+ * 区间内完整的GOP直接复制数据包 (与拆分时复制音频的方式相同)，不解码也不编码；
+ * 只有起点和终点所在的不完整GOP解码后重新编码，编码器参数 (编码格式、尺寸、
+ * 像素格式、码率、profile/level、色彩信息) 与源视频流一致。音频数据包按时间直接复制。
+ * 裁剪耗时主要是读写文件，与片段在源文件中的位置无关
+ */
+class StreamTrimmer
+{
+public:
+    struct Stats {
+        int64_t copiedPackets = 0;      // 直接复制的视频数据包
+        int64_t encodedFrames = 0;      // 重新编码的视频帧
+    };
+    
+    StreamTrimmer();
+    ~StreamTrimmer();
+
+    // 裁剪 [startMs, endMs) 写入输出文件 (时间以文件起点为零点)
+    bool trim(const QString &inputPath, const QString &outputPath, qint64 startMs, qint64 endMs);
+    
+    // 进度回调 (0-99)，在调用trim的线程中调用
+    void setProgressCallback(std::function<void(int)> callback) { m_progressCallback = std::move(callback); }
+    
+    const Stats &stats() const { return m_stats; }
+
+private:
+    bool openInput(const QString &inputPath);
+    bool openOutput(const QString &outputPath);
+    bool openEncoder();
+    bool seekToStart();             // 跳到起点之前的关键帧 (起点所在GOP的前导帧也能解码)
+    
+    bool processVideoPacket(AVPacket *packet);
+    bool copyAudioPacket(AVPacket *packet);
+    bool finishGop();               // 缓存的GOP完整时直接复制，否则重新编码其中区间内的帧
+    bool finishTail();              // 复制终点之前的最后一个GOP，终点处关键帧的前导帧在区间内时解码后重新编码
+    bool finishVideo();             // 结束时处理剩余的帧并冲刷仍打开的编码器
+    
+    bool decodePacket(const AVPacket *packet);  // 解码并编码区间内的帧 (nullptr表示冲刷解码器)
+    bool finishEdge();              // 冲刷解码器和编码器，结束一段重新编码
+    bool writeEncodedPackets();
+    bool writeVideoPacket(AVPacket *packet);
+    void clearGop();
+    void cleanup();
+
+private:
+    AVFormatContext *m_inputContext;
+    AVFormatContext *m_outputContext;
+    AVCodecContext *m_decoderContext;
+    AVCodecContext *m_encoderContext;
+    AVStream *m_videoOutput;
+    AVStream *m_audioOutput;
+    AVPacket *m_packet;
+    AVFrame *m_frame;
+    int m_videoStreamIndex;
+    int m_audioStreamIndex;
+    
+    // 裁剪区间 (各流时间基)
+    int64_t m_startTs;
+    int64_t m_endTs;
+    int64_t m_audioStartTs;
+    int64_t m_audioEndTs;
+    
+    // 视频处理状态
+    bool m_inHead;                  // 还没遇到起点之后的第一个关键帧
+    bool m_leadingPending;          // 正在把复制起点关键帧的前导帧 (开放GOP) 送入头部的解码器
+    bool m_tailPending;             // 已缓存终点处的关键帧，正在缓存它的前导帧
+    size_t m_tailIndex;             // 终点处的关键帧在m_gop中的位置
+    bool m_videoDone;
+    bool m_audioDone;
+    std::vector<AVPacket *> m_gop;  // 缓存的当前GOP，遇到下一个关键帧时决定复制还是重新编码
+    bool m_gopInside;               // 缓存的GOP中所有帧都在终点之前
+    int64_t m_copyStartPts;         // 第一个复制的关键帧，之前显示的帧 (含前导帧) 由重新编码的部分提供
+    int64_t m_reorderDelay;         // 源视频流的解码时间戳相对显示时间戳的延迟，读到第一个视频数据包时确定
+    int64_t m_lastDts;
+    int64_t m_lastPts;              // 已写入的最大显示时间戳，重新编码时跳过已写入的帧
+    
+    // 码流格式: 重新编码的数据包转换为与源流一致的格式
+    int m_nalLengthSize;            // 长度前缀字节数 (mp4/mkv中的H.264/HEVC)，0表示起始码格式
+    std::vector<uint8_t> m_parameterSets;   // 源流的参数集，重新编码之后的第一个复制包前插入
+    bool m_needParameterSets;
+    
+    std::function<void(int)> m_progressCallback;
+    int m_lastProgress;
+    Stats m_stats;
+};
+
+#endif // STREAMTRIMMER_H
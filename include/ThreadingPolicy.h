@@ -0,0 +1,67 @@
+#ifndef THREADINGPOLICY_H
+#define THREADINGPOLICY_H
+
+#include <atomic>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief 线程策略
+ * 
+ * 统一分配CPU核心: 先按同时运行的任务数平分核心，再按权重分给任务中
+ * 同时工作的各阶段 (解码 1 : 格式转换 2 : 编码 2)。单个任务时用满所有核心，
+ * 多任务并发时避免线程数超过核心数。
+ * 
+ * 可通过环境变量覆盖: VIDEOEDITOR_CORES, VIDEOEDITOR_JOBS,
+ * VIDEOEDITOR_DECODE_THREADS, VIDEOEDITOR_CONVERT_THREADS, VIDEOEDITOR_ENCODE_THREADS
+ */
+class ThreadingPolicy
+{
+public:
+    enum Stage {
+        Decode  = 0x1,      // 视频解码
+        Convert = 0x2,      // 像素转换、图片压缩/读取
+        Encode  = 0x4       // 视频编码
+    };
+    
+    // 常用流水线组合
+    static constexpr int SplitStages = Decode | Convert;
+    static constexpr int MergeStages = Convert | Encode;
+    static constexpr int TranscodeStages = Decode | Encode;
+    
+    static ThreadingPolicy &instance();
+
+    // 可用核心数 (0 表示自动检测)
+    int coreCount() const;
+    void setCoreCount(int count);
+    
+    // 同时运行的任务数
+    int concurrentJobs() const { return m_concurrentJobs; }
+    void setConcurrentJobs(int jobs);
+    
+    // 手动指定某阶段的线程数 (0 表示按预算自动分配)
+    void setThreadCount(Stage stage, int count);
+    
+    // 在给定的并发阶段组合中，某阶段应使用的线程数
+    int threadCount(Stage stage, int activeStages) const;
+    
+    // 为编解码器上下文设置 thread_count / thread_type (须在 avcodec_open2 之前调用)
+    void apply(AVCodecContext *context, Stage stage, int activeStages) const;
+    
+    // 从环境变量读取覆盖配置
+    void loadFromEnvironment();
+
+private:
+    ThreadingPolicy();
+    static int stageWeight(Stage stage);
+    static int stageSlot(Stage stage);
+
+private:
+    std::atomic<int> m_coreCount;
+    std::atomic<int> m_concurrentJobs;
+    std::atomic<int> m_stageThreads[3];
+};
+
+#endif // THREADINGPOLICY_H
@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief 阶段耗时追踪
+ *
+ * 在解复用、解码、格式转换、编码、写盘等阶段放置TraceScope，
+ * 开启后记录每个区间的起止时间，停止时导出为Chrome trace-event JSON
+ * (可用 chrome://tracing 或 https://ui.perfetto.dev 打开)。
+ * 未开启时TraceScope只读取一次原子标志，不取时间也不加锁。
+ * 每个线程写入自己的缓冲区，记录时不与其他线程竞争。
+ */
+class Trace
+{
+public:
+    // 开始记录 (清空之前的记录)，stop时写入outputPath
+    static void start(const QString &outputPath);
+
+    // 停止记录并写出JSON文件，未开启或写入失败时返回false
+    static bool stop();
+
+    // 环境变量VIDEOEDITOR_TRACE设置为输出文件路径时开始记录
+    static void startFromEnvironment();
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // 记录一个已结束的区间 (name须为字符串常量)，未开启时忽略
+    static void record(const char *name, int64_t startNs, int64_t endNs);
+
+    // 单调时钟 (纳秒)
+    static int64_t nowNs();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+/**
+ * @brief 作用域追踪区间
+ *
+ * 构造时记录开始时间，析构时记录结束时间
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name)
+        , m_startNs(Trace::isEnabled() ? Trace::nowNs() : -1)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_startNs >= 0) {
+            Trace::record(m_name, m_startNs, Trace::nowNs());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    int64_t m_startNs;
+};
+
+#endif // TRACE_H
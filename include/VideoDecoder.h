@@ -4,11 +4,13 @@
 #include <QString>
 #include <QImage>
 #include <vector>
+#include <functional>
+#include "FrameConverter.h"
+#include "KeyframeIndex.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libswscale/swscale.h>
 #include <libavutil/imgutils.h>
 }
 
@@ -22,7 +24,7 @@ class VideoDecoder
 public:
     VideoDecoder();
     ~VideoDecoder();
-
+    
     // 打开视频文件
     bool open(const QString &filePath);
     
@@ -32,32 +34,93 @@ public:
     // 解码下一帧
     bool decodeNextFrame(QImage &frame);
     
+    // 批量解码: 最多解码maxFrames帧追加到frames末尾，返回本批帧数 (0表示已全部解码)
+    int decodeFrames(std::vector<QImage> &frames, int maxFrames);
+    
+    // 回调形式: 每解码出一帧调用一次 (不做RGB转换)，回调返回false时停止
+    // maxFrames < 0 表示解码到文件结束，返回回调的帧数
+    int decodeFrames(const std::function<bool(const AVFrame *)> &callback, int maxFrames = -1);
+    
+    // 将解码帧转换为RGB图像
+    QImage convertFrame(const AVFrame *frame) { return avFrameToQImage(frame); }
+    
+    // 设置音频数据包回调 (解码过程中读到的音频包交给回调，实现一次解复用)
+    void setAudioPacketHandler(std::function<void(AVPacket *)> handler) { m_audioPacketHandler = std::move(handler); }
+    
     // 获取视频信息
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
     double getFrameRate() const { return m_frameRate; }
+    AVRational getFrameRateRational() const { return m_frameRateRational; }     // 精确帧率 (编码时使用)
     int64_t getTotalFrames() const { return m_totalFrames; }
+    qint64 getDuration() const { return m_duration; }
+    AVStream *getAudioStream() const;
     
     // 重置到开始位置
     bool reset();
+    
+    // 跳转到指定时间 (毫秒) 之前最近的关键帧，之后解码的帧从该关键帧开始
+    bool seek(qint64 milliseconds);
+    
+    // 精确跳转: 跳到目标之前最近的关键帧并向后解码 (丢弃的帧不做转换)，
+    // 之后解码的第一帧即为显示时间覆盖该时间点的帧。目标在当前位置之后的同一GOP内时不重新跳转
+    bool seekToFrame(qint64 milliseconds);
+    
+    // 关键帧索引 (打开时读取容器索引，容器没有索引时可调用buildKeyframeIndex扫描；
+    // 流有B帧时容器索引不含显示时间，第一次精确跳转时读取各关键帧的数据包)
+    const KeyframeIndex &keyframeIndex() const { return m_keyframeIndex; }
+    bool buildKeyframeIndex();
+    
+    // 解码帧相对视频开始的时间 (毫秒)，无时间戳时返回-1
+    qint64 frameTimestamp(const AVFrame *frame) const;
+    
+    // 解码帧的时长 (毫秒)，帧中没有时长时按帧率计算
+    qint64 frameDuration(const AVFrame *frame) const;
+    
+    // 设置解码器所在流水线中同时工作的阶段 (ThreadingPolicy::Stage组合)，须在open之前调用
+    void setPipelineStages(int stages) { m_pipelineStages = stages; }
+    
+    // 指定解码线程数 (0表示由ThreadingPolicy分配)，多个解码器并行时使用，须在open之前调用
+    void setThreadCount(int count) { m_threadCount = count; }
+    
+    // 只解码关键帧: 非关键帧的数据包不送入解码器，解码器也丢弃非关键帧 (skip_frame)
+    void setKeyframesOnly(bool enabled);
+    bool keyframesOnly() const { return m_keyframesOnly; }
+    
+    // 设置RGB图像复用池大小 (调用方同时持有的帧越多，需要越大)
+    void setImagePoolSize(int size) { m_converter.setPoolSize(size); }
 
 private:
     bool initDecoder();
     void cleanup();
-    QImage avFrameToQImage(AVFrame *frame);
+    bool receiveNextFrame();
+    QImage avFrameToQImage(const AVFrame *frame);
 
 private:
     AVFormatContext *m_formatContext;
     AVCodecContext *m_codecContext;
-    SwsContext *m_swsContext;
+    FrameConverter m_converter;
     AVFrame *m_frame;
     AVPacket *m_packet;
     
     int m_videoStreamIndex;
+    int m_audioStreamIndex;
+    bool m_inputEof;                // 已读完输入并向解码器发送了冲刷请求
+    bool m_hasPendingFrame;         // seekToFrame停在的目标帧，下次解码时直接返回
+    bool m_keyframesOnly;
+    qint64 m_lastFrameMs;           // 最近解码出的帧的时间 (毫秒)，-1表示刚打开或刚跳转
+    KeyframeIndex m_keyframeIndex;
+    bool m_containerIndexed;        // 容器自带关键帧索引
+    int m_pipelineStages;
+    int m_threadCount;
     int m_width;
     int m_height;
     double m_frameRate;
+    AVRational m_frameRateRational;
     int64_t m_totalFrames;
+    qint64 m_duration;              // 总时长 (毫秒)
+    
+    std::function<void(AVPacket *)> m_audioPacketHandler;
     
     QString m_filePath;
 };
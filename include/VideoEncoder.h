@@ -3,6 +3,8 @@
 
 #include <QString>
 #include <QImage>
+#include <memory>
+#include "EncodeProfile.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -12,6 +14,8 @@ extern "C" {
 #include <libavutil/opt.h>
 }
 
+class AudioTrackWriter;
+
 /**
  * @brief 视频编码器类
  * 
@@ -23,7 +27,17 @@ public:
     VideoEncoder();
     ~VideoEncoder();
 
-    // 初始化编码器
+    // 设置音频源 (须在open之前调用)，音频与视频交错写入同一文件
+    bool setAudioSource(const QString &audioPath);
+    
+    // 设置编码配置 (默认throughput)，须在open之前调用
+    void setProfile(const EncodeProfile &profile) { m_profile = profile; }
+    const EncodeProfile &profile() const { return m_profile; }
+    
+    // 初始化编码器 (bitRate在配置使用平均码率且未指定码率时使用)
+    bool open(const QString &outputPath, int width, int height, AVRational frameRate, int64_t bitRate = 2000000);
+    
+    // 帧率按有理数近似 (29.97等非整数帧率优先使用上面的形式)
     bool open(const QString &outputPath, int width, int height, double frameRate, int64_t bitRate = 2000000);
     
     // 关闭编码器
@@ -32,33 +46,52 @@ public:
     // 编码一帧
     bool encodeFrame(const QImage &frame);
     
+    // 编码一帧解码得到的帧 (或调用方填好data/linesize的帧): 像素格式和尺寸与编码器相同时
+    // 不经过RGB也不复制，引用计数的帧直接增加引用交给编码器；否则用sws_scale转换
+    // 帧原有的pts和帧类型不使用，按编码顺序重新编号
+    bool encodeFrame(const AVFrame *frame);
+    
     // 结束编码
     bool finalize();
     
     // 启用硬件加速
     void setHardwareAcceleration(bool enable);
+    
+    // 设置编码器所在流水线中同时工作的阶段 (ThreadingPolicy::Stage组合)，须在open之前调用
+    void setPipelineStages(int stages) { m_pipelineStages = stages; }
+    
+    // 指定编码线程数 (0表示由配置或ThreadingPolicy分配)，多个编码器并行时使用，须在open之前调用
+    void setThreadCount(int count) { m_threadCount = count; }
 
 private:
     bool initEncoder();
     void cleanup();
-    AVFrame* qImageToAVFrame(const QImage &image);
+    bool writePackets();        // 取出编码器输出的全部数据包并写入文件
+    bool sendFrame(AVFrame *frame);     // 设置pts后送入编码器，写出数据包和对应的音频
+    bool scaleToFrame(const uint8_t *const data[], const int linesize[], int width, int height, AVPixelFormat format);
 
 private:
     AVFormatContext *m_formatContext;
     AVCodecContext *m_codecContext;
     SwsContext *m_swsContext;
     AVStream *m_videoStream;
-    AVFrame *m_frame;
+    AVFrame *m_frame;           // 转换后的帧
+    AVFrame *m_inputFrame;      // 直接送入编码器的帧 (引用调用方的缓冲区)
     AVPacket *m_packet;
     
     QString m_outputPath;
     int m_width;
     int m_height;
-    double m_frameRate;
+    AVRational m_frameRate;
     int64_t m_bitRate;
     int64_t m_frameCount;
     
+    EncodeProfile m_profile;
     bool m_useHardwareAccel;
+    int m_pipelineStages;
+    int m_threadCount;
+    
+    std::unique_ptr<AudioTrackWriter> m_audioWriter;
 };
 
 #endif // VIDEOENCODER_H
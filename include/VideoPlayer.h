@@ -8,6 +8,12 @@
 #include <QWaitCondition>
 #include <atomic>
 #include <memory>
+#include "FrameCache.h"
+#include "FrameConverter.h"
+#include "FrameMailbox.h"
+#include "FrameQueue.h"
+#include "KeyframeIndex.h"
+#include "PlaybackClock.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -16,10 +22,18 @@ extern "C" {
 #include <libavutil/imgutils.h>
 }
 
+class AudioOutput;
+class VideoDecoder;
+
 /**
  * @brief 视频播放器类
  * 
- * 在后台线程中解码视频，并通过信号发送帧到UI线程
+ * 解码线程把带时间戳的解码帧放入有界队列，显示线程按播放主时钟
+ * 在每帧的显示时间取出并发送到UI线程，落后的帧直接丢弃 (不做RGB转换)。
+ * 有音频时音频输出校正主时钟，实现音画同步。
+ * 跳转时按关键帧索引跳到目标之前最近的关键帧，向后解码到目标帧，中间的帧不放入队列。
+ * 解码过的帧保存在帧缓存中，暂停时预取播放位置前后的GOP，来回拖动和逐帧跳转直接由缓存显示。
+ * 显示帧经无锁三缓冲信箱交给UI线程，frameReady只是通知，UI来不及处理时只保留最新的一帧
  */
 class VideoPlayer : public QObject
 {
@@ -28,7 +42,7 @@ class VideoPlayer : public QObject
 public:
     explicit VideoPlayer(QObject *parent = nullptr);
     ~VideoPlayer();
-
+    
     // 播放控制
     bool openFile(const QString &filePath);
     void play();
@@ -36,55 +50,155 @@ public:
     void stop();
     void seek(qint64 milliseconds);
     
+    // 拖动进度条: 拖动期间暂停播放，连续的跳转请求只处理最新的一个，
+    // 先显示目标之前最近的关键帧，再向后解码到精确的帧 (有新请求时中止)
+    void beginScrub();
+    void scrubTo(qint64 milliseconds);
+    void endScrub(qint64 milliseconds);
+    bool isScrubbing() const { return m_scrubbing; }
+    
+    // 跳转延迟统计: 从跳转请求到画面显示 (毫秒)
+    struct SeekLatency {
+        int count = 0;
+        qint64 lastMs = 0;
+        qint64 maxMs = 0;
+        qint64 totalMs = 0;
+    };
+    SeekLatency previewLatency() const;     // 到显示预览关键帧
+    SeekLatency exactLatency() const;       // 到显示目标帧
+    
+    // 解码帧缓存 (默认256MB，可用环境变量VIDEOEDITOR_FRAME_CACHE_MB覆盖)
+    void setFrameCacheBudget(int64_t bytes) { m_frameCache.setBudget(bytes); }
+    FrameCache::Stats frameCacheStats() const { return m_frameCache.stats(); }
+    
     // 获取视频信息
     qint64 duration() const { return m_duration; }
     qint64 position() const { return m_position; }
     bool isPlaying() const { return m_isPlaying; }
     
+    // 因显示不及时而丢弃的帧数
+    int64_t droppedFrames() const { return m_droppedFrames; }
+    
+    // 取走最新的显示帧 (UI线程在收到frameReady后调用)，没有新帧时返回false
+    bool takeFrame(QImage &frame) { return m_mailbox.take(frame); }
+    
+    // 交给UI线程的帧统计: 发布数、未被取走就被覆盖的帧数、取走数
+    FrameMailbox::Stats displayStats() const { return m_mailbox.stats(); }
+    
     // 获取视频详细信息
     QString getVideoInfo() const;
+    
+    // 当前帧 (原始分辨率，用于保存封面；显示用的帧已缩放到显示尺寸)
     QImage getCurrentFrame();
+    
+    // 显示区域的物理像素尺寸: 帧在显示线程中直接缩放到该尺寸以内并转换为RGB32，
+    // 界面只需1:1绘制。无效尺寸表示按原始分辨率输出。可在任意线程调用
+    void setDisplaySize(const QSize &size);
 
 signals:
-    void frameReady(const QImage &frame);       // 新帧就绪
+    void frameReady();                          // 新帧就绪 (用takeFrame取走，未处理时不会重复发送)
     void positionChanged(qint64 position);      // 播放位置改变
     void durationChanged(qint64 duration);      // 总时长改变
     void videoInfoReady(const QString &info);   // 视频信息就绪
+    void playbackFinished();                    // 播放到结尾
     void error(const QString &errorMsg);        // 错误信息
 
 private:
-    void decodeLoop();              // 解码循环 (在工作线程中运行)
+    void decodeLoop();              // 解码循环 (在解码线程中运行)
+    void presentLoop();             // 显示循环 (在显示线程中运行)
     bool initDecoder();             // 初始化解码器
+    bool initAudio();               // 初始化音频解码器和输出
     void cleanup();                 // 清理资源
-    QImage frameToQImage(AVFrame *frame);  // 将AVFrame转换为QImage
+    bool convertFrame(AVFrame *frame, QImage &image);  // 将AVFrame转换为显示尺寸的QImage
+    void publishFrame(qint64 ptsMs);    // 发布信箱中写好的帧，必要时通知UI线程
+    
+    void startThreads();            // 启动解码和显示线程
+    void stopThreads();             // 停止并等待线程结束
+    void handleSeek(int &serial);   // 在解码线程中执行跳转
+    void seekDemuxer(qint64 target);    // 解复用器跳到目标之前的关键帧并清空解码器
+    bool receiveVideoFrames(AVFrame *frame, int serial);  // 取出解码帧放入队列
+    void decodeAudioPacket(const AVPacket *packet, AVFrame *frame);
+    qint64 frameTimeMs(const AVFrame *frame, AVRational timeBase) const;
+    bool waitUntilDue(qint64 ptsMs, int serial);  // 等到帧的显示时间，期间跳转、停止或请求重绘则返回false
+    bool redrawCurrentFrame();      // 按当前显示尺寸从帧缓存重新显示当前帧 (在显示线程中执行)
+    void wakeThreads();             // 唤醒等待中的解码/显示线程
+    void startIndexScan();          // 容器没有索引时在后台扫描关键帧
+    void recordSeekLatency(const PlaybackFrame &item);
+    void prefetchLoop();            // 预取循环 (在预取线程中运行)
+    void prefetchAround(VideoDecoder &decoder, qint64 centerMs, int request);
+    void schedulePrefetch(qint64 centerMs);
+    void stopIndexScan();
 
 private:
     // FFmpeg 组件
     AVFormatContext *m_formatContext;
     AVCodecContext *m_codecContext;
-    SwsContext *m_swsContext;
+    AVCodecContext *m_audioCodecContext;
+    FrameConverter m_converter;
     int m_videoStreamIndex;
+    int m_audioStreamIndex;
     
     // 视频信息
     qint64 m_duration;              // 总时长 (毫秒)
-    qint64 m_position;              // 当前位置 (毫秒)
+    std::atomic<qint64> m_position; // 当前位置 (毫秒)
     int m_width;                    // 视频宽度
     int m_height;                   // 视频高度
     double m_frameRate;             // 帧率
     int64_t m_bitRate;              // 码率
     int64_t m_totalFrames;          // 总帧数
     
+    // 播放时钟、帧队列和音频输出
+    PlaybackClock m_clock;
+    FrameQueue m_frameQueue;
+    std::unique_ptr<AudioOutput> m_audioOutput;
+    
     // 线程控制
-    std::unique_ptr<QThread> m_workerThread;
+    std::unique_ptr<QThread> m_decodeThread;
+    std::unique_ptr<QThread> m_presentThread;
     QMutex m_mutex;
-    QWaitCondition m_condition;
+    QWaitCondition m_condition;     // 唤醒等待中的线程 (暂停/跳转/停止)
     std::atomic<bool> m_isPlaying;
     std::atomic<bool> m_shouldStop;
     std::atomic<bool> m_seekRequested;
     std::atomic<qint64> m_seekTarget;
+    std::atomic<int> m_serial;      // 每次跳转加一，旧序号的帧不再显示
+    std::atomic<bool> m_decodeEof;  // 当前序号的帧已全部解码
+    std::atomic<int64_t> m_droppedFrames;
+    qint64 m_nextVideoPts;          // 无时间戳的帧按上一帧推算 (仅解码线程使用)
+    qint64 m_discardBeforeMs;       // 跳转后结束时间早于此的帧直接丢弃 (仅解码线程使用)
+    bool m_previewPending;          // 跳转后的第一帧作为预览立即显示 (仅解码线程使用)
+    qint64 m_gopStartMs;            // 当前GOP关键帧的时间 (仅解码线程使用)
+    bool m_seekDeferred;            // 跳转由缓存满足，开始播放时才真正跳转 (仅解码线程使用)
+    qint64 m_deferredSeekTarget;
+    
+    // 帧缓存和预取
+    FrameCache m_frameCache;
+    std::unique_ptr<QThread> m_prefetchThread;
+    std::atomic<qint64> m_prefetchCenter;
+    std::atomic<int> m_prefetchRequest;
+    qint64 m_videoStartOffsetMs;    // 视频流起点相对文件起点的偏移
+    
+    // 显示尺寸
+    std::atomic<int> m_displayWidth;
+    std::atomic<int> m_displayHeight;
+    std::atomic<bool> m_redrawRequested;    // 暂停时显示尺寸改变，由显示线程重新转换当前帧
+    FrameMailbox m_mailbox;         // 显示线程写入，UI线程取走
+    
+    // 拖动进度条
+    std::atomic<bool> m_scrubbing;
+    bool m_resumeAfterScrub;        // 拖动结束后继续播放
+    std::atomic<int64_t> m_seekRequestNs;   // 最近一次跳转请求的时间
+    int m_latencySerial;            // 已记录预览/精确延迟的跳转序号 (仅显示线程使用)
+    bool m_exactRecorded;
+    mutable QMutex m_statsMutex;
+    SeekLatency m_previewLatency;
+    SeekLatency m_exactLatency;
+    
+    // 关键帧索引
+    KeyframeIndex m_keyframeIndex;
+    std::unique_ptr<QThread> m_indexThread;
+    std::atomic<bool> m_indexCancel;
     
-    // 当前帧
-    QImage m_currentFrame;
     QString m_filePath;
 };
 
@@ -2,17 +2,38 @@
 #define VIDEOPROCESSOR_H
 
 #include <QObject>
+#include <QJsonObject>
+#include <QSize>
 #include <QString>
+#include <QStringList>
 #include <QThread>
+#include <functional>
 #include <memory>
+#include <vector>
+#include "EncodeProfile.h"
+#include "FrameSink.h"
 
 class VideoDecoder;
 class VideoEncoder;
+class SplitManifest;
+
+// 拆分时的抽帧方式 (可组合)，默认提取全部帧
+struct FrameSampling
+{
+    int everyNth = 1;               // 每N帧取一帧
+    qint64 intervalMs = 0;          // 每隔一段时间取一帧，0表示不按时间取样
+    qint64 startMs = 0;             // 只提取 [startMs, endMs) 内的帧和音频
+    qint64 endMs = 0;               // 0表示到结尾
+    bool keyframesOnly = false;     // 只提取关键帧 (非关键帧不解码)
+    
+    bool isFull() const { return everyNth <= 1 && intervalMs <= 0 && startMs <= 0 && endMs <= 0 && !keyframesOnly; }
+};
 
 /**
  * @brief 视频处理器类
  * 
- * 在后台线程中执行视频拆分和合成任务
+ * 在后台线程中执行视频拆分和合成任务，
+ * 也提供在调用线程中直接执行的同步接口 (供命令行程序使用)
  */
 class VideoProcessor : public QObject
 {
@@ -28,22 +49,67 @@ public:
     // 合成图片序列 + 音频为视频
     void mergeVideo(const QString &imageDir, const QString &audioPath, const QString &outputPath);
     
+    // 裁剪 [startMs, endMs) 片段: 完整的GOP直接复制，只重新编码两端不完整的GOP
+    void trimVideo(const QString &videoPath, const QString &outputPath, qint64 startMs, qint64 endMs);
+    
+    // 按顺序拼接多个片段: 参数兼容的片段直接复制数据包，不兼容的片段按第一个片段的参数重新编码
+    void concatVideos(const QStringList &inputPaths, const QString &outputPath);
+    
     // 保存封面
-    void saveCover(const QImage &frame, const QString &outputPath);
+    bool saveCover(const QImage &frame, const QString &outputPath);
+    
+    // 同步接口: 在调用线程中执行，进度和结果同样通过信号发出，返回是否成功
+    bool runSplit(const QString &videoPath, const QString &outputDir);
+    bool runMerge(const QString &imageDir, const QString &audioPath, const QString &outputPath);
+    bool runCover(const QString &videoPath, qint64 positionMs, const QString &outputPath);
+    bool runTranscode(const QString &inputPath, const QString &outputPath);
+    bool runTrim(const QString &inputPath, const QString &outputPath, qint64 startMs, qint64 endMs);
+    bool runConcat(const QStringList &inputPaths, const QString &outputPath);
+    
+    // 设置拆分时帧的输出格式 (默认jpeg)
+    void setFrameSinkOptions(const FrameSink::Options &options) { m_frameSinkOptions = options; }
+    const FrameSink::Options &frameSinkOptions() const { return m_frameSinkOptions; }
+    
+    // 设置拆分时的抽帧方式 (默认提取全部帧)
+    void setFrameSampling(const FrameSampling &sampling) { m_sampling = sampling; }
+    const FrameSampling &frameSampling() const { return m_sampling; }
+    
+    // 续拆: 校验上次拆分的清单和帧文件，从最后一个有效帧之后继续 (只支持每帧一个文件的格式)
+    void setResumeSplit(bool resume) { m_resumeSplit = resume; }
+    
+    // 并行拆分的段数: 提取全部帧时按关键帧把时间轴分段，每段由单独的解码器并行处理
+    // (0表示按核心数自动选择，1表示不分段)
+    void setSplitWorkers(int workers) { m_splitWorkers = workers; }
+    
+    // 合成时分段并行编码的段数: 图片序列切成若干段 (每段从关键帧开始)，由多个编码器
+    // 同时编码后直接拼接 (0表示按核心数自动选择，1表示不分段)
+    void setMergeWorkers(int workers) { m_mergeWorkers = workers; }
+    
+    // 设置合成和转码的编码配置 (默认throughput)
+    void setEncodeProfile(const EncodeProfile &profile) { m_encodeProfile = profile; }
+    const EncodeProfile &encodeProfile() const { return m_encodeProfile; }
 
 signals:
     void progressUpdated(int percentage);               // 进度更新
+    void streamProgressUpdated(int videoPercentage, int audioPercentage);  // 拆分时各流进度
     void finished(bool success, const QString &message); // 处理完成
     void error(const QString &errorMsg);                // 错误信息
 
 private slots:
     void processSplit();    // 执行拆分任务
     void processMerge();    // 执行合成任务
+    void processTrim();     // 执行裁剪任务
+    void processConcat();   // 执行拼接任务
 
 private:
-    bool extractAudio(const QString &videoPath, const QString &audioPath);
-    bool extractFrames(const QString &videoPath, const QString &framesDir);
+    bool extractFrames(VideoDecoder &decoder, const QString &framesDir, bool seekBetweenSamples, SplitManifest *manifest);
+    bool extractFramesParallel(const QString &videoPath, const QString &framesDir, const std::vector<qint64> &rangeStarts,
+                               qint64 durationMs, SplitManifest *manifest, const std::function<void()> &concurrentWork);
+    QJsonObject splitManifestHeader(const QString &videoPath) const;
+    void updateSplitProgress(int videoPercentage, int audioPercentage);
     bool mergeFramesAndAudio(const QString &imageDir, const QString &audioPath, const QString &outputPath);
+    bool encodeChunked(const QStringList &imagePaths, const QSize &size, double frameRate,
+                       const QString &audioPath, const QString &outputPath, int chunkCount);
 
 private:
     std::unique_ptr<QThread> m_workerThread;
@@ -54,6 +120,20 @@ private:
     QString m_imageDir;
     QString m_audioPath;
     QString m_outputPath;
+    qint64 m_trimStartMs;
+    qint64 m_trimEndMs;
+    QStringList m_inputPaths;
+    
+    FrameSink::Options m_frameSinkOptions;
+    FrameSampling m_sampling;
+    bool m_resumeSplit;
+    int m_splitWorkers;
+    int m_mergeWorkers;
+    EncodeProfile m_encodeProfile;
+    
+    // 拆分进度 (视频流/音频流)
+    int m_videoProgress;
+    int m_audioProgress;
 };
 
 #endif // VIDEOPROCESSOR_H
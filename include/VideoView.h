@@ -0,0 +1,43 @@
+#ifndef VIDEOVIEW_H
+#define VIDEOVIEW_H
+
+#include <QWidget>
+#include <QImage>
+
+/**
+ * @brief 视频显示控件
+ * 
+ * 播放器在工作线程中已把帧缩放到本控件的显示尺寸并转换为RGB32，
+ * 这里只负责居中绘制 (1:1 拷贝)。控件尺寸变化后、新尺寸的帧到达前，
+ * 旧帧临时按快速缩放绘制
+ */
+class VideoView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit VideoView(QWidget *parent = nullptr);
+    
+    // 显示一帧 (只保存引用并请求重绘)
+    void setFrame(const QImage &frame);
+    void clearFrame();
+    
+    // 没有画面时显示的提示文字
+    void setPlaceholderText(const QString &text);
+    
+    // 显示区域的物理像素尺寸 (已乘以设备像素比)
+    QSize displaySize() const;
+
+signals:
+    void displaySizeChanged(const QSize &size);    // 显示区域尺寸改变
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    QImage m_frame;
+    QString m_placeholderText;
+};
+
+#endif // VIDEOVIEW_H
@@ -0,0 +1,274 @@
+#include "AudioOutput.h"
+#include "PlaybackClock.h"
+#include <QAudioSink>
+#include <QMediaDevices>
+#include <QAudioDevice>
+#include <QMutexLocker>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+namespace {
+// 环形缓冲区容量 (微秒)
+const qint64 kBufferDurationUs = 2000000;
+}
+
+AudioOutput::AudioOutput(PlaybackClock *clock, QObject *parent)
+    : QIODevice(parent)
+    , m_clock(clock)
+    , m_swrContext(nullptr)
+    , m_readPos(0)
+    , m_size(0)
+    , m_bufferStartUs(0)
+    , m_minPtsMs(0)
+    , m_sinkLatencyMs(0)
+    , m_inputSampleRate(0)
+    , m_aborted(false)
+{
+}
+
+AudioOutput::~AudioOutput()
+{
+    close();
+}
+
+bool AudioOutput::open(const AVCodecContext *decoderContext)
+{
+    close();
+    
+    QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    if (device.isNull() || decoderContext->sample_rate <= 0) {
+        return false;
+    }
+    
+    // 优先使用源采样率的16位立体声，设备不支持时用设备首选格式
+    QAudioFormat format;
+    format.setSampleRate(decoderContext->sample_rate);
+    format.setChannelCount(qBound(1, decoderContext->ch_layout.nb_channels, 2));
+    format.setSampleFormat(QAudioFormat::Int16);
+    if (!device.isFormatSupported(format)) {
+        format = device.preferredFormat();
+    }
+    
+    AVSampleFormat sampleFormat;
+    switch (format.sampleFormat()) {
+    case QAudioFormat::UInt8:
+        sampleFormat = AV_SAMPLE_FMT_U8;
+        break;
+    case QAudioFormat::Int16:
+        sampleFormat = AV_SAMPLE_FMT_S16;
+        break;
+    case QAudioFormat::Int32:
+        sampleFormat = AV_SAMPLE_FMT_S32;
+        break;
+    case QAudioFormat::Float:
+        sampleFormat = AV_SAMPLE_FMT_FLT;
+        break;
+    default:
+        return false;
+    }
+    
+    AVChannelLayout outputLayout;
+    av_channel_layout_default(&outputLayout, format.channelCount());
+    int ret = swr_alloc_set_opts2(&m_swrContext,
+                                  &outputLayout, sampleFormat, format.sampleRate(),
+                                  &decoderContext->ch_layout, decoderContext->sample_fmt, decoderContext->sample_rate,
+                                  0, nullptr);
+    av_channel_layout_uninit(&outputLayout);
+    
+    if (ret < 0 || swr_init(m_swrContext) < 0) {
+        swr_free(&m_swrContext);
+        return false;
+    }
+    
+    m_format = format;
+    m_inputSampleRate = decoderContext->sample_rate;
+    m_buffer.assign(format.bytesForDuration(kBufferDurationUs), 0);
+    m_readPos = 0;
+    m_size = 0;
+    m_bufferStartUs = 0;
+    m_minPtsMs = 0;
+    m_aborted = false;
+    
+    m_sink = std::make_unique<QAudioSink>(device, format);
+    return QIODevice::open(QIODevice::ReadOnly);
+}
+
+void AudioOutput::close()
+{
+    abort();
+    
+    if (m_sink) {
+        m_sink->stop();
+        m_sink.reset();
+    }
+    
+    if (m_swrContext) {
+        swr_free(&m_swrContext);
+    }
+    
+    QIODevice::close();
+}
+
+void AudioOutput::start()
+{
+    if (!m_sink) {
+        return;
+    }
+    
+    if (m_sink->state() == QAudio::SuspendedState) {
+        m_sink->resume();
+        return;
+    }
+    
+    m_sink->start(this);
+    
+    // 交给设备的数据要等设备缓冲区中的数据播放完才能听到
+    QMutexLocker locker(&m_mutex);
+    m_sinkLatencyMs = m_format.durationForBytes(m_sink->bufferSize()) / 1000;
+}
+
+void AudioOutput::suspend()
+{
+    if (m_sink) {
+        m_sink->suspend();
+    }
+}
+
+void AudioOutput::stop()
+{
+    if (m_sink) {
+        m_sink->stop();
+    }
+}
+
+bool AudioOutput::writeFrame(const AVFrame *frame, qint64 ptsMs)
+{
+    if (!m_swrContext || frame->nb_samples <= 0) {
+        return false;
+    }
+    
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_aborted) {
+            return false;
+        }
+        
+        // 跳转目标之前的音频直接丢弃
+        qint64 durationMs = (qint64)frame->nb_samples * 1000 / m_inputSampleRate;
+        if (ptsMs >= 0 && ptsMs + durationMs <= m_minPtsMs) {
+            return true;
+        }
+    }
+    
+    // 重采样为设备格式 (交错存储)
+    int maxSamples = swr_get_out_samples(m_swrContext, frame->nb_samples);
+    size_t capacity = (size_t)maxSamples * m_format.bytesPerFrame();
+    if (m_convertBuffer.size() < capacity) {
+        m_convertBuffer.resize(capacity);
+    }
+    
+    uint8_t *output = m_convertBuffer.data();
+    int samples = swr_convert(m_swrContext, &output, maxSamples,
+                              (const uint8_t **)frame->extended_data, frame->nb_samples);
+    if (samples <= 0) {
+        return samples == 0;
+    }
+    
+    const char *source = (const char *)m_convertBuffer.data();
+    size_t remaining = (size_t)samples * m_format.bytesPerFrame();
+    
+    QMutexLocker locker(&m_mutex);
+    
+    // 缓冲区为空时以该帧的时间戳为起点 (音频连续，之后按字节数推算)
+    if (m_size == 0 && ptsMs >= 0) {
+        m_bufferStartUs = ptsMs * 1000;
+    }
+    
+    while (remaining > 0) {
+        while (m_size == m_buffer.size() && !m_aborted) {
+            m_spaceAvailable.wait(&m_mutex);
+        }
+        if (m_aborted) {
+            return false;
+        }
+        
+        size_t writePos = (m_readPos + m_size) % m_buffer.size();
+        size_t chunk = qMin(remaining, qMin(m_buffer.size() - m_size, m_buffer.size() - writePos));
+        memcpy(m_buffer.data() + writePos, source, chunk);
+        
+        m_size += chunk;
+        source += chunk;
+        remaining -= chunk;
+    }
+    
+    return true;
+}
+
+void AudioOutput::flush(qint64 startMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_readPos = 0;
+    m_size = 0;
+    m_bufferStartUs = startMs * 1000;
+    m_minPtsMs = startMs;
+    m_aborted = false;
+    m_spaceAvailable.wakeAll();
+}
+
+void AudioOutput::abort()
+{
+    QMutexLocker locker(&m_mutex);
+    m_aborted = true;
+    m_spaceAvailable.wakeAll();
+}
+
+qint64 AudioOutput::bytesAvailable() const
+{
+    QMutexLocker locker(&m_mutex);
+    return (qint64)m_size + QIODevice::bytesAvailable();
+}
+
+qint64 AudioOutput::readData(char *data, qint64 maxSize)
+{
+    qint64 playedMs = -1;
+    qint64 bytesRead = 0;
+    
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        while (bytesRead < maxSize && m_size > 0) {
+            size_t chunk = qMin((size_t)(maxSize - bytesRead), qMin(m_size, m_buffer.size() - m_readPos));
+            memcpy(data + bytesRead, m_buffer.data() + m_readPos, chunk);
+            
+            m_readPos = (m_readPos + chunk) % m_buffer.size();
+            m_size -= chunk;
+            bytesRead += chunk;
+        }
+        
+        if (bytesRead > 0) {
+            m_bufferStartUs += m_format.durationForBytes(bytesRead);
+            playedMs = m_bufferStartUs / 1000 - m_sinkLatencyMs;
+            m_spaceAvailable.wakeAll();
+        }
+    }
+    
+    if (playedMs >= 0 && m_clock) {
+        m_clock->sync(playedMs);
+    }
+    
+    // 数据不足时补静音，保持设备持续运行
+    if (bytesRead < maxSize) {
+        memset(data + bytesRead, 0, maxSize - bytesRead);
+    }
+    return maxSize;
+}
+
+qint64 AudioOutput::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
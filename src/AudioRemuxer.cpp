@@ -0,0 +1,109 @@
+#include "AudioRemuxer.h"
+#include <QDebug>
+
+AudioRemuxer::AudioRemuxer()
+    : m_formatContext(nullptr)
+    , m_outputStream(nullptr)
+    , m_inputTimeBase{0, 1}
+    , m_headerWritten(false)
+{
+}
+
+AudioRemuxer::~AudioRemuxer()
+{
+    close();
+}
+
+bool AudioRemuxer::open(const AVStream *inputStream, const QString &outputPath)
+{
+    cleanup();
+    
+    if (!inputStream) {
+        return false;
+    }
+    
+    m_outputPath = outputPath;
+    m_inputTimeBase = inputStream->time_base;
+    
+    // 创建输出上下文
+    avformat_alloc_output_context2(&m_formatContext, nullptr, nullptr, outputPath.toUtf8().constData());
+    if (!m_formatContext) {
+        return false;
+    }
+    
+    // 复制音频流参数
+    m_outputStream = avformat_new_stream(m_formatContext, nullptr);
+    if (!m_outputStream) {
+        cleanup();
+        return false;
+    }
+    
+    if (avcodec_parameters_copy(m_outputStream->codecpar, inputStream->codecpar) < 0) {
+        cleanup();
+        return false;
+    }
+    m_outputStream->codecpar->codec_tag = 0;
+    
+    // 打开输出文件
+    if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&m_formatContext->pb, outputPath.toUtf8().constData(), AVIO_FLAG_WRITE) < 0) {
+            cleanup();
+            return false;
+        }
+    }
+    
+    // 写入头部
+    if (avformat_write_header(m_formatContext, nullptr) < 0) {
+        cleanup();
+        return false;
+    }
+    
+    m_headerWritten = true;
+    return true;
+}
+
+void AudioRemuxer::close()
+{
+    cleanup();
+}
+
+bool AudioRemuxer::writePacket(AVPacket *packet)
+{
+    if (!m_headerWritten) {
+        return false;
+    }
+    
+    av_packet_rescale_ts(packet, m_inputTimeBase, m_outputStream->time_base);
+    packet->stream_index = m_outputStream->index;
+    packet->pos = -1;
+    
+    return av_interleaved_write_frame(m_formatContext, packet) >= 0;
+}
+
+bool AudioRemuxer::finalize()
+{
+    if (!m_headerWritten) {
+        return false;
+    }
+    
+    // 写入尾部
+    bool ok = av_write_trailer(m_formatContext) >= 0;
+    m_headerWritten = false;
+    
+    cleanup();
+    return ok;
+}
+
+void AudioRemuxer::cleanup()
+{
+    if (m_formatContext) {
+        if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&m_formatContext->pb);
+        }
+        avformat_free_context(m_formatContext);
+        m_formatContext = nullptr;
+    }
+    
+    m_outputStream = nullptr;
+    m_headerWritten = false;
+}
@@ -0,0 +1,428 @@
+#include "AudioTrackWriter.h"
+#include <QDebug>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+namespace {
+// 转码时使用的AAC参数
+constexpr int64_t kAacBitRate = 128000;
+constexpr int kDefaultFrameSize = 1024;
+}
+
+AudioTrackWriter::AudioTrackWriter()
+    : m_inputContext(nullptr)
+    , m_outputContext(nullptr)
+    , m_inputStream(nullptr)
+    , m_outputStream(nullptr)
+    , m_packet(nullptr)
+    , m_decoderContext(nullptr)
+    , m_encoderContext(nullptr)
+    , m_swrContext(nullptr)
+    , m_fifo(nullptr)
+    , m_decodedFrame(nullptr)
+    , m_resampledFrame(nullptr)
+    , m_startPts(0)
+    , m_samplesWritten(0)
+    , m_writtenSeconds(0.0)
+    , m_limitSeconds(-1.0)
+    , m_streamCopy(true)
+    , m_inputEof(false)
+{
+}
+
+AudioTrackWriter::~AudioTrackWriter()
+{
+    close();
+}
+
+bool AudioTrackWriter::openInput(const QString &audioPath)
+{
+    cleanup();
+    
+    if (avformat_open_input(&m_inputContext, audioPath.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    
+    if (avformat_find_stream_info(m_inputContext, nullptr) < 0) {
+        cleanup();
+        return false;
+    }
+    
+    // 查找音频流
+    for (unsigned int i = 0; i < m_inputContext->nb_streams; i++) {
+        if (m_inputContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+            m_inputStream = m_inputContext->streams[i];
+            break;
+        }
+    }
+    
+    if (!m_inputStream) {
+        cleanup();
+        return false;
+    }
+    
+    m_startPts = m_inputStream->start_time != AV_NOPTS_VALUE ? m_inputStream->start_time : 0;
+    m_packet = av_packet_alloc();
+    
+    return true;
+}
+
+bool AudioTrackWriter::addStream(AVFormatContext *outputContext)
+{
+    if (!m_inputStream || !outputContext) {
+        return false;
+    }
+    
+    m_outputContext = outputContext;
+    m_outputStream = avformat_new_stream(outputContext, nullptr);
+    if (!m_outputStream) {
+        return false;
+    }
+    
+    // 输出容器支持源编码时直接复制，否则转码为AAC
+    m_streamCopy = avformat_query_codec(outputContext->oformat, m_inputStream->codecpar->codec_id, FF_COMPLIANCE_NORMAL) == 1;
+    
+    if (m_streamCopy) {
+        if (avcodec_parameters_copy(m_outputStream->codecpar, m_inputStream->codecpar) < 0) {
+            return false;
+        }
+        m_outputStream->codecpar->codec_tag = 0;
+        m_outputStream->time_base = m_inputStream->time_base;
+        return true;
+    }
+    
+    return initTranscoder();
+}
+
+bool AudioTrackWriter::initTranscoder()
+{
+    // 解码器
+    const AVCodec *decoder = avcodec_find_decoder(m_inputStream->codecpar->codec_id);
+    if (!decoder) {
+        return false;
+    }
+    
+    m_decoderContext = avcodec_alloc_context3(decoder);
+    if (!m_decoderContext || avcodec_parameters_to_context(m_decoderContext, m_inputStream->codecpar) < 0) {
+        return false;
+    }
+    m_decoderContext->pkt_timebase = m_inputStream->time_base;
+    
+    if (avcodec_open2(m_decoderContext, decoder, nullptr) < 0) {
+        return false;
+    }
+    
+    // AAC编码器 (FFmpeg内置的aac编码器只支持FLTP采样格式)
+    const AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!encoder) {
+        return false;
+    }
+    
+    m_encoderContext = avcodec_alloc_context3(encoder);
+    if (!m_encoderContext) {
+        return false;
+    }
+    
+    int channels = m_decoderContext->ch_layout.nb_channels > 0 ? m_decoderContext->ch_layout.nb_channels : 2;
+    av_channel_layout_default(&m_encoderContext->ch_layout, channels);
+    m_encoderContext->sample_rate = m_decoderContext->sample_rate > 0 ? m_decoderContext->sample_rate : 44100;
+    m_encoderContext->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    m_encoderContext->bit_rate = kAacBitRate;
+    m_encoderContext->time_base = AVRational{1, m_encoderContext->sample_rate};
+    
+    if (m_outputContext->oformat->flags & AVFMT_GLOBALHEADER) {
+        m_encoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    
+    if (avcodec_open2(m_encoderContext, encoder, nullptr) < 0) {
+        return false;
+    }
+    
+    if (avcodec_parameters_from_context(m_outputStream->codecpar, m_encoderContext) < 0) {
+        return false;
+    }
+    m_outputStream->time_base = m_encoderContext->time_base;
+    
+    // 重采样后的数据先进入FIFO，再按编码器帧长取出
+    m_fifo = av_audio_fifo_alloc(m_encoderContext->sample_fmt, m_encoderContext->ch_layout.nb_channels, 1);
+    m_decodedFrame = av_frame_alloc();
+    m_resampledFrame = av_frame_alloc();
+    
+    return m_fifo && m_decodedFrame && m_resampledFrame;
+}
+
+bool AudioTrackWriter::writeUntil(double seconds)
+{
+    if (!m_outputStream) {
+        return false;
+    }
+    
+    while (m_writtenSeconds < seconds && !m_inputEof) {
+        if (m_limitSeconds >= 0 && m_writtenSeconds >= m_limitSeconds) {
+            break;
+        }
+        
+        if (!readPacket()) {
+            m_inputEof = true;
+            // 文件结束: 冲刷解码器，剩余采样进入FIFO
+            if (!m_streamCopy) {
+                decodePacket(nullptr);
+            }
+            break;
+        }
+        
+        bool ok = m_streamCopy ? copyPacket() : decodePacket(m_packet);
+        av_packet_unref(m_packet);
+        if (!ok) {
+            return false;
+        }
+        
+        if (!m_streamCopy && !encodeFromFifo(false)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool AudioTrackWriter::finish(double endSeconds)
+{
+    if (!m_outputStream) {
+        return false;
+    }
+    
+    // 音频不超过视频时长
+    m_limitSeconds = endSeconds;
+    if (!writeUntil(endSeconds)) {
+        return false;
+    }
+    
+    if (m_streamCopy) {
+        return true;
+    }
+    
+    // 取出FIFO中剩余的采样并冲刷编码器
+    if (!encodeFromFifo(true)) {
+        return false;
+    }
+    return encodeFrame(nullptr);
+}
+
+void AudioTrackWriter::close()
+{
+    cleanup();
+}
+
+bool AudioTrackWriter::readPacket()
+{
+    while (av_read_frame(m_inputContext, m_packet) >= 0) {
+        if (m_packet->stream_index == m_inputStream->index) {
+            return true;
+        }
+        av_packet_unref(m_packet);
+    }
+    return false;
+}
+
+bool AudioTrackWriter::copyPacket()
+{
+    if (m_packet->pts == AV_NOPTS_VALUE) {
+        return true;
+    }
+    
+    // 以输入音频起点为0
+    m_packet->pts -= m_startPts;
+    if (m_packet->dts != AV_NOPTS_VALUE) {
+        m_packet->dts -= m_startPts;
+    }
+    
+    double start = m_packet->pts * av_q2d(m_inputStream->time_base);
+    if (m_limitSeconds >= 0 && start >= m_limitSeconds) {
+        m_writtenSeconds = m_limitSeconds;
+        return true;
+    }
+    m_writtenSeconds = (m_packet->pts + m_packet->duration) * av_q2d(m_inputStream->time_base);
+    
+    av_packet_rescale_ts(m_packet, m_inputStream->time_base, m_outputStream->time_base);
+    m_packet->stream_index = m_outputStream->index;
+    m_packet->pos = -1;
+    
+    return av_interleaved_write_frame(m_outputContext, m_packet) >= 0;
+}
+
+bool AudioTrackWriter::decodePacket(const AVPacket *packet)
+{
+    // 损坏的数据包跳过
+    if (avcodec_send_packet(m_decoderContext, packet) < 0 && packet) {
+        return true;
+    }
+    
+    while (avcodec_receive_frame(m_decoderContext, m_decodedFrame) == 0) {
+        bool ok = resampleToFifo(m_decodedFrame);
+        av_frame_unref(m_decodedFrame);
+        if (!ok) {
+            return false;
+        }
+    }
+    
+    // 输入结束时取出重采样器中缓存的采样
+    if (!packet && m_swrContext) {
+        return resampleToFifo(nullptr);
+    }
+    
+    return true;
+}
+
+bool AudioTrackWriter::resampleToFifo(const AVFrame *frame)
+{
+    // 重采样器按第一帧的实际格式创建
+    if (!m_swrContext) {
+        if (!frame) {
+            return true;
+        }
+        if (swr_alloc_set_opts2(&m_swrContext,
+                                &m_encoderContext->ch_layout, m_encoderContext->sample_fmt, m_encoderContext->sample_rate,
+                                &frame->ch_layout, (AVSampleFormat)frame->format, frame->sample_rate,
+                                0, nullptr) < 0 || swr_init(m_swrContext) < 0) {
+            return false;
+        }
+    }
+    
+    int inSamples = frame ? frame->nb_samples : 0;
+    int outCapacity = swr_get_out_samples(m_swrContext, inSamples);
+    if (outCapacity <= 0) {
+        return true;
+    }
+    
+    // 输出缓冲区容量不够时才重新分配
+    if (m_resampledFrame->nb_samples < outCapacity) {
+        av_frame_unref(m_resampledFrame);
+        m_resampledFrame->format = m_encoderContext->sample_fmt;
+        m_resampledFrame->sample_rate = m_encoderContext->sample_rate;
+        av_channel_layout_copy(&m_resampledFrame->ch_layout, &m_encoderContext->ch_layout);
+        m_resampledFrame->nb_samples = outCapacity;
+        if (av_frame_get_buffer(m_resampledFrame, 0) < 0) {
+            return false;
+        }
+    }
+    
+    int converted = swr_convert(m_swrContext,
+                                m_resampledFrame->extended_data, outCapacity,
+                                frame ? (const uint8_t **)frame->extended_data : nullptr, inSamples);
+    if (converted < 0) {
+        return false;
+    }
+    
+    return av_audio_fifo_write(m_fifo, (void **)m_resampledFrame->extended_data, converted) >= converted;
+}
+
+bool AudioTrackWriter::encodeFromFifo(bool flush)
+{
+    const int frameSize = m_encoderContext->frame_size > 0 ? m_encoderContext->frame_size : kDefaultFrameSize;
+    
+    while (av_audio_fifo_size(m_fifo) >= frameSize || (flush && av_audio_fifo_size(m_fifo) > 0)) {
+        int samples = qMin(av_audio_fifo_size(m_fifo), frameSize);
+        
+        // 截止时间之后的采样丢弃
+        if (m_limitSeconds >= 0) {
+            int64_t limitSamples = (int64_t)(m_limitSeconds * m_encoderContext->sample_rate);
+            if (m_samplesWritten + samples > limitSamples) {
+                samples = (int)qMax<int64_t>(0, limitSamples - m_samplesWritten);
+            }
+            if (samples == 0) {
+                av_audio_fifo_reset(m_fifo);
+                break;
+            }
+        }
+        
+        AVFrame *frame = av_frame_alloc();
+        frame->nb_samples = samples;
+        frame->format = m_encoderContext->sample_fmt;
+        frame->sample_rate = m_encoderContext->sample_rate;
+        av_channel_layout_copy(&frame->ch_layout, &m_encoderContext->ch_layout);
+        
+        bool ok = av_frame_get_buffer(frame, 0) >= 0
+               && av_audio_fifo_read(m_fifo, (void **)frame->data, samples) >= samples;
+        if (ok) {
+            frame->pts = m_samplesWritten;
+            m_samplesWritten += samples;
+            m_writtenSeconds = (double)m_samplesWritten / m_encoderContext->sample_rate;
+            ok = encodeFrame(frame);
+        }
+        
+        av_frame_free(&frame);
+        if (!ok) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool AudioTrackWriter::encodeFrame(const AVFrame *frame)
+{
+    if (avcodec_send_frame(m_encoderContext, frame) < 0) {
+        return false;
+    }
+    
+    while (avcodec_receive_packet(m_encoderContext, m_packet) == 0) {
+        av_packet_rescale_ts(m_packet, m_encoderContext->time_base, m_outputStream->time_base);
+        m_packet->stream_index = m_outputStream->index;
+        
+        if (av_interleaved_write_frame(m_outputContext, m_packet) < 0) {
+            av_packet_unref(m_packet);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void AudioTrackWriter::cleanup()
+{
+    if (m_fifo) {
+        av_audio_fifo_free(m_fifo);
+        m_fifo = nullptr;
+    }
+    
+    if (m_swrContext) {
+        swr_free(&m_swrContext);
+    }
+    
+    if (m_decodedFrame) {
+        av_frame_free(&m_decodedFrame);
+    }
+    
+    if (m_resampledFrame) {
+        av_frame_free(&m_resampledFrame);
+    }
+    
+    if (m_encoderContext) {
+        avcodec_free_context(&m_encoderContext);
+    }
+    
+    if (m_decoderContext) {
+        avcodec_free_context(&m_decoderContext);
+    }
+    
+    if (m_packet) {
+        av_packet_free(&m_packet);
+    }
+    
+    if (m_inputContext) {
+        avformat_close_input(&m_inputContext);
+    }
+    
+    // 输出上下文由VideoEncoder持有
+    m_outputContext = nullptr;
+    m_outputStream = nullptr;
+    m_inputStream = nullptr;
+    m_startPts = 0;
+    m_samplesWritten = 0;
+    m_writtenSeconds = 0.0;
+    m_limitSeconds = -1.0;
+    m_streamCopy = true;
+    m_inputEof = false;
+}
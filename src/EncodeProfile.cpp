@@ -0,0 +1,94 @@
+#include "EncodeProfile.h"
+#include <QDebug>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+EncodeProfile EncodeProfile::forKind(Kind kind)
+{
+    EncodeProfile profile;
+    profile.kind = kind;
+    
+    switch (kind) {
+    case Throughput:
+        break;
+    case Archival:
+        profile.quality = 18;
+        profile.preset = "slow";
+        profile.hardware = false;
+        break;
+    case LowLatency:
+        profile.rateControl = Vbr;
+        profile.tune = "zerolatency";
+        profile.gopSize = 12;
+        profile.maxBFrames = 0;
+        break;
+    case Size:
+        profile.quality = 28;
+        profile.preset = "slower";
+        profile.hardware = false;
+        break;
+    }
+    return profile;
+}
+
+bool EncodeProfile::parseKind(const QString &name, Kind *kind)
+{
+    static const Kind kinds[] = { Throughput, Archival, LowLatency, Size };
+    for (Kind candidate : kinds) {
+        if (name.compare(kindName(candidate), Qt::CaseInsensitive) == 0) {
+            *kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString EncodeProfile::kindName(Kind kind)
+{
+    switch (kind) {
+    case Throughput:
+        return "throughput";
+    case Archival:
+        return "archival";
+    case LowLatency:
+        return "low-latency";
+    case Size:
+        return "size";
+    }
+    return QString();
+}
+
+void EncodeProfile::apply(AVCodecContext *context, int64_t fallbackBitRate) const
+{
+    context->gop_size = gopSize;
+    context->max_b_frames = maxBFrames;
+    
+    // 编码器不支持的私有选项 (如硬件编码器没有的preset名) 忽略
+    if (!preset.isEmpty()) {
+        av_opt_set(context->priv_data, "preset", preset.toUtf8().constData(), 0);
+    }
+    if (!tune.isEmpty()) {
+        av_opt_set(context->priv_data, "tune", tune.toUtf8().constData(), 0);
+    }
+    
+    switch (rateControl) {
+    case Crf:
+        if (av_opt_set_int(context->priv_data, "crf", quality, 0) >= 0) {
+            return;
+        }
+        qDebug() << "编码器不支持CRF，改用平均码率:" << context->codec->name;
+        break;
+    case Cqp:
+        if (av_opt_set_int(context->priv_data, "qp", quality, 0) < 0) {
+            context->flags |= AV_CODEC_FLAG_QSCALE;
+            context->global_quality = FF_QP2LAMBDA * quality;
+        }
+        return;
+    case Vbr:
+        break;
+    }
+    
+    context->bit_rate = bitRate > 0 ? bitRate : fallbackBitRate;
+}
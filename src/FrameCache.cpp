@@ -0,0 +1,189 @@
+#include "FrameCache.h"
+#include <QMutexLocker>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+FrameCache::FrameCache(int64_t budgetBytes)
+    : m_budget(budgetBytes)
+{
+}
+
+FrameCache::~FrameCache()
+{
+    clear();
+}
+
+void FrameCache::setBudget(int64_t bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_budget = qMax<int64_t>(0, bytes);
+    evict(Key{-1, 0});
+}
+
+int64_t FrameCache::budget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_budget;
+}
+
+void FrameCache::insert(int streamIndex, qint64 gopStartMs, qint64 ptsMs, qint64 durationMs, const AVFrame *frame)
+{
+    int64_t bytes = frameBytes(frame);
+    
+    QMutexLocker locker(&m_mutex);
+    if (bytes > m_budget) {
+        return;
+    }
+    
+    Key key{streamIndex, ptsMs};
+    if (m_frames.count(key)) {
+        return;
+    }
+    
+    // 正在写入的GOP不会被淘汰: 单个GOP超出预算时 (长GOP、只有一个关键帧的文件) 后面的帧不再放入
+    Key gopKey{streamIndex, gopStartMs};
+    auto it = m_gops.find(gopKey);
+    if (it != m_gops.end() && it->second.bytes + bytes > m_budget) {
+        return;
+    }
+    
+    AVFrame *reference = av_frame_clone(frame);
+    if (!reference) {
+        return;
+    }
+    
+    m_frames[key] = Entry{reference, durationMs, gopStartMs, bytes};
+    
+    if (it == m_gops.end()) {
+        m_lru.push_front(gopKey);
+        Gop gop;
+        gop.lruPosition = m_lru.begin();
+        it = m_gops.emplace(gopKey, gop).first;
+    } else {
+        touch(it->second);
+    }
+    it->second.frameTimes.push_back(ptsMs);
+    it->second.bytes += bytes;
+    
+    m_stats.frames++;
+    m_stats.bytes += bytes;
+    
+    evict(gopKey);
+}
+
+AVFrame *FrameCache::lookup(int streamIndex, qint64 timeMs, qint64 *ptsMs, qint64 *durationMs)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto it = findCovering(streamIndex, timeMs);
+    if (it == m_frames.end()) {
+        m_stats.misses++;
+        return nullptr;
+    }
+    
+    m_stats.hits++;
+    auto gop = m_gops.find(Key{streamIndex, it->second.gopStartMs});
+    if (gop != m_gops.end()) {
+        touch(gop->second);
+    }
+    
+    if (ptsMs) {
+        *ptsMs = it->first.timeMs;
+    }
+    if (durationMs) {
+        *durationMs = it->second.durationMs;
+    }
+    return av_frame_clone(it->second.frame);
+}
+
+bool FrameCache::contains(int streamIndex, qint64 timeMs) const
+{
+    QMutexLocker locker(&m_mutex);
+    return findCovering(streamIndex, timeMs) != m_frames.end();
+}
+
+void FrameCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    for (auto &item : m_frames) {
+        av_frame_free(&item.second.frame);
+    }
+    m_frames.clear();
+    m_gops.clear();
+    m_lru.clear();
+    m_stats.frames = 0;
+    m_stats.bytes = 0;
+}
+
+FrameCache::Stats FrameCache::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+std::map<FrameCache::Key, FrameCache::Entry>::const_iterator FrameCache::findCovering(int streamIndex, qint64 timeMs) const
+{
+    // 显示时间不晚于timeMs的最后一帧，且其时长覆盖timeMs
+    auto it = m_frames.upper_bound(Key{streamIndex, timeMs});
+    if (it == m_frames.begin()) {
+        return m_frames.end();
+    }
+    
+    --it;
+    if (it->first.stream != streamIndex || it->first.timeMs + it->second.durationMs <= timeMs) {
+        return m_frames.end();
+    }
+    return it;
+}
+
+void FrameCache::touch(Gop &gop)
+{
+    m_lru.splice(m_lru.begin(), m_lru, gop.lruPosition);
+}
+
+void FrameCache::evict(const Key &keep)
+{
+    // 从最久未使用的GOP开始整组淘汰，正在写入的GOP保留
+    auto position = m_lru.end();
+    while (m_stats.bytes > m_budget && position != m_lru.begin()) {
+        --position;
+        if (position->stream == keep.stream && position->timeMs == keep.timeMs) {
+            continue;
+        }
+        
+        auto it = m_gops.find(*position);
+        position = m_lru.erase(position);
+        removeGop(it);
+        m_stats.evictedGops++;
+    }
+}
+
+void FrameCache::removeGop(std::map<Key, Gop>::iterator it)
+{
+    for (qint64 timeMs : it->second.frameTimes) {
+        auto frame = m_frames.find(Key{it->first.stream, timeMs});
+        if (frame != m_frames.end()) {
+            av_frame_free(&frame->second.frame);
+            m_frames.erase(frame);
+            m_stats.frames--;
+        }
+    }
+    m_stats.bytes -= it->second.bytes;
+    m_gops.erase(it);
+}
+
+int64_t FrameCache::frameBytes(const AVFrame *frame)
+{
+    // 按实际引用的缓冲区计算 (含行对齐)，没有缓冲区信息时按图像尺寸估算
+    int64_t bytes = 0;
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++) {
+        bytes += frame->buf[i]->size;
+    }
+    if (bytes == 0) {
+        bytes = qMax(0, av_image_get_buffer_size((AVPixelFormat)frame->format, frame->width, frame->height, 1));
+    }
+    return bytes + (int64_t)sizeof(AVFrame);
+}
@@ -0,0 +1,145 @@
+#include "FrameConverter.h"
+#include "Trace.h"
+
+FrameConverter::FrameConverter()
+    : m_swsContext(nullptr)
+    , m_outputFormat(QImage::Format_RGB888)
+    , m_pool(2)
+    , m_nextSlot(0)
+{
+}
+
+FrameConverter::~FrameConverter()
+{
+    reset();
+}
+
+QImage FrameConverter::convert(const AVFrame *frame)
+{
+    QSize size = prepare(frame);
+    if (!size.isValid()) {
+        return QImage();
+    }
+    
+    QImage &image = acquireImage(size.width(), size.height());
+    scale(frame, image);
+    return image;
+}
+
+bool FrameConverter::convertInto(const AVFrame *frame, QImage &image)
+{
+    QSize size = prepare(frame);
+    if (!size.isValid()) {
+        return false;
+    }
+    
+    // 目标图像仍被其他地方引用时重新分配，避免改写别人正在使用的数据
+    if (!image.isDetached() || image.size() != size || image.format() != m_outputFormat) {
+        image = QImage(size, m_outputFormat);
+    }
+    scale(frame, image);
+    return true;
+}
+
+QSize FrameConverter::prepare(const AVFrame *frame)
+{
+    if (!frame || frame->width <= 0 || frame->height <= 0) {
+        return QSize();
+    }
+    
+    int width = frame->width;
+    int height = frame->height;
+    if (m_outputSize.isValid() && !m_outputSize.isEmpty()) {
+        QSize size = fitSize(frame->width, frame->height, frame->sample_aspect_ratio, m_outputSize);
+        width = size.width();
+        height = size.height();
+    }
+    
+    // QImage的32位格式按本机字节序存储 0xAARRGGBB，对应FFmpeg的AV_PIX_FMT_RGB32
+    AVPixelFormat outputFormat = m_outputFormat == QImage::Format_RGB888 ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_RGB32;
+    
+    // 参数不变时直接返回已有的上下文
+    m_swsContext = sws_getCachedContext(
+        m_swsContext,
+        frame->width, frame->height, (AVPixelFormat)frame->format,
+        width, height, outputFormat,
+        SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    
+    if (!m_swsContext) {
+        return QSize();
+    }
+    return QSize(width, height);
+}
+
+void FrameConverter::scale(const AVFrame *frame, QImage &image)
+{
+    // 直接写入QImage的扫描行
+    TraceScope span("convert/swsScale");
+    uint8_t *dstData[4] = { image.bits(), nullptr, nullptr, nullptr };
+    int dstLinesize[4] = { (int)image.bytesPerLine(), 0, 0, 0 };
+    sws_scale(m_swsContext, frame->data, frame->linesize, 0, frame->height, dstData, dstLinesize);
+}
+
+void FrameConverter::setOutputSize(const QSize &size)
+{
+    m_outputSize = size;
+}
+
+void FrameConverter::setOutputFormat(QImage::Format format)
+{
+    if (format != QImage::Format_RGB32 && format != QImage::Format_ARGB32_Premultiplied) {
+        format = QImage::Format_RGB888;
+    }
+    m_outputFormat = format;
+}
+
+QSize FrameConverter::fitSize(int width, int height, AVRational sampleAspectRatio, const QSize &box)
+{
+    // 非方形像素时按显示宽高比计算
+    double displayWidth = width;
+    if (sampleAspectRatio.num > 0 && sampleAspectRatio.den > 0) {
+        displayWidth = width * av_q2d(sampleAspectRatio);
+    }
+    
+    double scale = qMin(box.width() / displayWidth, (double)box.height() / height);
+    int fittedWidth = qMax(2, (int)(displayWidth * scale) & ~1);
+    int fittedHeight = qMax(2, (int)(height * scale) & ~1);
+    return QSize(fittedWidth, fittedHeight);
+}
+
+void FrameConverter::setPoolSize(int size)
+{
+    m_pool.resize(qMax(1, size));
+    m_nextSlot = 0;
+}
+
+void FrameConverter::reset()
+{
+    if (m_swsContext) {
+        sws_freeContext(m_swsContext);
+        m_swsContext = nullptr;
+    }
+    
+    for (QImage &image : m_pool) {
+        image = QImage();
+    }
+    m_nextSlot = 0;
+}
+
+QImage &FrameConverter::acquireImage(int width, int height)
+{
+    // 优先复用调用方已经释放的缓冲区 (引用计数为1说明只有池本身持有)
+    for (QImage &image : m_pool) {
+        if (image.isDetached() && image.width() == width && image.height() == height &&
+            image.format() == m_outputFormat) {
+            return image;
+        }
+    }
+    
+    // 没有可复用的缓冲区: 轮换替换一个槽位，仍被外部持有的旧图像由持有方负责释放
+    QImage &slot = m_pool[m_nextSlot];
+    m_nextSlot = (m_nextSlot + 1) % m_pool.size();
+    slot = QImage(width, height, m_outputFormat);
+    return slot;
+}
@@ -0,0 +1,67 @@
+#include "FrameMailbox.h"
+
+FrameMailbox::FrameMailbox()
+    : m_back(0)
+    , m_front(1)
+    , m_middle(2)
+    , m_published(0)
+    , m_dropped(0)
+    , m_taken(0)
+{
+}
+
+QImage &FrameMailbox::writeSlot()
+{
+    return m_slots[m_back].image;
+}
+
+bool FrameMailbox::publish(qint64 ptsMs)
+{
+    m_slots[m_back].ptsMs = ptsMs;
+    
+    // release: 读取者换到该槽时能看到写入的图像数据；acquire: 换回的槽已不再被读取者使用
+    int previous = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel);
+    m_back = previous & kIndexMask;
+    m_published.fetch_add(1, std::memory_order_relaxed);
+    
+    if (previous & kFresh) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool FrameMailbox::take(QImage &image, qint64 *ptsMs)
+{
+    if (!(m_middle.load(std::memory_order_relaxed) & kFresh)) {
+        return false;
+    }
+    
+    int previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+    m_front = previous & kIndexMask;
+    m_taken.fetch_add(1, std::memory_order_relaxed);
+    
+    // 共享数据的浅拷贝: 读取者仍持有时，写入者换回该槽会重新分配而不是覆盖
+    image = m_slots[m_front].image;
+    if (ptsMs) {
+        *ptsMs = m_slots[m_front].ptsMs;
+    }
+    return true;
+}
+
+void FrameMailbox::reset()
+{
+    // 只清除新帧标记，不改变槽的归属 (读取者可能同时在取)
+    int middle = m_middle.load(std::memory_order_relaxed);
+    while ((middle & kFresh) && !m_middle.compare_exchange_weak(middle, middle & kIndexMask, std::memory_order_acq_rel)) {
+    }
+}
+
+FrameMailbox::Stats FrameMailbox::stats() const
+{
+    Stats stats;
+    stats.published = m_published.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.taken = m_taken.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,81 @@
+#include "FrameQueue.h"
+#include <QMutexLocker>
+
+FrameQueue::FrameQueue(int capacity)
+    : m_capacity(qMax(1, capacity))
+    , m_aborted(false)
+{
+}
+
+FrameQueue::~FrameQueue()
+{
+    clear();
+}
+
+bool FrameQueue::push(const PlaybackFrame &item)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    while ((int)m_frames.size() >= m_capacity && !m_aborted) {
+        m_notFull.wait(&m_mutex);
+    }
+    
+    if (m_aborted) {
+        PlaybackFrame dropped = item;
+        release(dropped);
+        return false;
+    }
+    
+    m_frames.push_back(item);
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+bool FrameQueue::pop(PlaybackFrame &item, int timeoutMs)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_frames.empty() && !m_aborted) {
+        m_notEmpty.wait(&m_mutex, timeoutMs);
+    }
+    
+    if (m_frames.empty() || m_aborted) {
+        return false;
+    }
+    
+    item = m_frames.front();
+    m_frames.pop_front();
+    m_notFull.wakeOne();
+    return true;
+}
+
+int FrameQueue::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return (int)m_frames.size();
+}
+
+void FrameQueue::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    for (PlaybackFrame &item : m_frames) {
+        release(item);
+    }
+    m_frames.clear();
+    m_notFull.wakeAll();
+}
+
+void FrameQueue::abort()
+{
+    QMutexLocker locker(&m_mutex);
+    m_aborted = true;
+    m_notFull.wakeAll();
+    m_notEmpty.wakeAll();
+}
+
+void FrameQueue::restart()
+{
+    QMutexLocker locker(&m_mutex);
+    m_aborted = false;
+}
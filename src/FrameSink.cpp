@@ -0,0 +1,650 @@
+#include "FrameSink.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+namespace {
+
+AVRational validFrameRate(AVRational frameRate)
+{
+    return frameRate.num > 0 && frameRate.den > 0 ? frameRate : AVRational{25, 1};
+}
+
+// 按jpeg质量 (1-100) 换算mjpeg的量化系数 (2-31)
+int jpegQscale(int quality)
+{
+    quality = qBound(1, quality, 100);
+    return qBound(2, 2 + (100 - quality) * 29 / 99, 31);
+}
+
+// 各平面紧密排列后写入文件
+bool writePlanes(QFile &file, const AVFrame *frame, std::vector<uint8_t> &buffer, int64_t *bytes)
+{
+    AVPixelFormat format = (AVPixelFormat)frame->format;
+    int size = av_image_get_buffer_size(format, frame->width, frame->height, 1);
+    if (size <= 0) {
+        return false;
+    }
+    
+    buffer.resize(size);
+    {
+        TraceScope span("split/packPlanes");
+        if (av_image_copy_to_buffer(buffer.data(), size, frame->data, frame->linesize,
+                                    format, frame->width, frame->height, 1) < 0) {
+            return false;
+        }
+    }
+    
+    TraceScope span("split/diskWrite");
+    if (file.write((const char *)buffer.data(), size) != size) {
+        return false;
+    }
+    *bytes += size;
+    return true;
+}
+
+/**
+ * @brief 每帧一张图片 (jpeg / png)，用libavcodec的图片编码器压缩
+ */
+class ImageFrameSink : public FrameSink
+{
+public:
+    ImageFrameSink(const Options &options, const QString &outputDir)
+        : FrameSink(options, outputDir)
+        , m_context(nullptr)
+        , m_packet(nullptr)
+        , m_pixelFormat(AV_PIX_FMT_NONE)
+        , m_nextIndex(0)
+    {
+    }
+    
+    ~ImageFrameSink() override
+    {
+        avcodec_free_context(&m_context);
+        av_packet_free(&m_packet);
+    }
+
+protected:
+    bool openSink(const AVFrame *frame) override
+    {
+        bool jpeg = m_options.format == Jpeg;
+        const AVCodec *encoder = avcodec_find_encoder(jpeg ? AV_CODEC_ID_MJPEG : AV_CODEC_ID_PNG);
+        if (!encoder) {
+            qWarning() << "找不到图片编码器:" << formatName(m_options.format);
+            return false;
+        }
+        
+        m_context = avcodec_alloc_context3(encoder);
+        m_packet = av_packet_alloc();
+        if (!m_context || !m_packet) {
+            return false;
+        }
+        
+        m_context->width = frame->width;
+        m_context->height = frame->height;
+        m_context->sample_aspect_ratio = frame->sample_aspect_ratio;
+        m_context->time_base = av_inv_q(validFrameRate(m_frameRate));
+        
+        if (jpeg) {
+            // jpeg使用全范围YUV
+            m_pixelFormat = AV_PIX_FMT_YUVJ420P;
+            m_context->color_range = AVCOL_RANGE_JPEG;
+            m_context->flags |= AV_CODEC_FLAG_QSCALE;
+            m_context->global_quality = FF_QP2LAMBDA * jpegQscale(m_options.jpegQuality);
+        } else {
+            m_pixelFormat = AV_PIX_FMT_RGB24;
+            m_context->compression_level = qBound(0, m_options.pngCompression, 9);
+        }
+        m_context->pix_fmt = m_pixelFormat;
+        m_nextIndex = m_firstIndex;
+        
+        // 帧级多线程: 多帧同时压缩，输出顺序不变
+        applyThreads(m_context);
+        
+        if (avcodec_open2(m_context, encoder, nullptr) < 0) {
+            qWarning() << "无法打开图片编码器:" << encoder->name;
+            return false;
+        }
+        return true;
+    }
+    
+    bool writeFrame(const AVFrame *frame) override
+    {
+        const AVFrame *converted = convert(frame, m_pixelFormat);
+        if (!converted) {
+            return false;
+        }
+        
+        int ret;
+        {
+            TraceScope span("split/frameEncode");
+            ret = avcodec_send_frame(m_context, converted);
+        }
+        return ret >= 0 && receivePackets();
+    }
+    
+    bool finishSink() override
+    {
+        avcodec_send_frame(m_context, nullptr);
+        return receivePackets();
+    }
+
+private:
+    bool receivePackets()
+    {
+        const char *suffix = m_options.format == Jpeg ? "jpg" : "png";
+        
+        while (true) {
+            int ret;
+            {
+                TraceScope span("split/frameEncode");
+                ret = avcodec_receive_packet(m_context, m_packet);
+            }
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                return true;
+            }
+            if (ret < 0) {
+                return false;
+            }
+            
+            int index = m_nextIndex++;
+            bool ok;
+            {
+                TraceScope span("split/diskWrite");
+                QFile file(framePath(index, suffix));
+                ok = file.open(QIODevice::WriteOnly)
+                    && file.write((const char *)m_packet->data, m_packet->size) == m_packet->size;
+            }
+            ok = ok && fileWritten(index, suffix, m_packet->data, m_packet->size);
+            m_bytesWritten += m_packet->size;
+            av_packet_unref(m_packet);
+            if (!ok) {
+                return false;
+            }
+            m_framesWritten++;
+        }
+    }
+
+private:
+    AVCodecContext *m_context;
+    AVPacket *m_packet;
+    AVPixelFormat m_pixelFormat;
+    int m_nextIndex;
+};
+
+/**
+ * @brief 每帧一个不压缩的平面数据文件，格式信息写在format.json中
+ */
+class RawFrameSink : public FrameSink
+{
+public:
+    RawFrameSink(const Options &options, const QString &outputDir)
+        : FrameSink(options, outputDir)
+        , m_pixelFormat(AV_PIX_FMT_NONE)
+    {
+    }
+
+protected:
+    bool openSink(const AVFrame *frame) override
+    {
+        m_pixelFormat = m_options.rawRgb ? AV_PIX_FMT_RGB24 : (AVPixelFormat)frame->format;
+        
+        // 读取方按此解析每个文件
+        QJsonObject info;
+        info["width"] = frame->width;
+        info["height"] = frame->height;
+        info["pixelFormat"] = av_get_pix_fmt_name(m_pixelFormat);
+        info["frameSize"] = av_image_get_buffer_size(m_pixelFormat, frame->width, frame->height, 1);
+        info["frameRate"] = av_q2d(validFrameRate(m_frameRate));
+        
+        QFile file(m_outputDir + "/format.json");
+        return file.open(QIODevice::WriteOnly) && file.write(QJsonDocument(info).toJson()) > 0;
+    }
+    
+    bool writeFrame(const AVFrame *frame) override
+    {
+        const AVFrame *converted = convert(frame, m_pixelFormat);
+        if (!converted) {
+            return false;
+        }
+        
+        const char *suffix = m_options.rawRgb ? "rgb" : "yuv";
+        int index = m_firstIndex + m_framesWritten;
+        {
+            QFile file(framePath(index, suffix));
+            if (!file.open(QIODevice::WriteOnly) || !writePlanes(file, converted, m_buffer, &m_bytesWritten)) {
+                return false;
+            }
+        }
+        if (!fileWritten(index, suffix, m_buffer.data(), (int64_t)m_buffer.size())) {
+            return false;
+        }
+        m_framesWritten++;
+        return true;
+    }
+    
+    bool finishSink() override
+    {
+        return true;
+    }
+
+private:
+    AVPixelFormat m_pixelFormat;
+    std::vector<uint8_t> m_buffer;
+};
+
+/**
+ * @brief 所有帧顺序写入一个YUV4MPEG2文件
+ */
+class Y4mFrameSink : public FrameSink
+{
+public:
+    Y4mFrameSink(const Options &options, const QString &outputDir)
+        : FrameSink(options, outputDir)
+        , m_pixelFormat(AV_PIX_FMT_NONE)
+    {
+    }
+
+protected:
+    bool openSink(const AVFrame *frame) override
+    {
+        // y4m只支持少数平面格式，其余转换为4:2:0
+        const char *colorSpace = nullptr;
+        m_pixelFormat = (AVPixelFormat)frame->format;
+        switch (m_pixelFormat) {
+        case AV_PIX_FMT_YUV422P:
+            colorSpace = "422";
+            break;
+        case AV_PIX_FMT_YUV444P:
+            colorSpace = "444";
+            break;
+        case AV_PIX_FMT_GRAY8:
+            colorSpace = "mono";
+            break;
+        default:
+            colorSpace = "420jpeg";
+            m_pixelFormat = AV_PIX_FMT_YUV420P;
+            break;
+        }
+        
+        m_file.setFileName(m_outputDir + "/frames.y4m");
+        if (!m_file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+        
+        AVRational frameRate = validFrameRate(m_frameRate);
+        AVRational aspect = frame->sample_aspect_ratio;
+        QByteArray header = QString("YUV4MPEG2 W%1 H%2 F%3:%4 Ip A%5:%6 C%7%8\n")
+            .arg(frame->width).arg(frame->height)
+            .arg(frameRate.num).arg(frameRate.den)
+            .arg(aspect.num).arg(aspect.den)
+            .arg(colorSpace)
+            .arg(frame->color_range == AVCOL_RANGE_JPEG ? " XCOLORRANGE=FULL" : "")
+            .toLatin1();
+        if (m_file.write(header) != header.size()) {
+            return false;
+        }
+        m_bytesWritten += header.size();
+        return true;
+    }
+    
+    bool writeFrame(const AVFrame *frame) override
+    {
+        const AVFrame *converted = convert(frame, m_pixelFormat);
+        if (!converted) {
+            return false;
+        }
+        
+        static const char frameHeader[] = "FRAME\n";
+        const int headerSize = (int)sizeof(frameHeader) - 1;
+        if (m_file.write(frameHeader, headerSize) != headerSize
+            || !writePlanes(m_file, converted, m_buffer, &m_bytesWritten)) {
+            return false;
+        }
+        m_bytesWritten += headerSize;
+        m_framesWritten++;
+        return true;
+    }
+    
+    bool finishSink() override
+    {
+        bool ok = m_file.flush();
+        m_file.close();
+        return ok;
+    }
+
+private:
+    QFile m_file;
+    AVPixelFormat m_pixelFormat;
+    std::vector<uint8_t> m_buffer;
+};
+
+/**
+ * @brief 所有帧用FFV1无损编码写入一个mkv文件
+ */
+class Ffv1FrameSink : public FrameSink
+{
+public:
+    Ffv1FrameSink(const Options &options, const QString &outputDir)
+        : FrameSink(options, outputDir)
+        , m_outputContext(nullptr)
+        , m_stream(nullptr)
+        , m_context(nullptr)
+        , m_frame(nullptr)
+        , m_packet(nullptr)
+        , m_nextPts(0)
+    {
+    }
+    
+    ~Ffv1FrameSink() override
+    {
+        avcodec_free_context(&m_context);
+        av_frame_free(&m_frame);
+        av_packet_free(&m_packet);
+        if (m_outputContext) {
+            if (!(m_outputContext->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&m_outputContext->pb);
+            }
+            avformat_free_context(m_outputContext);
+        }
+    }
+
+protected:
+    bool openSink(const AVFrame *frame) override
+    {
+        const AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_FFV1);
+        if (!encoder) {
+            qWarning() << "找不到FFV1编码器";
+            return false;
+        }
+        
+        QByteArray path = (m_outputDir + "/frames.mkv").toUtf8();
+        if (avformat_alloc_output_context2(&m_outputContext, nullptr, "matroska", path.constData()) < 0) {
+            return false;
+        }
+        
+        m_stream = avformat_new_stream(m_outputContext, nullptr);
+        m_context = avcodec_alloc_context3(encoder);
+        m_frame = av_frame_alloc();
+        m_packet = av_packet_alloc();
+        if (!m_stream || !m_context || !m_frame || !m_packet) {
+            return false;
+        }
+        
+        // 编码器支持解码的像素格式时原样保存 (包括高位深)，否则转换为4:2:0
+        AVPixelFormat pixelFormat = AV_PIX_FMT_YUV420P;
+        for (const AVPixelFormat *format = encoder->pix_fmts; format && *format != AV_PIX_FMT_NONE; format++) {
+            if (*format == frame->format) {
+                pixelFormat = *format;
+                break;
+            }
+        }
+        
+        m_context->width = frame->width;
+        m_context->height = frame->height;
+        m_context->pix_fmt = pixelFormat;
+        m_context->sample_aspect_ratio = frame->sample_aspect_ratio;
+        m_context->color_range = frame->color_range;
+        m_context->time_base = av_inv_q(validFrameRate(m_frameRate));
+        m_context->framerate = validFrameRate(m_frameRate);
+        
+        // 版本3支持按片并行编码
+        m_context->level = 3;
+        applyThreads(m_context);
+        if (m_outputContext->oformat->flags & AVFMT_GLOBALHEADER) {
+            m_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+        
+        if (avcodec_open2(m_context, encoder, nullptr) < 0
+            || avcodec_parameters_from_context(m_stream->codecpar, m_context) < 0) {
+            qWarning() << "无法打开FFV1编码器";
+            return false;
+        }
+        m_stream->time_base = m_context->time_base;
+        
+        if (avio_open(&m_outputContext->pb, path.constData(), AVIO_FLAG_WRITE) < 0) {
+            return false;
+        }
+        return avformat_write_header(m_outputContext, nullptr) >= 0;
+    }
+    
+    bool writeFrame(const AVFrame *frame) override
+    {
+        const AVFrame *converted = convert(frame, m_context->pix_fmt);
+        if (!converted || av_frame_ref(m_frame, converted) < 0) {
+            return false;
+        }
+        
+        // 按帧序号编号，输出为恒定帧率
+        m_frame->pts = m_nextPts++;
+        int ret;
+        {
+            TraceScope span("split/frameEncode");
+            ret = avcodec_send_frame(m_context, m_frame);
+        }
+        av_frame_unref(m_frame);
+        return ret >= 0 && receivePackets();
+    }
+    
+    bool finishSink() override
+    {
+        avcodec_send_frame(m_context, nullptr);
+        if (!receivePackets()) {
+            return false;
+        }
+        
+        bool ok = av_write_trailer(m_outputContext) >= 0;
+        avio_closep(&m_outputContext->pb);
+        return ok;
+    }
+
+private:
+    bool receivePackets()
+    {
+        while (true) {
+            int ret;
+            {
+                TraceScope span("split/frameEncode");
+                ret = avcodec_receive_packet(m_context, m_packet);
+            }
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                return true;
+            }
+            if (ret < 0) {
+                return false;
+            }
+            
+            m_bytesWritten += m_packet->size;
+            av_packet_rescale_ts(m_packet, m_context->time_base, m_stream->time_base);
+            m_packet->stream_index = m_stream->index;
+            
+            TraceScope span("split/diskWrite");
+            if (av_interleaved_write_frame(m_outputContext, m_packet) < 0) {
+                return false;
+            }
+            m_framesWritten++;
+        }
+    }
+
+private:
+    AVFormatContext *m_outputContext;
+    AVStream *m_stream;
+    AVCodecContext *m_context;
+    AVFrame *m_frame;
+    AVPacket *m_packet;
+    int64_t m_nextPts;
+};
+
+} // namespace
+
+std::unique_ptr<FrameSink> FrameSink::create(const Options &options, const QString &outputDir)
+{
+    switch (options.format) {
+    case Jpeg:
+    case Png:
+        return std::unique_ptr<FrameSink>(new ImageFrameSink(options, outputDir));
+    case Raw:
+        return std::unique_ptr<FrameSink>(new RawFrameSink(options, outputDir));
+    case Y4m:
+        return std::unique_ptr<FrameSink>(new Y4mFrameSink(options, outputDir));
+    case Ffv1:
+        return std::unique_ptr<FrameSink>(new Ffv1FrameSink(options, outputDir));
+    }
+    return nullptr;
+}
+
+bool FrameSink::parseFormat(const QString &name, Format *format)
+{
+    static const Format formats[] = { Jpeg, Png, Raw, Y4m, Ffv1 };
+    for (Format candidate : formats) {
+        if (name.compare(formatName(candidate), Qt::CaseInsensitive) == 0) {
+            *format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString FrameSink::formatName(Format format)
+{
+    switch (format) {
+    case Jpeg:
+        return "jpeg";
+    case Png:
+        return "png";
+    case Raw:
+        return "raw";
+    case Y4m:
+        return "y4m";
+    case Ffv1:
+        return "ffv1";
+    }
+    return QString();
+}
+
+FrameSink::FrameSink(const Options &options, const QString &outputDir)
+    : m_options(options)
+    , m_outputDir(outputDir)
+    , m_frameRate{0, 1}
+    , m_firstIndex(0)
+    , m_framesWritten(0)
+    , m_bytesWritten(0)
+    , m_swsContext(nullptr)
+    , m_convertedFrame(nullptr)
+    , m_opened(false)
+    , m_finished(false)
+{
+}
+
+FrameSink::~FrameSink()
+{
+    if (m_swsContext) {
+        sws_freeContext(m_swsContext);
+        m_swsContext = nullptr;
+    }
+    av_frame_free(&m_convertedFrame);
+}
+
+bool FrameSink::write(const AVFrame *frame)
+{
+    if (m_finished) {
+        return false;
+    }
+    
+    if (!m_opened) {
+        if (!openSink(frame)) {
+            return false;
+        }
+        m_opened = true;
+    }
+    return writeFrame(frame);
+}
+
+bool FrameSink::finish()
+{
+    if (m_finished) {
+        return true;
+    }
+    
+    m_finished = true;
+    return !m_opened || finishSink();
+}
+
+const AVFrame *FrameSink::convert(const AVFrame *frame, AVPixelFormat format)
+{
+    if (frame->format == format) {
+        return frame;
+    }
+    
+    TraceScope span("split/convert");
+    
+    m_swsContext = sws_getCachedContext(m_swsContext,
+                                        frame->width, frame->height, (AVPixelFormat)frame->format,
+                                        frame->width, frame->height, format,
+                                        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!m_swsContext) {
+        return nullptr;
+    }
+    
+    if (!m_convertedFrame) {
+        m_convertedFrame = av_frame_alloc();
+        if (!m_convertedFrame) {
+            return nullptr;
+        }
+    }
+    
+    if (m_convertedFrame->width != frame->width || m_convertedFrame->height != frame->height
+        || m_convertedFrame->format != format) {
+        av_frame_unref(m_convertedFrame);
+        m_convertedFrame->width = frame->width;
+        m_convertedFrame->height = frame->height;
+        m_convertedFrame->format = format;
+        if (av_frame_get_buffer(m_convertedFrame, 0) < 0) {
+            return nullptr;
+        }
+    }
+    
+    // 帧级多线程的编码器可能仍持有上一帧的缓冲区，写入前确保独占
+    if (av_frame_make_writable(m_convertedFrame) < 0) {
+        return nullptr;
+    }
+    
+    sws_scale(m_swsContext, frame->data, frame->linesize, 0, frame->height,
+              m_convertedFrame->data, m_convertedFrame->linesize);
+    m_convertedFrame->sample_aspect_ratio = frame->sample_aspect_ratio;
+    m_convertedFrame->pts = frame->pts;
+    return m_convertedFrame;
+}
+
+QString FrameSink::frameFileName(int index, const char *suffix)
+{
+    return QString("frame_%1.%2").arg(index, 6, 10, QChar('0')).arg(suffix);
+}
+
+QString FrameSink::framePath(int index, const char *suffix) const
+{
+    return m_outputDir + "/" + frameFileName(index, suffix);
+}
+
+bool FrameSink::fileWritten(int index, const char *suffix, const uint8_t *data, int64_t size)
+{
+    return !m_fileWritten || m_fileWritten(index, frameFileName(index, suffix), data, size);
+}
+
+void FrameSink::applyThreads(AVCodecContext *context) const
+{
+    ThreadingPolicy::instance().apply(context, ThreadingPolicy::Convert, ThreadingPolicy::SplitStages);
+    if (m_options.threads > 0) {
+        context->thread_count = m_options.threads;
+    }
+}
@@ -0,0 +1,137 @@
+#include "ImageLoadPipeline.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
+#include <QMutexLocker>
+
+ImageLoadPipeline::ImageLoadPipeline(const QStringList &paths, const QSize &targetSize, QImage::Format format,
+                                     int threadCount, qint64 memoryBudget)
+    : m_paths(paths)
+    , m_targetSize(targetSize)
+    , m_format(format)
+    , m_nextToLoad(0)
+    , m_nextToDeliver(0)
+    , m_stopped(false)
+{
+    if (threadCount <= 0) {
+        threadCount = ThreadingPolicy::instance().threadCount(ThreadingPolicy::Convert, ThreadingPolicy::MergeStages);
+    }
+    
+    // 窗口: 默认每个线程两帧，并受内存预算限制 (按每像素4字节估算，解码时的临时图像也计入)
+    qint64 frameBytes = qMax<qint64>(1, (qint64)targetSize.width() * targetSize.height() * 4);
+    int window = (int)qBound<qint64>(2, memoryBudget / frameBytes, (qint64)threadCount * 2);
+    threadCount = qBound(1, threadCount, window);
+    
+    m_slots.resize(window);
+    
+    for (int i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(QThread::create([this]() { workerLoop(); }));
+        m_threads.back()->start();
+    }
+}
+
+ImageLoadPipeline::~ImageLoadPipeline()
+{
+    stop();
+}
+
+bool ImageLoadPipeline::next(QImage &image)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_stopped || m_nextToDeliver >= m_paths.size()) {
+        return false;
+    }
+    
+    Slot &slot = m_slots[m_nextToDeliver % m_slots.size()];
+    if (!slot.ready) {
+        // 消费方等待预读 (预读跟不上编码)
+        TraceScope span("load/waitImage");
+        while (!slot.ready && !m_stopped) {
+            m_slotReady.wait(&m_mutex);
+        }
+    }
+    
+    if (m_stopped) {
+        return false;
+    }
+    
+    image = std::move(slot.image);
+    slot.image = QImage();
+    slot.ready = false;
+    m_nextToDeliver++;
+    m_windowMoved.wakeAll();
+    
+    return true;
+}
+
+void ImageLoadPipeline::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopped = true;
+        m_windowMoved.wakeAll();
+        m_slotReady.wakeAll();
+    }
+    
+    for (auto &thread : m_threads) {
+        thread->wait();
+    }
+    m_threads.clear();
+}
+
+void ImageLoadPipeline::workerLoop()
+{
+    const int window = (int)m_slots.size();
+    
+    while (true) {
+        int index = 0;
+        {
+            QMutexLocker locker(&m_mutex);
+            // 只预读窗口内的帧
+            while (!m_stopped && m_nextToLoad < m_paths.size() && m_nextToLoad >= m_nextToDeliver + window) {
+                m_windowMoved.wait(&m_mutex);
+            }
+            
+            if (m_stopped || m_nextToLoad >= m_paths.size()) {
+                return;
+            }
+            
+            index = m_nextToLoad++;
+        }
+        
+        // 读取、解码、缩放都在锁外并行进行
+        QImage image = loadImage(m_paths.at(index));
+        
+        QMutexLocker locker(&m_mutex);
+        Slot &slot = m_slots[index % window];
+        slot.image = std::move(image);
+        slot.ready = true;
+        m_slotReady.wakeAll();
+    }
+}
+
+QImage ImageLoadPipeline::loadImage(const QString &path) const
+{
+    QImage image;
+    {
+        TraceScope span("load/readImage");
+        image.load(path);
+    }
+    if (image.isNull()) {
+        return image;
+    }
+    
+    // 确保图片尺寸一致
+    if (image.size() != m_targetSize) {
+        TraceScope span("load/scale");
+        image = image.scaled(m_targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    
+    // 在工作线程中完成像素格式转换，编码线程不再需要转换
+    if (image.format() != m_format) {
+        TraceScope span("load/convertFormat");
+        image.convertTo(m_format);
+    }
+    
+    return image;
+}
@@ -0,0 +1,204 @@
+#include "KeyframeIndex.h"
+#include "Trace.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+KeyframeIndex::KeyframeIndex()
+    : m_timeBase(AVRational{1, 1000})
+    , m_startTime(0)
+    , m_ready(false)
+{
+}
+
+bool KeyframeIndex::buildFromContainer(AVFormatContext *formatContext, int streamIndex)
+{
+    if (!formatContext || streamIndex < 0 || streamIndex >= (int)formatContext->nb_streams) {
+        return false;
+    }
+    
+    AVStream *stream = formatContext->streams[streamIndex];
+    
+    // 有B帧时索引中的时间 (mp4为解码时间) 早于关键帧的显示时间，由buildByScan读取数据包
+    if (stream->codecpar->video_delay > 0) {
+        return false;
+    }
+    
+    int count = avformat_index_get_entries_count(stream);
+    
+    std::vector<Keyframe> keyframes;
+    for (int i = 0; i < count; i++) {
+        const AVIndexEntry *entry = avformat_index_get_entry(stream, i);
+        if (entry && (entry->flags & AVINDEX_KEYFRAME) && entry->timestamp != AV_NOPTS_VALUE) {
+            keyframes.push_back(Keyframe{entry->timestamp, entry->timestamp});
+        }
+    }
+    
+    if (keyframes.empty()) {
+        return false;
+    }
+    
+    setEntries(keyframes, stream);
+    return true;
+}
+
+bool KeyframeIndex::buildByScan(const QString &filePath, int streamIndex, const std::atomic<bool> *cancel)
+{
+    TraceScope span("index/scan");
+    
+    AVFormatContext *formatContext = nullptr;
+    if (avformat_open_input(&formatContext, filePath.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    
+    if (avformat_find_stream_info(formatContext, nullptr) < 0 ||
+        streamIndex < 0 || streamIndex >= (int)formatContext->nb_streams) {
+        avformat_close_input(&formatContext);
+        return false;
+    }
+    
+    // 其他流的数据包直接跳过，减少拷贝
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+        if ((int)i != streamIndex) {
+            formatContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+    
+    // 容器有索引时只需每个关键帧的显示时间，不必读完整个文件
+    AVStream *stream = formatContext->streams[streamIndex];
+    std::vector<Keyframe> keyframes;
+    bool ok = avformat_index_get_entries_count(stream) > 0
+        ? readKeyframePackets(formatContext, streamIndex, keyframes, cancel)
+        : scanPackets(formatContext, streamIndex, keyframes, cancel);
+    
+    if (ok && !keyframes.empty()) {
+        setEntries(keyframes, stream);
+    }
+    
+    avformat_close_input(&formatContext);
+    return ok && m_ready;
+}
+
+bool KeyframeIndex::readKeyframePackets(AVFormatContext *formatContext, int streamIndex, std::vector<Keyframe> &keyframes,
+                                        const std::atomic<bool> *cancel)
+{
+    // 先复制索引: 读取数据包时解复用器可能修改索引
+    AVStream *stream = formatContext->streams[streamIndex];
+    std::vector<int64_t> timestamps;
+    int count = avformat_index_get_entries_count(stream);
+    for (int i = 0; i < count; i++) {
+        const AVIndexEntry *entry = avformat_index_get_entry(stream, i);
+        if (entry && (entry->flags & AVINDEX_KEYFRAME) && entry->timestamp != AV_NOPTS_VALUE) {
+            timestamps.push_back(entry->timestamp);
+        }
+    }
+    
+    AVPacket *packet = av_packet_alloc();
+    bool ok = true;
+    
+    for (int64_t timestamp : timestamps) {
+        if (cancel && *cancel) {
+            ok = false;
+            break;
+        }
+        if (av_seek_frame(formatContext, streamIndex, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+            continue;
+        }
+        
+        // 其他流已丢弃，跳转后读到的第一个数据包就是该关键帧
+        if (av_read_frame(formatContext, packet) >= 0) {
+            if (packet->stream_index == streamIndex && (packet->flags & AV_PKT_FLAG_KEY)) {
+                keyframes.push_back(Keyframe{timestamp, packet->pts != AV_NOPTS_VALUE ? packet->pts : timestamp});
+            }
+            av_packet_unref(packet);
+        }
+    }
+    
+    av_packet_free(&packet);
+    return ok;
+}
+
+bool KeyframeIndex::scanPackets(AVFormatContext *formatContext, int streamIndex, std::vector<Keyframe> &keyframes,
+                                const std::atomic<bool> *cancel)
+{
+    AVPacket *packet = av_packet_alloc();
+    bool ok = true;
+    
+    while (av_read_frame(formatContext, packet) >= 0) {
+        if (packet->stream_index == streamIndex && (packet->flags & AV_PKT_FLAG_KEY)) {
+            // 跳转用解码时间 (TS等格式按解码时间查找)，比较用显示时间
+            int64_t seekTimestamp = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+            int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+            if (pts != AV_NOPTS_VALUE) {
+                keyframes.push_back(Keyframe{seekTimestamp, pts});
+            }
+        }
+        av_packet_unref(packet);
+        
+        if (cancel && *cancel) {
+            ok = false;
+            break;
+        }
+    }
+    
+    av_packet_free(&packet);
+    return ok;
+}
+
+void KeyframeIndex::setEntries(std::vector<Keyframe> &keyframes, AVStream *stream)
+{
+    std::sort(keyframes.begin(), keyframes.end());
+    keyframes.erase(std::unique(keyframes.begin(), keyframes.end()), keyframes.end());
+    
+    QMutexLocker locker(&m_mutex);
+    m_keyframes.swap(keyframes);
+    m_timeBase = stream->time_base;
+    m_startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    m_ready = true;
+}
+
+void KeyframeIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_keyframes.clear();
+    m_ready = false;
+}
+
+int KeyframeIndex::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return (int)m_keyframes.size();
+}
+
+bool KeyframeIndex::keyframeBefore(int64_t pts, Entry *entry) const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), Keyframe{pts, pts});
+    if (it == m_keyframes.begin()) {
+        return false;
+    }
+    
+    *entry = makeEntry(*(it - 1));
+    return true;
+}
+
+std::vector<qint64> KeyframeIndex::keyframeTimes() const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    std::vector<qint64> times;
+    times.reserve(m_keyframes.size());
+    for (const Keyframe &keyframe : m_keyframes) {
+        times.push_back(makeEntry(keyframe).timeMs);
+    }
+    return times;
+}
+
+KeyframeIndex::Entry KeyframeIndex::makeEntry(const Keyframe &keyframe) const
+{
+    Entry entry;
+    entry.timestamp = keyframe.seekTimestamp;
+    entry.pts = keyframe.pts;
+    entry.timeMs = av_rescale_q(keyframe.pts - m_startTime, m_timeBase, AVRational{1, 1000});
+    return entry;
+}
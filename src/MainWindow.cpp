@@ -1,6 +1,7 @@
 #include "MainWindow.h"
 #include "VideoPlayer.h"
 #include "VideoProcessor.h"
+#include "VideoView.h"
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QMenuBar>
@@ -12,7 +13,7 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , centralWidget(nullptr)
-    , videoLabel(nullptr)
+    , videoView(nullptr)
     , timeLabel(nullptr)
     , infoTextEdit(nullptr)
     , openButton(nullptr)
@@ -44,9 +45,11 @@ MainWindow::MainWindow(QWidget *parent)
     connect(videoPlayer.get(), &VideoPlayer::positionChanged, this, &MainWindow::onPositionChanged);
     connect(videoPlayer.get(), &VideoPlayer::durationChanged, this, &MainWindow::onDurationChanged);
     connect(videoPlayer.get(), &VideoPlayer::videoInfoReady, this, &MainWindow::onVideoInfoReady);
+    connect(videoPlayer.get(), &VideoPlayer::playbackFinished, this, &MainWindow::onPlaybackFinished);
     
     // 处理器信号
     connect(videoProcessor.get(), &VideoProcessor::progressUpdated, this, &MainWindow::onProcessProgress);
+    connect(videoProcessor.get(), &VideoProcessor::streamProgressUpdated, this, &MainWindow::onStreamProgress);
     connect(videoProcessor.get(), &VideoProcessor::finished, this, &MainWindow::onProcessFinished);
     
     // 初始化按钮状态
@@ -150,17 +153,17 @@ void MainWindow::createCentralWidget()
     // 中间：视频预览区
     QVBoxLayout *centerLayout = new QVBoxLayout();
     
-    // 视频预览标签
+    // 视频预览 (播放器按控件尺寸输出帧，控件只负责绘制)
     QGroupBox *previewGroup = new QGroupBox("视频预览", this);
     QVBoxLayout *previewLayout = new QVBoxLayout(previewGroup);
     
-    videoLabel = new QLabel(this);
-    videoLabel->setMinimumSize(640, 480);
-    videoLabel->setAlignment(Qt::AlignCenter);
-    videoLabel->setStyleSheet("QLabel { background-color: black; }");
-    videoLabel->setText("未加载视频");
-    videoLabel->setScaledContents(false);
-    previewLayout->addWidget(videoLabel);
+    videoView = new VideoView(this);
+    videoView->setMinimumSize(640, 480);
+    videoView->setPlaceholderText("未加载视频");
+    connect(videoView, &VideoView::displaySizeChanged, this, [this](const QSize &size) {
+        videoPlayer->setDisplaySize(size);
+    });
+    previewLayout->addWidget(videoView);
     
     centerLayout->addWidget(previewGroup);
     
@@ -319,6 +322,8 @@ void MainWindow::onMergeVideo()
 
 void MainWindow::onSetCover()
 {
+    // 按原始分辨率保存 (预览画面已缩放到显示尺寸)
+    QImage currentFrame = videoPlayer->getCurrentFrame();
     if (currentFrame.isNull()) {
         QMessageBox::warning(this, "提示", "没有可用的视频帧！");
         return;
@@ -360,6 +365,9 @@ void MainWindow::onPlayPause()
 void MainWindow::onSliderPressed()
 {
     isSliderPressed = true;
+    if (videoDuration > 0) {
+        videoPlayer->beginScrub();
+    }
 }
 
 void MainWindow::onSliderReleased()
@@ -367,7 +375,7 @@ void MainWindow::onSliderReleased()
     isSliderPressed = false;
     if (videoDuration > 0) {
         qint64 position = (seekSlider->value() * videoDuration) / 1000;
-        videoPlayer->seek(position);
+        videoPlayer->endScrub(position);
     }
 }
 
@@ -376,17 +384,19 @@ void MainWindow::onSliderMoved(int value)
     if (videoDuration > 0) {
         qint64 position = (value * videoDuration) / 1000;
         timeLabel->setText(formatTime(position) + " / " + formatTime(videoDuration));
+        
+        // 拖动中的请求由播放器合并，只解码最新的位置
+        videoPlayer->scrubTo(position);
     }
 }
 
-void MainWindow::onFrameReady(const QImage &frame)
+void MainWindow::onFrameReady()
 {
-    currentFrame = frame;
-    
-    // 缩放图片以适应标签
-    QPixmap pixmap = QPixmap::fromImage(frame);
-    pixmap = pixmap.scaled(videoLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    videoLabel->setPixmap(pixmap);
+    // 帧已按控件尺寸缩放，直接绘制；积压的通知只取到最新的一帧
+    QImage frame;
+    if (videoPlayer->takeFrame(frame)) {
+        videoView->setFrame(frame);
+    }
 }
 
 void MainWindow::onPositionChanged(qint64 position)
@@ -404,6 +414,12 @@ void MainWindow::onDurationChanged(qint64 duration)
     timeLabel->setText("00:00:00 / " + formatTime(duration));
 }
 
+void MainWindow::onPlaybackFinished()
+{
+    playButton->setText("播放");
+    isPlaying = false;
+}
+
 void MainWindow::onVideoInfoReady(const QString &info)
 {
     infoTextEdit->setHtml(info);
@@ -414,6 +430,11 @@ void MainWindow::onProcessProgress(int progress)
     progressBar->setValue(progress);
 }
 
+void MainWindow::onStreamProgress(int videoProgress, int audioProgress)
+{
+    statusLabel->setText(QString("正在拆分视频... 视频 %1% | 音频 %2%").arg(videoProgress).arg(audioProgress));
+}
+
 void MainWindow::onProcessFinished(bool success, const QString &message)
 {
     progressBar->setVisible(false);
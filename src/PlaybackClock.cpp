@@ -0,0 +1,79 @@
+#include "PlaybackClock.h"
+#include <QMutexLocker>
+
+namespace {
+// 超过此偏差直接对齐音频时钟 (毫秒)
+const qint64 kResyncThresholdMs = 40;
+}
+
+PlaybackClock::PlaybackClock()
+    : m_basePosition(0)
+    , m_baseElapsed(0)
+    , m_paused(true)
+{
+    m_timer.start();
+}
+
+void PlaybackClock::reset(qint64 positionMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_basePosition = positionMs;
+    m_baseElapsed = m_timer.elapsed();
+}
+
+void PlaybackClock::pause()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_paused) {
+        return;
+    }
+    
+    m_basePosition = positionLocked();
+    m_baseElapsed = m_timer.elapsed();
+    m_paused = true;
+}
+
+void PlaybackClock::resume()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_paused) {
+        return;
+    }
+    
+    m_baseElapsed = m_timer.elapsed();
+    m_paused = false;
+}
+
+bool PlaybackClock::isPaused() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_paused;
+}
+
+qint64 PlaybackClock::now() const
+{
+    QMutexLocker locker(&m_mutex);
+    return positionLocked();
+}
+
+void PlaybackClock::sync(qint64 audioPositionMs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_paused) {
+        return;
+    }
+    
+    qint64 current = positionLocked();
+    qint64 drift = audioPositionMs - current;
+    
+    m_basePosition = qAbs(drift) > kResyncThresholdMs ? audioPositionMs : current + drift / 4;
+    m_baseElapsed = m_timer.elapsed();
+}
+
+qint64 PlaybackClock::positionLocked() const
+{
+    if (m_paused) {
+        return m_basePosition;
+    }
+    return m_basePosition + (m_timer.elapsed() - m_baseElapsed);
+}
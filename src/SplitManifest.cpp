@@ -0,0 +1,165 @@
+#include "SplitManifest.h"
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+
+// 末尾这么多个文件同时校验哈希 (中断前最后写入的文件最可能不完整)，其余只检查大小
+const int kHashCheckedTail = 256;
+
+// 读取文件的缓冲区大小
+const qint64 kReadChunk = 1 << 20;
+
+// FNV-1a
+const quint64 kHashOffset = 14695981039346656037ULL;
+const quint64 kHashPrime = 1099511628211ULL;
+
+quint64 hashBytes(quint64 hash, const unsigned char *bytes, qint64 size)
+{
+    for (qint64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= kHashPrime;
+    }
+    return hash;
+}
+
+} // namespace
+
+SplitManifest::SplitManifest()
+{
+}
+
+SplitManifest::~SplitManifest()
+{
+    close();
+}
+
+bool SplitManifest::load(const QString &path, const QJsonObject &header)
+{
+    m_entries.clear();
+    
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QList<QByteArray> lines = file.readAll().split('\n');
+    if (lines.isEmpty() || QJsonDocument::fromJson(lines.first()).object() != header) {
+        qWarning() << "拆分清单与当前的源文件或参数不一致，重新拆分:" << path;
+        return false;
+    }
+    
+    // 记录必须从0开始连续；最后一行可能只写了一半
+    for (int i = 1; i < lines.size(); i++) {
+        QJsonObject object = QJsonDocument::fromJson(lines.at(i)).object();
+        if (object.isEmpty() || object.value("index").toInt(-1) != (int)m_entries.size()) {
+            break;
+        }
+        
+        Entry entry;
+        entry.index = object.value("index").toInt();
+        entry.ptsMs = object.value("pts").toInteger(-1);
+        entry.sourceFrame = object.value("frame").toInteger();
+        entry.fileName = object.value("file").toString();
+        entry.size = object.value("size").toInteger();
+        entry.hash = object.value("hash").toString().toULongLong(nullptr, 16);
+        m_entries.push_back(entry);
+    }
+    
+    // 从第一个无效的文件处截断
+    QString dir = QFileInfo(path).absolutePath();
+    int hashFrom = (int)m_entries.size() - kHashCheckedTail;
+    for (int i = 0; i < (int)m_entries.size(); i++) {
+        if (!verify(dir, m_entries[i], i >= hashFrom)) {
+            qWarning() << "帧文件无效，从此处继续拆分:" << m_entries[i].fileName;
+            m_entries.resize(i);
+            break;
+        }
+    }
+    return true;
+}
+
+bool SplitManifest::open(const QString &path, const QJsonObject &header)
+{
+    close();
+    
+    // 整个清单重写到临时文件再替换，重写过程中中断也不会丢失原清单
+    {
+        QSaveFile saveFile(path);
+        if (!saveFile.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+        saveFile.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n');
+        for (const Entry &entry : m_entries) {
+            saveFile.write(QJsonDocument(toJson(entry)).toJson(QJsonDocument::Compact) + '\n');
+        }
+        if (!saveFile.commit()) {
+            return false;
+        }
+    }
+    
+    m_file.setFileName(path);
+    return m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered);
+}
+
+bool SplitManifest::append(const Entry &entry)
+{
+    QByteArray line = QJsonDocument(toJson(entry)).toJson(QJsonDocument::Compact) + '\n';
+    if (m_file.write(line) != line.size()) {
+        return false;
+    }
+    m_entries.push_back(entry);
+    return true;
+}
+
+void SplitManifest::close()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+quint64 SplitManifest::contentHash(const void *data, qint64 size)
+{
+    return hashBytes(kHashOffset, static_cast<const unsigned char *>(data), size);
+}
+
+bool SplitManifest::verify(const QString &dir, const Entry &entry, bool checkHash) const
+{
+    QFile file(dir + "/" + entry.fileName);
+    if (file.size() != entry.size) {
+        return false;
+    }
+    if (!checkHash) {
+        return true;
+    }
+    
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    // 分块计算，与一次性计算结果相同
+    quint64 hash = kHashOffset;
+    while (!file.atEnd()) {
+        QByteArray chunk = file.read(kReadChunk);
+        if (chunk.isEmpty()) {
+            return false;
+        }
+        hash = hashBytes(hash, (const unsigned char *)chunk.constData(), chunk.size());
+    }
+    return hash == entry.hash;
+}
+
+QJsonObject SplitManifest::toJson(const Entry &entry)
+{
+    QJsonObject object;
+    object["index"] = entry.index;
+    object["pts"] = entry.ptsMs;
+    object["frame"] = entry.sourceFrame;
+    object["file"] = entry.fileName;
+    object["size"] = entry.size;
+    object["hash"] = QString::number(entry.hash, 16);
+    return object;
+}
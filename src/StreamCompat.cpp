@@ -0,0 +1,300 @@
+#include "StreamCompat.h"
+#include "ThreadingPolicy.h"
+#include <QDebug>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+namespace {
+
+// 重新编码的片段不长，只需开头的关键帧
+const int kMatchedGopSize = 250;
+
+// 没有码率信息时音频编码使用的码率
+const int64_t kDefaultAudioBitRate = 128000;
+
+void appendNal(std::vector<uint8_t> &output, const uint8_t *nal, int size, int lengthSize)
+{
+    for (int i = lengthSize - 1; i >= 0; i--) {
+        output.push_back((uint8_t)(size >> (i * 8)));
+    }
+    output.insert(output.end(), nal, nal + size);
+}
+
+bool sameExtradata(const AVCodecParameters *a, const AVCodecParameters *b)
+{
+    return a->extradata_size == b->extradata_size
+        && (a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0);
+}
+
+AVRational normalizedAspect(AVRational sar)
+{
+    return sar.num > 0 && sar.den > 0 ? sar : AVRational{1, 1};
+}
+
+} // namespace
+
+bool StreamCompat::isCompatible(const AVCodecParameters *reference, const AVCodecParameters *params, QString *reason)
+{
+    auto fail = [reason](const QString &message) {
+        if (reason) {
+            *reason = message;
+        }
+        return false;
+    };
+    
+    if (reference->codec_type != params->codec_type || reference->codec_id != params->codec_id) {
+        return fail(QString("编码格式不同 (%1 / %2)")
+                    .arg(avcodec_get_name(reference->codec_id), avcodec_get_name(params->codec_id)));
+    }
+    
+    if (reference->codec_type == AVMEDIA_TYPE_VIDEO) {
+        if (reference->width != params->width || reference->height != params->height) {
+            return fail(QString("分辨率不同 (%1x%2 / %3x%4)")
+                        .arg(reference->width).arg(reference->height).arg(params->width).arg(params->height));
+        }
+        if (reference->format != params->format) {
+            return fail("像素格式不同");
+        }
+        if (av_cmp_q(normalizedAspect(reference->sample_aspect_ratio), normalizedAspect(params->sample_aspect_ratio)) != 0) {
+            return fail("像素宽高比不同");
+        }
+        
+        // H.264/HEVC的参数集不同时可随关键帧写入码流，但长度前缀必须一致；其他格式要求头信息完全相同
+        int lengthSize = nalLengthSize(reference);
+        if (reference->codec_id == AV_CODEC_ID_H264 || reference->codec_id == AV_CODEC_ID_HEVC) {
+            if (lengthSize != nalLengthSize(params)) {
+                return fail("码流封装格式不同");
+            }
+        } else if (!sameExtradata(reference, params)) {
+            return fail("编码头信息不同");
+        }
+    } else if (reference->codec_type == AVMEDIA_TYPE_AUDIO) {
+        if (reference->sample_rate != params->sample_rate) {
+            return fail(QString("采样率不同 (%1 / %2)").arg(reference->sample_rate).arg(params->sample_rate));
+        }
+        if (av_channel_layout_compare(&reference->ch_layout, &params->ch_layout) != 0) {
+            return fail("声道布局不同");
+        }
+        if (reference->format != params->format || !sameExtradata(reference, params)) {
+            return fail("音频编码参数不同");
+        }
+    }
+    
+    return true;
+}
+
+AVCodecContext *StreamCompat::openVideoEncoder(const AVCodecParameters *params, AVRational timeBase, AVRational frameRate, int64_t fallbackBitRate)
+{
+    const AVCodec *encoder = avcodec_find_encoder(params->codec_id);
+    if (!encoder) {
+        qWarning() << "没有可用于重新编码的编码器:" << avcodec_get_name(params->codec_id);
+        return nullptr;
+    }
+    
+    AVCodecContext *context = avcodec_alloc_context3(encoder);
+    if (!context) {
+        return nullptr;
+    }
+    
+    // 与源流一致的参数，使重新编码的帧能与复制的数据包接在同一条流中
+    context->width = params->width;
+    context->height = params->height;
+    context->pix_fmt = (AVPixelFormat)params->format;
+    context->sample_aspect_ratio = params->sample_aspect_ratio;
+    context->color_range = params->color_range;
+    context->color_primaries = params->color_primaries;
+    context->color_trc = params->color_trc;
+    context->colorspace = params->color_space;
+    context->chroma_sample_location = params->chroma_location;
+    context->time_base = timeBase;
+    context->framerate = frameRate;
+    context->bit_rate = params->bit_rate > 0 ? params->bit_rate : fallbackBitRate;
+    context->profile = params->profile;
+    context->level = params->level;
+    context->gop_size = kMatchedGopSize;
+    
+    // 不使用B帧: 解码顺序与显示顺序相同，解码时间戳可以直接接上复制的部分
+    context->max_b_frames = 0;
+    
+    // 不设置全局头: 参数集随关键帧写入码流，解码器切换到重新编码的部分时使用新的参数集
+    ThreadingPolicy::instance().apply(context, ThreadingPolicy::Encode, ThreadingPolicy::TranscodeStages);
+    
+    if (avcodec_open2(context, encoder, nullptr) < 0) {
+        qWarning() << "无法按源视频参数打开编码器:" << encoder->name;
+        avcodec_free_context(&context);
+        return nullptr;
+    }
+    return context;
+}
+
+AVCodecContext *StreamCompat::openAudioEncoder(const AVCodecParameters *params, bool globalHeader)
+{
+    const AVCodec *encoder = avcodec_find_encoder(params->codec_id);
+    if (!encoder) {
+        qWarning() << "没有可用于重新编码的编码器:" << avcodec_get_name(params->codec_id);
+        return nullptr;
+    }
+    
+    AVCodecContext *context = avcodec_alloc_context3(encoder);
+    if (!context) {
+        return nullptr;
+    }
+    
+    context->sample_rate = params->sample_rate;
+    context->sample_fmt = (AVSampleFormat)params->format;
+    context->bit_rate = params->bit_rate > 0 ? params->bit_rate : kDefaultAudioBitRate;
+    context->profile = params->profile;
+    context->time_base = AVRational{1, params->sample_rate};
+    if (av_channel_layout_copy(&context->ch_layout, &params->ch_layout) < 0) {
+        avcodec_free_context(&context);
+        return nullptr;
+    }
+    
+    if (globalHeader) {
+        context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    
+    if (avcodec_open2(context, encoder, nullptr) < 0) {
+        qWarning() << "无法按源音频参数打开编码器:" << encoder->name;
+        avcodec_free_context(&context);
+        return nullptr;
+    }
+    return context;
+}
+
+int StreamCompat::nalLengthSize(const AVCodecParameters *params)
+{
+    // mp4/mkv中的H.264/HEVC用长度前缀分隔NAL单元 (avcC/hvcC)
+    const uint8_t *data = params->extradata;
+    if (!data || params->extradata_size <= 0 || data[0] != 1) {
+        return 0;
+    }
+    
+    if (params->codec_id == AV_CODEC_ID_H264 && params->extradata_size >= 7) {
+        return (data[4] & 3) + 1;
+    }
+    if (params->codec_id == AV_CODEC_ID_HEVC && params->extradata_size >= 23) {
+        return (data[21] & 3) + 1;
+    }
+    return 0;
+}
+
+std::vector<uint8_t> StreamCompat::parameterSets(const AVCodecParameters *params, int lengthSize)
+{
+    std::vector<uint8_t> output;
+    const uint8_t *data = params->extradata;
+    int size = params->extradata_size;
+    if (!data || size <= 0) {
+        return output;
+    }
+    
+    if (params->codec_id != AV_CODEC_ID_H264 && params->codec_id != AV_CODEC_ID_HEVC) {
+        return output;
+    }
+    
+    // 起始码格式的extradata可直接插入
+    if (lengthSize == 0) {
+        output.assign(data, data + size);
+        return output;
+    }
+    
+    auto readNals = [&](int &pos, int count) {
+        for (int i = 0; i < count && pos + 2 <= size; i++) {
+            int nalSize = (data[pos] << 8) | data[pos + 1];
+            pos += 2;
+            if (pos + nalSize > size) {
+                pos = size;
+                return;
+            }
+            appendNal(output, data + pos, nalSize, lengthSize);
+            pos += nalSize;
+        }
+    };
+    
+    if (params->codec_id == AV_CODEC_ID_H264) {
+        // avcC: SPS个数在第5字节低5位，之后是PPS个数
+        int pos = 6;
+        readNals(pos, data[5] & 0x1f);
+        if (pos < size) {
+            int ppsCount = data[pos++];
+            readNals(pos, ppsCount);
+        }
+    } else {
+        // hvcC: 第22字节起为NAL数组 (类型 + 个数 + 各NAL)
+        int arrayCount = data[22];
+        int pos = 23;
+        for (int i = 0; i < arrayCount && pos + 3 <= size; i++) {
+            int nalCount = (data[pos + 1] << 8) | data[pos + 2];
+            pos += 3;
+            readNals(pos, nalCount);
+        }
+    }
+    return output;
+}
+
+bool StreamCompat::convertEncodedPacket(AVPacket *packet, int lengthSize)
+{
+    if (lengthSize <= 0) {
+        return true;
+    }
+    
+    const uint8_t *data = packet->data;
+    int size = packet->size;
+    std::vector<uint8_t> output;
+    output.reserve(size + 16);
+    
+    int nalStart = -1;
+    int i = 0;
+    while (i + 2 < size) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            if (nalStart >= 0) {
+                // 四字节起始码的第一个0属于上一个NAL的尾部
+                int nalEnd = i;
+                while (nalEnd > nalStart && data[nalEnd - 1] == 0) {
+                    nalEnd--;
+                }
+                appendNal(output, data + nalStart, nalEnd - nalStart, lengthSize);
+            }
+            i += 3;
+            nalStart = i;
+            continue;
+        }
+        i++;
+    }
+    
+    if (nalStart >= 0 && nalStart < size) {
+        appendNal(output, data + nalStart, size - nalStart, lengthSize);
+    }
+    return replacePacketData(packet, output);
+}
+
+bool StreamCompat::prependToPacket(AVPacket *packet, const std::vector<uint8_t> &data)
+{
+    if (data.empty()) {
+        return true;
+    }
+    
+    std::vector<uint8_t> output = data;
+    output.insert(output.end(), packet->data, packet->data + packet->size);
+    return replacePacketData(packet, output);
+}
+
+bool StreamCompat::replacePacketData(AVPacket *packet, const std::vector<uint8_t> &data)
+{
+    AVPacket *replacement = av_packet_alloc();
+    if (!replacement || av_new_packet(replacement, (int)data.size()) < 0) {
+        av_packet_free(&replacement);
+        return false;
+    }
+    
+    // 保留时间戳和标志
+    memcpy(replacement->data, data.data(), data.size());
+    av_packet_copy_props(replacement, packet);
+    av_packet_unref(packet);
+    av_packet_move_ref(packet, replacement);
+    av_packet_free(&replacement);
+    return true;
+}
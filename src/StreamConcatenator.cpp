@@ -0,0 +1,787 @@
+#include "StreamConcatenator.h"
+#include "StreamCompat.h"
+#include "AudioTrackWriter.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
+#include <QDebug>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+namespace {
+
+// 编码器没有固定帧长时每次送入的采样数
+const int kDefaultFrameSize = 1024;
+
+int64_t packetTime(const AVPacket *packet)
+{
+    return packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+}
+
+} // namespace
+
+StreamConcatenator::StreamConcatenator()
+    : m_outputContext(nullptr)
+    , m_videoOutput(nullptr)
+    , m_audioOutput(nullptr)
+    , m_videoReference(nullptr)
+    , m_audioReference(nullptr)
+    , m_videoTimeBase{1, 1000}
+    , m_offsetUs(0)
+    , m_lastVideoDts(AV_NOPTS_VALUE)
+    , m_lastAudioDts(AV_NOPTS_VALUE)
+    , m_inputContext(nullptr)
+    , m_videoStreamIndex(-1)
+    , m_audioStreamIndex(-1)
+    , m_clipStartUs(0)
+    , m_clipEndUs(0)
+    , m_needParameterSets(false)
+    , m_videoDecoder(nullptr)
+    , m_videoEncoder(nullptr)
+    , m_audioDecoder(nullptr)
+    , m_audioEncoder(nullptr)
+    , m_swsContext(nullptr)
+    , m_swrContext(nullptr)
+    , m_fifo(nullptr)
+    , m_frame(nullptr)
+    , m_scaledFrame(nullptr)
+    , m_resampledFrame(nullptr)
+    , m_packet(nullptr)
+    , m_encodedPacket(nullptr)
+    , m_videoDelay(0)
+    , m_audioSamples(-1)
+    , m_nalLengthSize(0)
+    , m_lastProgress(-1)
+{
+}
+
+StreamConcatenator::~StreamConcatenator()
+{
+    cleanup();
+}
+
+int StreamConcatenator::streamCopyCount() const
+{
+    int count = 0;
+    for (const ClipResult &result : m_results) {
+        if (result.streamCopy) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool StreamConcatenator::concat(const QStringList &inputPaths, const QString &outputPath)
+{
+    TraceScope span("concat/run");
+    
+    cleanup();
+    m_results.clear();
+    m_lastProgress = -1;
+    
+    if (inputPaths.isEmpty()) {
+        return false;
+    }
+    
+    if (!m_audioSourcePath.isEmpty()) {
+        m_audioWriter = std::make_unique<AudioTrackWriter>();
+        if (!m_audioWriter->openInput(m_audioSourcePath)) {
+            qWarning() << "无法读取音频文件:" << m_audioSourcePath;
+            cleanup();
+            return false;
+        }
+    }
+    
+    if (!probeClips(inputPaths) || !openOutput(outputPath)) {
+        cleanup();
+        return false;
+    }
+    
+    m_packet = av_packet_alloc();
+    m_encodedPacket = av_packet_alloc();
+    m_frame = av_frame_alloc();
+    if (!m_packet || !m_encodedPacket || !m_frame) {
+        cleanup();
+        return false;
+    }
+    
+    m_offsetUs = 0;
+    m_lastVideoDts = AV_NOPTS_VALUE;
+    m_lastAudioDts = AV_NOPTS_VALUE;
+    m_nalLengthSize = StreamCompat::nalLengthSize(m_videoReference);
+    
+    bool ok = true;
+    for (int i = 0; ok && i < (int)m_results.size(); i++) {
+        if (!openClip(m_results[i].path)) {
+            qWarning() << "无法打开片段:" << m_results[i].path;
+            ok = false;
+            break;
+        }
+        
+        ok = m_results[i].streamCopy ? copyClip(i) : reencodeClip(i);
+        
+        // 下一个片段接在本片段最后一帧的结束时间之后
+        int64_t durationUs = m_clipEndUs;
+        if (durationUs <= 0 && m_inputContext->duration != AV_NOPTS_VALUE) {
+            durationUs = m_inputContext->duration;
+        }
+        m_offsetUs += durationUs;
+        closeClip();
+    }
+    
+    // 剩余音频 (以视频总时长为准)
+    if (ok && m_audioWriter) {
+        TraceScope audioSpan("mux/audio");
+        ok = m_audioWriter->finish(m_offsetUs / (double)AV_TIME_BASE);
+    }
+    
+    if (ok) {
+        TraceScope writeSpan("mux/writeTrailer");
+        ok = av_write_trailer(m_outputContext) >= 0;
+    }
+    
+    cleanup();
+    return ok;
+}
+
+bool StreamConcatenator::probeClips(const QStringList &inputPaths)
+{
+    for (int i = 0; i < inputPaths.size(); i++) {
+        if (!openClip(inputPaths.at(i))) {
+            qWarning() << "无法打开片段:" << inputPaths.at(i);
+            return false;
+        }
+        
+        if (m_videoStreamIndex < 0) {
+            qWarning() << "片段没有视频流:" << inputPaths.at(i);
+            closeClip();
+            return false;
+        }
+        
+        const AVCodecParameters *video = m_inputContext->streams[m_videoStreamIndex]->codecpar;
+        const AVCodecParameters *audio = m_audioStreamIndex >= 0 && !m_audioWriter ? m_inputContext->streams[m_audioStreamIndex]->codecpar : nullptr;
+        
+        ClipResult result;
+        result.path = inputPaths.at(i);
+        
+        if (i == 0) {
+            // 第一个片段决定输出流的参数
+            m_videoReference = avcodec_parameters_alloc();
+            if (!m_videoReference || avcodec_parameters_copy(m_videoReference, video) < 0) {
+                closeClip();
+                return false;
+            }
+            m_videoTimeBase = m_inputContext->streams[m_videoStreamIndex]->time_base;
+            if (audio) {
+                m_audioReference = avcodec_parameters_alloc();
+                if (!m_audioReference || avcodec_parameters_copy(m_audioReference, audio) < 0) {
+                    closeClip();
+                    return false;
+                }
+            }
+        } else {
+            QString reason;
+            if (!StreamCompat::isCompatible(m_videoReference, video, &reason)) {
+                result.streamCopy = false;
+                result.reason = "视频" + reason;
+            } else if (m_audioReference && audio && !StreamCompat::isCompatible(m_audioReference, audio, &reason)) {
+                result.streamCopy = false;
+                result.reason = "音频" + reason;
+            }
+        }
+        
+        m_results.push_back(result);
+        closeClip();
+    }
+    return true;
+}
+
+bool StreamConcatenator::openClip(const QString &path)
+{
+    closeClip();
+    
+    if (avformat_open_input(&m_inputContext, path.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    
+    if (avformat_find_stream_info(m_inputContext, nullptr) < 0) {
+        closeClip();
+        return false;
+    }
+    
+    m_videoStreamIndex = av_find_best_stream(m_inputContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    m_audioStreamIndex = av_find_best_stream(m_inputContext, AVMEDIA_TYPE_AUDIO, -1, m_videoStreamIndex, nullptr, 0);
+    if (m_videoStreamIndex < 0) {
+        m_videoStreamIndex = -1;
+    }
+    if (m_audioStreamIndex < 0) {
+        m_audioStreamIndex = -1;
+    }
+    
+    // 只读取用到的流
+    for (unsigned int i = 0; i < m_inputContext->nb_streams; i++) {
+        if ((int)i != m_videoStreamIndex && (int)i != m_audioStreamIndex) {
+            m_inputContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+    
+    m_clipStartUs = m_inputContext->start_time != AV_NOPTS_VALUE ? m_inputContext->start_time : 0;
+    m_clipEndUs = 0;
+    return true;
+}
+
+void StreamConcatenator::closeClip()
+{
+    if (m_fifo) {
+        av_audio_fifo_free(m_fifo);
+        m_fifo = nullptr;
+    }
+    
+    if (m_swrContext) {
+        swr_free(&m_swrContext);
+    }
+    
+    if (m_swsContext) {
+        sws_freeContext(m_swsContext);
+        m_swsContext = nullptr;
+    }
+    
+    if (m_scaledFrame) {
+        av_frame_free(&m_scaledFrame);
+    }
+    
+    if (m_resampledFrame) {
+        av_frame_free(&m_resampledFrame);
+    }
+    
+    if (m_videoEncoder) {
+        avcodec_free_context(&m_videoEncoder);
+    }
+    
+    if (m_audioEncoder) {
+        avcodec_free_context(&m_audioEncoder);
+    }
+    
+    if (m_videoDecoder) {
+        avcodec_free_context(&m_videoDecoder);
+    }
+    
+    if (m_audioDecoder) {
+        avcodec_free_context(&m_audioDecoder);
+    }
+    
+    if (m_inputContext) {
+        avformat_close_input(&m_inputContext);
+    }
+    
+    m_videoStreamIndex = -1;
+    m_audioStreamIndex = -1;
+    m_parameterSets.clear();
+    m_needParameterSets = false;
+}
+
+bool StreamConcatenator::openOutput(const QString &outputPath)
+{
+    avformat_alloc_output_context2(&m_outputContext, nullptr, nullptr, outputPath.toUtf8().constData());
+    if (!m_outputContext) {
+        return false;
+    }
+    
+    // 输出流参数与第一个片段相同 (复制的数据包可直接写入)
+    m_videoOutput = avformat_new_stream(m_outputContext, nullptr);
+    if (!m_videoOutput || avcodec_parameters_copy(m_videoOutput->codecpar, m_videoReference) < 0) {
+        return false;
+    }
+    m_videoOutput->codecpar->codec_tag = 0;
+    m_videoOutput->time_base = m_videoTimeBase;
+    
+    if (m_audioReference) {
+        m_audioOutput = avformat_new_stream(m_outputContext, nullptr);
+        if (!m_audioOutput || avcodec_parameters_copy(m_audioOutput->codecpar, m_audioReference) < 0) {
+            return false;
+        }
+        m_audioOutput->codecpar->codec_tag = 0;
+        m_audioOutput->time_base = AVRational{1, m_audioReference->sample_rate};
+    }
+    
+    if (m_audioWriter && !m_audioWriter->addStream(m_outputContext)) {
+        return false;
+    }
+    
+    if (!(m_outputContext->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&m_outputContext->pb, outputPath.toUtf8().constData(), AVIO_FLAG_WRITE) < 0) {
+            return false;
+        }
+    }
+    
+    return avformat_write_header(m_outputContext, nullptr) >= 0;
+}
+
+bool StreamConcatenator::copyClip(int clipIndex)
+{
+    TraceScope span("concat/copyClip");
+    
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    AVStream *audioStream = m_audioStreamIndex >= 0 && m_audioOutput ? m_inputContext->streams[m_audioStreamIndex] : nullptr;
+    int64_t videoStart = av_rescale_q(m_clipStartUs, AVRational{1, AV_TIME_BASE}, videoStream->time_base);
+    int64_t audioStart = audioStream ? av_rescale_q(m_clipStartUs, AVRational{1, AV_TIME_BASE}, audioStream->time_base) : 0;
+    
+    // 片段的参数集可能与第一个片段不同 (或前一个片段是重新编码的)，随第一个关键帧写入码流
+    if (clipIndex > 0) {
+        m_parameterSets = StreamCompat::parameterSets(videoStream->codecpar, m_nalLengthSize);
+        m_needParameterSets = !m_parameterSets.empty();
+    }
+    
+    while (true) {
+        int ret;
+        {
+            TraceScope readSpan("demux/readFrame");
+            ret = av_read_frame(m_inputContext, m_packet);
+        }
+        if (ret < 0) {
+            break;
+        }
+        
+        bool ok = true;
+        if (m_packet->stream_index == m_videoStreamIndex) {
+            reportProgress(clipIndex, m_packet);
+            if (m_needParameterSets && (m_packet->flags & AV_PKT_FLAG_KEY)) {
+                ok = StreamCompat::prependToPacket(m_packet, m_parameterSets);
+                m_needParameterSets = false;
+            }
+            ok = ok && writePacket(m_packet, m_videoOutput, videoStream->time_base, videoStart);
+        } else if (audioStream && m_packet->stream_index == m_audioStreamIndex) {
+            ok = writePacket(m_packet, m_audioOutput, audioStream->time_base, audioStart);
+        }
+        av_packet_unref(m_packet);
+        
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamConcatenator::reencodeClip(int clipIndex)
+{
+    TraceScope span("concat/reencodeClip");
+    
+    if (!openClipCodecs()) {
+        return false;
+    }
+    
+    while (true) {
+        int ret;
+        {
+            TraceScope readSpan("demux/readFrame");
+            ret = av_read_frame(m_inputContext, m_packet);
+        }
+        if (ret < 0) {
+            break;
+        }
+        
+        bool ok = true;
+        if (m_packet->stream_index == m_videoStreamIndex) {
+            reportProgress(clipIndex, m_packet);
+            ok = decodeVideo(m_packet);
+        } else if (m_audioDecoder && m_packet->stream_index == m_audioStreamIndex) {
+            ok = decodeAudio(m_packet);
+        }
+        av_packet_unref(m_packet);
+        
+        if (!ok) {
+            return false;
+        }
+    }
+    
+    // 冲刷解码器、重采样器和编码器
+    bool ok = decodeVideo(nullptr) && encodeVideoFrame(nullptr);
+    if (m_audioDecoder) {
+        ok = ok && decodeAudio(nullptr) && resampleAudio(nullptr) && encodeAudioFromFifo(true) && encodeAudioFrame(nullptr);
+    }
+    return ok;
+}
+
+bool StreamConcatenator::openClipCodecs()
+{
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    
+    // 视频解码器
+    const AVCodec *videoCodec = avcodec_find_decoder(videoStream->codecpar->codec_id);
+    if (!videoCodec) {
+        return false;
+    }
+    m_videoDecoder = avcodec_alloc_context3(videoCodec);
+    if (!m_videoDecoder || avcodec_parameters_to_context(m_videoDecoder, videoStream->codecpar) < 0) {
+        return false;
+    }
+    m_videoDecoder->pkt_timebase = videoStream->time_base;
+    ThreadingPolicy::instance().apply(m_videoDecoder, ThreadingPolicy::Decode, ThreadingPolicy::TranscodeStages);
+    if (avcodec_open2(m_videoDecoder, videoCodec, nullptr) < 0) {
+        return false;
+    }
+    
+    // 按第一个片段的参数编码，时间基沿用本片段的时间基
+    AVRational frameRate = av_guess_frame_rate(m_inputContext, videoStream, nullptr);
+    m_videoEncoder = StreamCompat::openVideoEncoder(m_videoReference, videoStream->time_base, frameRate, m_inputContext->bit_rate);
+    if (!m_videoEncoder) {
+        return false;
+    }
+    
+    // 解码时间戳保持与参考流相同的重排延迟，与后面复制的片段衔接
+    m_videoDelay = 0;
+    if (frameRate.num > 0 && frameRate.den > 0) {
+        m_videoDelay = m_videoReference->video_delay * av_rescale_q(1, av_inv_q(frameRate), videoStream->time_base);
+    }
+    
+    m_scaledFrame = av_frame_alloc();
+    if (!m_scaledFrame) {
+        return false;
+    }
+    
+    // 音频 (输出没有音频流或片段没有音频时跳过)
+    if (!m_audioOutput || m_audioStreamIndex < 0) {
+        return true;
+    }
+    
+    AVStream *audioStream = m_inputContext->streams[m_audioStreamIndex];
+    const AVCodec *audioCodec = avcodec_find_decoder(audioStream->codecpar->codec_id);
+    if (!audioCodec) {
+        return false;
+    }
+    m_audioDecoder = avcodec_alloc_context3(audioCodec);
+    if (!m_audioDecoder || avcodec_parameters_to_context(m_audioDecoder, audioStream->codecpar) < 0) {
+        return false;
+    }
+    m_audioDecoder->pkt_timebase = audioStream->time_base;
+    if (avcodec_open2(m_audioDecoder, audioCodec, nullptr) < 0) {
+        return false;
+    }
+    
+    m_audioEncoder = StreamCompat::openAudioEncoder(m_audioReference, m_outputContext->oformat->flags & AVFMT_GLOBALHEADER);
+    if (!m_audioEncoder) {
+        return false;
+    }
+    
+    // 重采样后的数据先进入FIFO，再按编码器帧长取出
+    m_fifo = av_audio_fifo_alloc(m_audioEncoder->sample_fmt, m_audioEncoder->ch_layout.nb_channels, 1);
+    m_resampledFrame = av_frame_alloc();
+    m_audioSamples = -1;
+    return m_fifo && m_resampledFrame;
+}
+
+bool StreamConcatenator::decodeVideo(const AVPacket *packet)
+{
+    // 损坏的数据包跳过
+    if (avcodec_send_packet(m_videoDecoder, packet) < 0 && packet) {
+        return true;
+    }
+    
+    while (avcodec_receive_frame(m_videoDecoder, m_frame) == 0) {
+        m_frame->pts = m_frame->best_effort_timestamp != AV_NOPTS_VALUE ? m_frame->best_effort_timestamp : m_frame->pts;
+        bool ok = m_frame->pts == AV_NOPTS_VALUE || encodeVideoFrame(m_frame);
+        av_frame_unref(m_frame);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamConcatenator::encodeVideoFrame(AVFrame *frame)
+{
+    AVFrame *input = frame;
+    
+    // 尺寸或像素格式与第一个片段不同时先转换
+    if (frame && (frame->width != m_videoEncoder->width || frame->height != m_videoEncoder->height
+                  || frame->format != m_videoEncoder->pix_fmt)) {
+        m_swsContext = sws_getCachedContext(m_swsContext,
+                                            frame->width, frame->height, (AVPixelFormat)frame->format,
+                                            m_videoEncoder->width, m_videoEncoder->height, m_videoEncoder->pix_fmt,
+                                            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!m_swsContext) {
+            return false;
+        }
+        
+        if (!m_scaledFrame->data[0]) {
+            m_scaledFrame->format = m_videoEncoder->pix_fmt;
+            m_scaledFrame->width = m_videoEncoder->width;
+            m_scaledFrame->height = m_videoEncoder->height;
+            if (av_frame_get_buffer(m_scaledFrame, 0) < 0) {
+                return false;
+            }
+        }
+        if (av_frame_make_writable(m_scaledFrame) < 0) {
+            return false;
+        }
+        
+        TraceScope span("encode/swsScale");
+        sws_scale(m_swsContext, frame->data, frame->linesize, 0, frame->height, m_scaledFrame->data, m_scaledFrame->linesize);
+        m_scaledFrame->pts = frame->pts;
+        input = m_scaledFrame;
+    }
+    
+    if (input) {
+        input->pict_type = AV_PICTURE_TYPE_NONE;
+    }
+    
+    {
+        TraceScope span("encode/sendFrame");
+        if (avcodec_send_frame(m_videoEncoder, input) < 0) {
+            return false;
+        }
+    }
+    
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    int64_t videoStart = av_rescale_q(m_clipStartUs, AVRational{1, AV_TIME_BASE}, videoStream->time_base);
+    
+    while (true) {
+        int ret;
+        {
+            TraceScope span("encode/receivePacket");
+            ret = avcodec_receive_packet(m_videoEncoder, m_encodedPacket);
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        
+        m_encodedPacket->dts = m_encodedPacket->pts - m_videoDelay;
+        bool ok = StreamCompat::convertEncodedPacket(m_encodedPacket, m_nalLengthSize)
+               && writePacket(m_encodedPacket, m_videoOutput, videoStream->time_base, videoStart);
+        av_packet_unref(m_encodedPacket);
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+bool StreamConcatenator::decodeAudio(const AVPacket *packet)
+{
+    // 损坏的数据包跳过
+    if (avcodec_send_packet(m_audioDecoder, packet) < 0 && packet) {
+        return true;
+    }
+    
+    AVStream *audioStream = m_inputContext->streams[m_audioStreamIndex];
+    while (avcodec_receive_frame(m_audioDecoder, m_frame) == 0) {
+        // 第一帧的时间决定本片段音频的起点，之后按采样数连续编码
+        if (m_audioSamples < 0) {
+            int64_t pts = m_frame->best_effort_timestamp;
+            int64_t start = av_rescale_q(m_clipStartUs, AVRational{1, AV_TIME_BASE}, audioStream->time_base);
+            m_audioSamples = pts != AV_NOPTS_VALUE
+                ? qMax<int64_t>(0, av_rescale_q(pts - start, audioStream->time_base, m_audioEncoder->time_base))
+                : 0;
+        }
+        
+        bool ok = resampleAudio(m_frame) && encodeAudioFromFifo(false);
+        av_frame_unref(m_frame);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamConcatenator::resampleAudio(const AVFrame *frame)
+{
+    // 重采样器按第一帧的实际格式创建
+    if (!m_swrContext) {
+        if (!frame) {
+            return true;
+        }
+        if (swr_alloc_set_opts2(&m_swrContext,
+                                &m_audioEncoder->ch_layout, m_audioEncoder->sample_fmt, m_audioEncoder->sample_rate,
+                                &frame->ch_layout, (AVSampleFormat)frame->format, frame->sample_rate,
+                                0, nullptr) < 0 || swr_init(m_swrContext) < 0) {
+            return false;
+        }
+    }
+    
+    int inSamples = frame ? frame->nb_samples : 0;
+    int outCapacity = swr_get_out_samples(m_swrContext, inSamples);
+    if (outCapacity <= 0) {
+        return true;
+    }
+    
+    // 输出缓冲区容量不够时才重新分配
+    if (m_resampledFrame->nb_samples < outCapacity) {
+        av_frame_unref(m_resampledFrame);
+        m_resampledFrame->format = m_audioEncoder->sample_fmt;
+        m_resampledFrame->sample_rate = m_audioEncoder->sample_rate;
+        av_channel_layout_copy(&m_resampledFrame->ch_layout, &m_audioEncoder->ch_layout);
+        m_resampledFrame->nb_samples = outCapacity;
+        if (av_frame_get_buffer(m_resampledFrame, 0) < 0) {
+            return false;
+        }
+    }
+    
+    int converted = swr_convert(m_swrContext,
+                                m_resampledFrame->extended_data, outCapacity,
+                                frame ? (const uint8_t **)frame->extended_data : nullptr, inSamples);
+    if (converted < 0) {
+        return false;
+    }
+    
+    return av_audio_fifo_write(m_fifo, (void **)m_resampledFrame->extended_data, converted) >= converted;
+}
+
+bool StreamConcatenator::encodeAudioFromFifo(bool flush)
+{
+    const int frameSize = m_audioEncoder->frame_size > 0 ? m_audioEncoder->frame_size : kDefaultFrameSize;
+    
+    while (av_audio_fifo_size(m_fifo) >= frameSize || (flush && av_audio_fifo_size(m_fifo) > 0)) {
+        int samples = qMin(av_audio_fifo_size(m_fifo), frameSize);
+        
+        AVFrame *frame = av_frame_alloc();
+        frame->nb_samples = samples;
+        frame->format = m_audioEncoder->sample_fmt;
+        frame->sample_rate = m_audioEncoder->sample_rate;
+        av_channel_layout_copy(&frame->ch_layout, &m_audioEncoder->ch_layout);
+        
+        bool ok = av_frame_get_buffer(frame, 0) >= 0
+               && av_audio_fifo_read(m_fifo, (void **)frame->data, samples) >= samples;
+        if (ok) {
+            frame->pts = qMax<int64_t>(0, m_audioSamples);
+            m_audioSamples = frame->pts + samples;
+            ok = encodeAudioFrame(frame);
+        }
+        
+        av_frame_free(&frame);
+        if (!ok) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool StreamConcatenator::encodeAudioFrame(const AVFrame *frame)
+{
+    if (avcodec_send_frame(m_audioEncoder, frame) < 0) {
+        return false;
+    }
+    
+    // 编码器时间戳已相对片段起点
+    while (avcodec_receive_packet(m_audioEncoder, m_encodedPacket) == 0) {
+        bool ok = writePacket(m_encodedPacket, m_audioOutput, m_audioEncoder->time_base, 0);
+        av_packet_unref(m_encodedPacket);
+        if (!ok) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool StreamConcatenator::writePacket(AVPacket *packet, AVStream *output, AVRational timeBase, int64_t clipStart)
+{
+    // 记录片段时长 (以最后一帧的结束时间为准)
+    int64_t time = packetTime(packet);
+    if (time != AV_NOPTS_VALUE) {
+        int64_t endUs = av_rescale_q(time - clipStart + qMax<int64_t>(0, packet->duration), timeBase, AVRational{1, AV_TIME_BASE});
+        m_clipEndUs = qMax(m_clipEndUs, endUs);
+    }
+    
+    // 时间戳减去片段起点，加上前面片段的总时长
+    int64_t offset = av_rescale_q(m_offsetUs, AVRational{1, AV_TIME_BASE}, output->time_base);
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts = av_rescale_q(packet->pts - clipStart, timeBase, output->time_base) + offset;
+    }
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts = av_rescale_q(packet->dts - clipStart, timeBase, output->time_base) + offset;
+    }
+    packet->duration = av_rescale_q(packet->duration, timeBase, output->time_base);
+    
+    // 解码时间戳必须严格递增 (片段交界处的取整误差)
+    int64_t &lastDts = output == m_videoOutput ? m_lastVideoDts : m_lastAudioDts;
+    if (packet->dts != AV_NOPTS_VALUE) {
+        if (lastDts != AV_NOPTS_VALUE && packet->dts <= lastDts) {
+            packet->dts = lastDts + 1;
+            if (packet->pts != AV_NOPTS_VALUE && packet->pts < packet->dts) {
+                packet->pts = packet->dts;
+            }
+        }
+        lastDts = packet->dts;
+    }
+    
+    packet->stream_index = output->index;
+    packet->pos = -1;
+    
+    {
+        TraceScope span(output == m_videoOutput ? "mux/writeVideo" : "mux/writeAudio");
+        if (av_interleaved_write_frame(m_outputContext, packet) < 0) {
+            return false;
+        }
+    }
+    
+    // 写入与当前视频进度对应的单独音频
+    if (m_audioWriter && output == m_videoOutput && lastDts != AV_NOPTS_VALUE) {
+        TraceScope span("mux/audio");
+        return m_audioWriter->writeUntil(lastDts * av_q2d(m_videoOutput->time_base));
+    }
+    return true;
+}
+
+void StreamConcatenator::reportProgress(int clipIndex, const AVPacket *packet)
+{
+    if (!m_progressCallback) {
+        return;
+    }
+    
+    // 每个片段占相同的比例，片段内按视频时间戳推算
+    int clipProgress = 0;
+    int64_t time = packetTime(packet);
+    int64_t durationUs = m_inputContext->duration;
+    if (time != AV_NOPTS_VALUE && durationUs > 0) {
+        AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+        int64_t timeUs = av_rescale_q(time, videoStream->time_base, AVRational{1, AV_TIME_BASE}) - m_clipStartUs;
+        clipProgress = (int)qBound<int64_t>(0, timeUs * 100 / durationUs, 100);
+    }
+    
+    int progress = qMin(99, (clipIndex * 100 + clipProgress) / (int)m_results.size());
+    if (progress != m_lastProgress) {
+        m_lastProgress = progress;
+        m_progressCallback(progress);
+    }
+}
+
+void StreamConcatenator::cleanup()
+{
+    closeClip();
+    m_audioWriter.reset();
+    
+    if (m_packet) {
+        av_packet_free(&m_packet);
+    }
+    
+    if (m_encodedPacket) {
+        av_packet_free(&m_encodedPacket);
+    }
+    
+    if (m_frame) {
+        av_frame_free(&m_frame);
+    }
+    
+    if (m_outputContext) {
+        if (!(m_outputContext->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&m_outputContext->pb);
+        }
+        avformat_free_context(m_outputContext);
+        m_outputContext = nullptr;
+    }
+    
+    if (m_videoReference) {
+        avcodec_parameters_free(&m_videoReference);
+    }
+    
+    if (m_audioReference) {
+        avcodec_parameters_free(&m_audioReference);
+    }
+    
+    m_videoOutput = nullptr;
+    m_audioOutput = nullptr;
+}
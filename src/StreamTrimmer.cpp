@@ -0,0 +1,681 @@
+#include "StreamTrimmer.h"
+#include "StreamCompat.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
+#include <QDebug>
+
+namespace {
+
+int64_t packetTime(const AVPacket *packet)
+{
+    return packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+}
+
+} // namespace
+
+StreamTrimmer::StreamTrimmer()
+    : m_inputContext(nullptr)
+    , m_outputContext(nullptr)
+    , m_decoderContext(nullptr)
+    , m_encoderContext(nullptr)
+    , m_videoOutput(nullptr)
+    , m_audioOutput(nullptr)
+    , m_packet(nullptr)
+    , m_frame(nullptr)
+    , m_videoStreamIndex(-1)
+    , m_audioStreamIndex(-1)
+    , m_startTs(0)
+    , m_endTs(0)
+    , m_audioStartTs(0)
+    , m_audioEndTs(0)
+    , m_inHead(true)
+    , m_leadingPending(false)
+    , m_tailPending(false)
+    , m_tailIndex(0)
+    , m_videoDone(false)
+    , m_audioDone(false)
+    , m_gopInside(true)
+    , m_copyStartPts(AV_NOPTS_VALUE)
+    , m_reorderDelay(AV_NOPTS_VALUE)
+    , m_lastDts(AV_NOPTS_VALUE)
+    , m_lastPts(AV_NOPTS_VALUE)
+    , m_nalLengthSize(0)
+    , m_needParameterSets(false)
+    , m_lastProgress(-1)
+{
+}
+
+StreamTrimmer::~StreamTrimmer()
+{
+    cleanup();
+}
+
+bool StreamTrimmer::trim(const QString &inputPath, const QString &outputPath, qint64 startMs, qint64 endMs)
+{
+    TraceScope span("trim/run");
+    
+    cleanup();
+    m_stats = Stats();
+    
+    if (endMs <= startMs) {
+        return false;
+    }
+    
+    if (!openInput(inputPath) || !openOutput(outputPath)) {
+        cleanup();
+        return false;
+    }
+    
+    // 区间换算为各流时间基 (加上文件起始时间)
+    int64_t fileStartUs = m_inputContext->start_time != AV_NOPTS_VALUE ? m_inputContext->start_time : 0;
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    m_startTs = av_rescale_q(fileStartUs + startMs * 1000, AVRational{1, AV_TIME_BASE}, videoStream->time_base);
+    m_endTs = av_rescale_q(fileStartUs + endMs * 1000, AVRational{1, AV_TIME_BASE}, videoStream->time_base);
+    if (m_audioStreamIndex >= 0) {
+        AVStream *audioStream = m_inputContext->streams[m_audioStreamIndex];
+        m_audioStartTs = av_rescale_q(fileStartUs + startMs * 1000, AVRational{1, AV_TIME_BASE}, audioStream->time_base);
+        m_audioEndTs = av_rescale_q(fileStartUs + endMs * 1000, AVRational{1, AV_TIME_BASE}, audioStream->time_base);
+    }
+    
+    m_inHead = true;
+    m_leadingPending = false;
+    m_tailPending = false;
+    m_tailIndex = 0;
+    m_videoDone = false;
+    m_audioDone = m_audioStreamIndex < 0;
+    m_gopInside = true;
+    m_copyStartPts = AV_NOPTS_VALUE;
+    m_reorderDelay = AV_NOPTS_VALUE;
+    m_lastDts = AV_NOPTS_VALUE;
+    m_lastPts = AV_NOPTS_VALUE;
+    m_needParameterSets = false;
+    m_lastProgress = -1;
+    
+    // 从起点之前最近的关键帧开始读取
+    if (startMs > 0 && !seekToStart()) {
+        qWarning() << "跳转到裁剪起点失败，从文件开头读取";
+    }
+    
+    bool ok = true;
+    while (ok && !(m_videoDone && m_audioDone)) {
+        int ret;
+        {
+            TraceScope readSpan("demux/readFrame");
+            ret = av_read_frame(m_inputContext, m_packet);
+        }
+        if (ret < 0) {
+            break;
+        }
+        
+        if (m_packet->stream_index == m_videoStreamIndex) {
+            ok = processVideoPacket(m_packet);
+        } else if (m_packet->stream_index == m_audioStreamIndex) {
+            ok = copyAudioPacket(m_packet);
+        }
+        av_packet_unref(m_packet);
+    }
+    
+    // 文件结束或区间已写完: 区间在一个GOP内时解码到终点就已结束，编码器中仍有缓存的帧
+    ok = ok && finishVideo();
+    
+    if (ok) {
+        TraceScope writeSpan("mux/writeTrailer");
+        ok = av_write_trailer(m_outputContext) >= 0;
+    }
+    
+    cleanup();
+    return ok;
+}
+
+bool StreamTrimmer::openInput(const QString &inputPath)
+{
+    if (avformat_open_input(&m_inputContext, inputPath.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    
+    if (avformat_find_stream_info(m_inputContext, nullptr) < 0) {
+        return false;
+    }
+    
+    m_videoStreamIndex = av_find_best_stream(m_inputContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (m_videoStreamIndex < 0) {
+        return false;
+    }
+    m_audioStreamIndex = av_find_best_stream(m_inputContext, AVMEDIA_TYPE_AUDIO, -1, m_videoStreamIndex, nullptr, 0);
+    if (m_audioStreamIndex < 0) {
+        m_audioStreamIndex = -1;
+    }
+    
+    // 只读取用到的流
+    for (unsigned int i = 0; i < m_inputContext->nb_streams; i++) {
+        if ((int)i != m_videoStreamIndex && (int)i != m_audioStreamIndex) {
+            m_inputContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+    
+    // 解码器只用于起点和终点所在的GOP
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    const AVCodec *decoder = avcodec_find_decoder(videoStream->codecpar->codec_id);
+    if (!decoder) {
+        return false;
+    }
+    
+    m_decoderContext = avcodec_alloc_context3(decoder);
+    if (!m_decoderContext || avcodec_parameters_to_context(m_decoderContext, videoStream->codecpar) < 0) {
+        return false;
+    }
+    m_decoderContext->pkt_timebase = videoStream->time_base;
+    ThreadingPolicy::instance().apply(m_decoderContext, ThreadingPolicy::Decode, ThreadingPolicy::TranscodeStages);
+    
+    if (avcodec_open2(m_decoderContext, decoder, nullptr) < 0) {
+        return false;
+    }
+    
+    m_nalLengthSize = StreamCompat::nalLengthSize(videoStream->codecpar);
+    m_parameterSets = StreamCompat::parameterSets(videoStream->codecpar, m_nalLengthSize);
+    
+    m_packet = av_packet_alloc();
+    m_frame = av_frame_alloc();
+    return m_packet && m_frame;
+}
+
+bool StreamTrimmer::openOutput(const QString &outputPath)
+{
+    avformat_alloc_output_context2(&m_outputContext, nullptr, nullptr, outputPath.toUtf8().constData());
+    if (!m_outputContext) {
+        return false;
+    }
+    
+    // 输出流参数与源流相同 (复制的数据包可直接写入)
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    m_videoOutput = avformat_new_stream(m_outputContext, nullptr);
+    if (!m_videoOutput || avcodec_parameters_copy(m_videoOutput->codecpar, videoStream->codecpar) < 0) {
+        return false;
+    }
+    m_videoOutput->codecpar->codec_tag = 0;
+    m_videoOutput->time_base = videoStream->time_base;
+    m_videoOutput->avg_frame_rate = videoStream->avg_frame_rate;
+    m_videoOutput->sample_aspect_ratio = videoStream->sample_aspect_ratio;
+    
+    if (m_audioStreamIndex >= 0) {
+        AVStream *audioStream = m_inputContext->streams[m_audioStreamIndex];
+        m_audioOutput = avformat_new_stream(m_outputContext, nullptr);
+        if (!m_audioOutput || avcodec_parameters_copy(m_audioOutput->codecpar, audioStream->codecpar) < 0) {
+            return false;
+        }
+        m_audioOutput->codecpar->codec_tag = 0;
+        m_audioOutput->time_base = audioStream->time_base;
+    }
+    
+    // 视频按GOP缓存后才写入，交错写入时等待所有流的数据包，不因时间差提前输出音频
+    m_outputContext->max_interleave_delta = 0;
+    
+    if (!(m_outputContext->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&m_outputContext->pb, outputPath.toUtf8().constData(), AVIO_FLAG_WRITE) < 0) {
+            return false;
+        }
+    }
+    
+    return avformat_write_header(m_outputContext, nullptr) >= 0;
+}
+
+bool StreamTrimmer::openEncoder()
+{
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    m_encoderContext = StreamCompat::openVideoEncoder(videoStream->codecpar, videoStream->time_base,
+                                                      av_guess_frame_rate(m_inputContext, videoStream, nullptr),
+                                                      m_inputContext->bit_rate);
+    return m_encoderContext != nullptr;
+}
+
+bool StreamTrimmer::seekToStart()
+{
+    if (av_seek_frame(m_inputContext, m_videoStreamIndex, m_startTs, AVSEEK_FLAG_BACKWARD) < 0) {
+        return false;
+    }
+    
+    // mp4按解码时间查找: 起点在某个关键帧的解码时间和显示时间之间时会落在这个关键帧上，
+    // 它的前导帧 (开放GOP中显示在它之前的帧) 在区间内，但要从前一个GOP开始解码才能得到
+    int64_t seekTs = m_startTs;
+    while (av_read_frame(m_inputContext, m_packet) >= 0) {
+        bool video = m_packet->stream_index == m_videoStreamIndex;
+        if (video && (m_packet->flags & AV_PKT_FLAG_KEY) && m_packet->pts != AV_NOPTS_VALUE
+            && m_packet->dts != AV_NOPTS_VALUE && m_packet->pts > m_startTs) {
+            seekTs = m_packet->dts - 1;
+        }
+        av_packet_unref(m_packet);
+        if (video) {
+            break;
+        }
+    }
+    
+    // 前面没有关键帧时 (文件的第一个GOP没有前导帧) 仍从原位置开始
+    if (seekTs != m_startTs && av_seek_frame(m_inputContext, m_videoStreamIndex, seekTs, AVSEEK_FLAG_BACKWARD) >= 0) {
+        return true;
+    }
+    return av_seek_frame(m_inputContext, m_videoStreamIndex, m_startTs, AVSEEK_FLAG_BACKWARD) >= 0;
+}
+
+bool StreamTrimmer::processVideoPacket(AVPacket *packet)
+{
+    if (m_videoDone) {
+        return true;
+    }
+    
+    bool keyframe = packet->flags & AV_PKT_FLAG_KEY;
+    int64_t pts = packetTime(packet);
+    
+    // 延迟由跳转后读到的第一个数据包 (关键帧) 决定: 头部重新编码的数据包在复制开始之前就已写入，须与复制部分一致
+    if (m_reorderDelay == AV_NOPTS_VALUE && packet->pts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE) {
+        m_reorderDelay = packet->pts - packet->dts;
+    }
+    
+    if (pts != AV_NOPTS_VALUE && m_progressCallback && m_endTs > m_startTs) {
+        int progress = (int)qBound<int64_t>(0, (pts - m_startTs) * 100 / (m_endTs - m_startTs), 99);
+        if (progress != m_lastProgress) {
+            m_lastProgress = progress;
+            m_progressCallback(progress);
+        }
+    }
+    
+    if (m_inHead) {
+        // 起点之后 (区间内) 的第一个关键帧之前的帧重新编码，从这个关键帧开始复制
+        if (!keyframe || pts == AV_NOPTS_VALUE || pts < m_startTs || pts >= m_endTs) {
+            return decodePacket(packet);
+        }
+        
+        m_inHead = false;
+        m_copyStartPts = pts;
+        
+        // 开放GOP: 关键帧之后解码、显示在它之前的前导帧要参考前一个GOP，由头部的解码器接着解码
+        // 并重新编码。关键帧也送入头部解码器作参考，它和之后显示的帧不编码 (由复制提供)
+        m_leadingPending = true;
+        if (!decodePacket(packet)) {
+            return false;
+        }
+    } else if (m_leadingPending && !keyframe && pts != AV_NOPTS_VALUE && pts < m_copyStartPts) {
+        if (!decodePacket(packet)) {
+            return false;
+        }
+    } else if (m_tailPending) {
+        // 终点处关键帧的前导帧缓存到遇到显示在关键帧之后的帧为止
+        if (keyframe || pts == AV_NOPTS_VALUE || pts >= packetTime(m_gop[m_tailIndex])) {
+            return finishTail();
+        }
+    } else {
+        // 前导帧在解码顺序上都在其余帧之前 (HEVC规定如此，H.264编码器的实际输出也是)，
+        // 遇到显示在关键帧之后的帧时头部的重新编码结束
+        if (m_leadingPending) {
+            if (!finishEdge()) {
+                return false;
+            }
+            m_leadingPending = false;
+        }
+        
+        if (keyframe && !m_gop.empty()) {
+            if (m_gopInside && pts != AV_NOPTS_VALUE && pts >= m_endTs) {
+                // 新的GOP从终点开始，但开放GOP中它的前导帧可能显示在终点之前: 先缓存下来，
+                // 读完前导帧后再决定是直接复制缓存的GOP，还是接着解码前导帧
+                m_tailPending = true;
+                m_tailIndex = m_gop.size();
+            } else {
+                if (!finishGop()) {
+                    return false;
+                }
+                
+                // 新的GOP从终点开始: 区间内的帧已全部写入
+                if (pts != AV_NOPTS_VALUE && pts >= m_endTs) {
+                    m_videoDone = true;
+                    return true;
+                }
+            }
+        }
+    }
+    
+    if (pts == AV_NOPTS_VALUE || pts >= m_endTs) {
+        m_gopInside = false;
+    }
+    
+    AVPacket *buffered = av_packet_clone(packet);
+    if (!buffered) {
+        return false;
+    }
+    m_gop.push_back(buffered);
+    return true;
+}
+
+bool StreamTrimmer::copyAudioPacket(AVPacket *packet)
+{
+    if (m_audioDone) {
+        return true;
+    }
+    
+    int64_t pts = packetTime(packet);
+    if (pts == AV_NOPTS_VALUE || pts < m_audioStartTs) {
+        return true;
+    }
+    if (pts >= m_audioEndTs) {
+        m_audioDone = true;
+        return true;
+    }
+    
+    // 时间戳以裁剪起点为零点
+    AVStream *audioStream = m_inputContext->streams[m_audioStreamIndex];
+    packet->pts -= m_audioStartTs;
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts -= m_audioStartTs;
+    }
+    av_packet_rescale_ts(packet, audioStream->time_base, m_audioOutput->time_base);
+    packet->stream_index = m_audioOutput->index;
+    packet->pos = -1;
+    
+    TraceScope span("mux/writeAudio");
+    return av_interleaved_write_frame(m_outputContext, packet) >= 0;
+}
+
+bool StreamTrimmer::finishGop()
+{
+    bool ok = true;
+    
+    if (m_gopInside) {
+        // 完整的GOP: 直接复制，跳过第一个关键帧之前显示的前导帧 (已由头部的解码器接着解码并重新编码)
+        TraceScope span("trim/copyGop");
+        for (AVPacket *packet : m_gop) {
+            int64_t pts = packetTime(packet);
+            if (pts != AV_NOPTS_VALUE && pts < m_copyStartPts) {
+                continue;
+            }
+            
+            // 前面重新编码的部分带有自己的参数集，恢复源流的参数集
+            if (m_needParameterSets && !StreamCompat::prependToPacket(packet, m_parameterSets)) {
+                ok = false;
+                break;
+            }
+            m_needParameterSets = false;
+            
+            if (!writeVideoPacket(packet)) {
+                ok = false;
+                break;
+            }
+            m_stats.copiedPackets++;
+        }
+    } else {
+        // 终点所在的GOP: 解码后重新编码终点之前的帧
+        TraceScope span("trim/encodeGop");
+        for (AVPacket *packet : m_gop) {
+            if (!decodePacket(packet)) {
+                ok = false;
+                break;
+            }
+            if (m_videoDone) {
+                break;
+            }
+        }
+        ok = ok && finishEdge();
+        m_videoDone = true;
+    }
+    
+    clearGop();
+    m_gopInside = true;
+    return ok;
+}
+
+bool StreamTrimmer::finishTail()
+{
+    m_tailPending = false;
+    
+    std::vector<AVPacket *> tail(m_gop.begin() + m_tailIndex, m_gop.end());
+    m_gop.resize(m_tailIndex);
+    m_gopInside = true;
+    
+    bool leadingInside = false;
+    for (AVPacket *packet : tail) {
+        int64_t pts = packetTime(packet);
+        if (pts != AV_NOPTS_VALUE && pts < m_endTs) {
+            leadingInside = true;
+        }
+    }
+    
+    // 解码前导帧要从缓存的GOP的关键帧开始，复制时数据包会被修改，先保留一份引用
+    std::vector<AVPacket *> decodeOrder;
+    bool ok = true;
+    if (leadingInside) {
+        for (AVPacket *packet : m_gop) {
+            AVPacket *reference = av_packet_clone(packet);
+            if (!reference) {
+                ok = false;
+                break;
+            }
+            decodeOrder.push_back(reference);
+        }
+    }
+    decodeOrder.insert(decodeOrder.end(), tail.begin(), tail.end());
+    
+    // 缓存的GOP直接复制，之后解码时其中的帧都已写入，只有终点之前的前导帧重新编码
+    ok = ok && finishGop();
+    if (ok && leadingInside) {
+        TraceScope span("trim/encodeTail");
+        for (AVPacket *packet : decodeOrder) {
+            if (!decodePacket(packet)) {
+                ok = false;
+                break;
+            }
+            if (m_videoDone) {
+                break;
+            }
+        }
+        ok = ok && finishEdge();
+    }
+    
+    for (AVPacket *packet : decodeOrder) {
+        av_packet_free(&packet);
+    }
+    m_videoDone = true;
+    return ok;
+}
+
+bool StreamTrimmer::finishVideo()
+{
+    // 区间在一个GOP内时解码到终点就结束了，编码器仍需冲刷，否则lookahead和帧级多线程中的帧不会写出
+    if (m_videoDone) {
+        return m_encoderContext ? finishEdge() : true;
+    }
+    
+    bool ok = true;
+    if (m_leadingPending) {
+        ok = finishEdge();
+        m_leadingPending = false;
+    }
+    if (m_tailPending) {
+        ok = finishTail() && ok;
+    } else {
+        ok = (m_inHead ? finishEdge() : finishGop()) && ok;
+    }
+    m_videoDone = true;
+    return ok;
+}
+
+bool StreamTrimmer::decodePacket(const AVPacket *packet)
+{
+    int ret;
+    {
+        TraceScope span("decode/sendPacket");
+        ret = avcodec_send_packet(m_decoderContext, packet);
+    }
+    if (ret < 0 && ret != AVERROR_EOF) {
+        // 损坏的数据包跳过，不中止裁剪
+        return true;
+    }
+    
+    while (true) {
+        {
+            TraceScope span("decode/receiveFrame");
+            ret = avcodec_receive_frame(m_decoderContext, m_frame);
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        
+        int64_t pts = m_frame->best_effort_timestamp != AV_NOPTS_VALUE ? m_frame->best_effort_timestamp : m_frame->pts;
+        
+        // 解码器按显示顺序输出，出现终点之后的帧时区间内的帧已全部取出
+        if (pts != AV_NOPTS_VALUE && pts >= m_endTs) {
+            av_frame_unref(m_frame);
+            m_videoDone = true;
+            return true;
+        }
+        
+        // 起点之前的帧和已经写入的帧不再编码；解码前导帧时复制起点及之后的帧由复制提供
+        if (pts == AV_NOPTS_VALUE || pts < m_startTs || (m_lastPts != AV_NOPTS_VALUE && pts <= m_lastPts)
+            || (m_leadingPending && pts >= m_copyStartPts)) {
+            av_frame_unref(m_frame);
+            continue;
+        }
+        
+        if (!m_encoderContext && !openEncoder()) {
+            av_frame_unref(m_frame);
+            return false;
+        }
+        
+        m_frame->pts = pts;
+        m_frame->pict_type = AV_PICTURE_TYPE_NONE;
+        {
+            TraceScope span("encode/sendFrame");
+            ret = avcodec_send_frame(m_encoderContext, m_frame);
+        }
+        av_frame_unref(m_frame);
+        if (ret < 0 || !writeEncodedPackets()) {
+            return false;
+        }
+        m_stats.encodedFrames++;
+    }
+}
+
+bool StreamTrimmer::finishEdge()
+{
+    bool ok = true;
+    
+    // 取出解码器中剩余的帧，之后解码器可用于下一段
+    if (!m_videoDone) {
+        ok = decodePacket(nullptr);
+    }
+    avcodec_flush_buffers(m_decoderContext);
+    
+    if (m_encoderContext) {
+        avcodec_send_frame(m_encoderContext, nullptr);
+        ok = writeEncodedPackets() && ok;
+        avcodec_free_context(&m_encoderContext);
+        m_needParameterSets = true;
+    }
+    return ok;
+}
+
+bool StreamTrimmer::writeEncodedPackets()
+{
+    while (true) {
+        int ret;
+        {
+            TraceScope span("encode/receivePacket");
+            ret = avcodec_receive_packet(m_encoderContext, m_packet);
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        
+        // 解码时间戳与复制部分保持相同的延迟 (源流没有解码时间戳时不延迟)
+        m_packet->dts = m_packet->pts - (m_reorderDelay != AV_NOPTS_VALUE ? m_reorderDelay : 0);
+        
+        if (!StreamCompat::convertEncodedPacket(m_packet, m_nalLengthSize)) {
+            av_packet_unref(m_packet);
+            return false;
+        }
+        
+        bool ok = writeVideoPacket(m_packet);
+        av_packet_unref(m_packet);
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+bool StreamTrimmer::writeVideoPacket(AVPacket *packet)
+{
+    // 解码时间戳必须严格递增
+    if (packet->dts != AV_NOPTS_VALUE) {
+        if (m_lastDts != AV_NOPTS_VALUE && packet->dts <= m_lastDts) {
+            packet->dts = m_lastDts + 1;
+        }
+        m_lastDts = packet->dts;
+    }
+    if (packet->pts != AV_NOPTS_VALUE && (m_lastPts == AV_NOPTS_VALUE || packet->pts > m_lastPts)) {
+        m_lastPts = packet->pts;
+    }
+    
+    // 时间戳以裁剪起点为零点
+    AVStream *videoStream = m_inputContext->streams[m_videoStreamIndex];
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts -= m_startTs;
+    }
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts -= m_startTs;
+    }
+    av_packet_rescale_ts(packet, videoStream->time_base, m_videoOutput->time_base);
+    packet->stream_index = m_videoOutput->index;
+    packet->pos = -1;
+    
+    TraceScope span("mux/writeVideo");
+    return av_interleaved_write_frame(m_outputContext, packet) >= 0;
+}
+
+void StreamTrimmer::clearGop()
+{
+    for (AVPacket *packet : m_gop) {
+        av_packet_free(&packet);
+    }
+    m_gop.clear();
+}
+
+void StreamTrimmer::cleanup()
+{
+    clearGop();
+    
+    if (m_packet) {
+        av_packet_free(&m_packet);
+    }
+    
+    if (m_frame) {
+        av_frame_free(&m_frame);
+    }
+    
+    if (m_encoderContext) {
+        avcodec_free_context(&m_encoderContext);
+    }
+    
+    if (m_decoderContext) {
+        avcodec_free_context(&m_decoderContext);
+    }
+    
+    if (m_outputContext) {
+        if (!(m_outputContext->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&m_outputContext->pb);
+        }
+        avformat_free_context(m_outputContext);
+        m_outputContext = nullptr;
+    }
+    
+    if (m_inputContext) {
+        avformat_close_input(&m_inputContext);
+    }
+    
+    m_videoOutput = nullptr;
+    m_audioOutput = nullptr;
+    m_videoStreamIndex = -1;
+    m_audioStreamIndex = -1;
+    m_parameterSets.clear();
+}
@@ -0,0 +1,138 @@
+#include "ThreadingPolicy.h"
+#include <QThread>
+#include <QtGlobal>
+
+namespace {
+// FFmpeg的H.264/HEVC帧级多线程超过16个线程后收益很小且会告警
+constexpr int kMaxCodecThreads = 16;
+}
+
+ThreadingPolicy::ThreadingPolicy()
+    : m_coreCount(0)
+    , m_concurrentJobs(1)
+{
+    for (std::atomic<int> &count : m_stageThreads) {
+        count = 0;
+    }
+    loadFromEnvironment();
+}
+
+ThreadingPolicy &ThreadingPolicy::instance()
+{
+    static ThreadingPolicy policy;
+    return policy;
+}
+
+int ThreadingPolicy::coreCount() const
+{
+    int count = m_coreCount;
+    return count > 0 ? count : qMax(1, QThread::idealThreadCount());
+}
+
+void ThreadingPolicy::setCoreCount(int count)
+{
+    m_coreCount = qMax(0, count);
+}
+
+void ThreadingPolicy::setConcurrentJobs(int jobs)
+{
+    m_concurrentJobs = qMax(1, jobs);
+}
+
+void ThreadingPolicy::setThreadCount(Stage stage, int count)
+{
+    m_stageThreads[stageSlot(stage)] = qMax(0, count);
+}
+
+int ThreadingPolicy::threadCount(Stage stage, int activeStages) const
+{
+    int manual = m_stageThreads[stageSlot(stage)];
+    if (manual > 0) {
+        return manual;
+    }
+    
+    // 每个任务分到的核心
+    int budget = qMax(1, coreCount() / m_concurrentJobs);
+    
+    // 按权重分给同时工作的阶段
+    activeStages |= stage;
+    int totalWeight = 0;
+    for (Stage s : { Decode, Convert, Encode }) {
+        if (activeStages & s) {
+            totalWeight += stageWeight(s);
+        }
+    }
+    
+    return qMax(1, budget * stageWeight(stage) / totalWeight);
+}
+
+void ThreadingPolicy::apply(AVCodecContext *context, Stage stage, int activeStages) const
+{
+    if (!context || !context->codec) {
+        return;
+    }
+    
+    // 硬件编解码器等不支持多线程的实现保持默认
+    int caps = context->codec->capabilities;
+    if (!(caps & (AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_OTHER_THREADS))) {
+        return;
+    }
+    
+    context->thread_count = qMin(threadCount(stage, activeStages), kMaxCodecThreads);
+    
+    // 同时允许帧级和片级多线程，由FFmpeg按编解码器能力选择 (帧级优先)
+    context->thread_type = 0;
+    if (caps & AV_CODEC_CAP_FRAME_THREADS) {
+        context->thread_type |= FF_THREAD_FRAME;
+    }
+    if (caps & AV_CODEC_CAP_SLICE_THREADS) {
+        context->thread_type |= FF_THREAD_SLICE;
+    }
+}
+
+void ThreadingPolicy::loadFromEnvironment()
+{
+    bool ok = false;
+    int value = qEnvironmentVariableIntValue("VIDEOEDITOR_CORES", &ok);
+    if (ok) {
+        setCoreCount(value);
+    }
+    
+    value = qEnvironmentVariableIntValue("VIDEOEDITOR_JOBS", &ok);
+    if (ok) {
+        setConcurrentJobs(value);
+    }
+    
+    value = qEnvironmentVariableIntValue("VIDEOEDITOR_DECODE_THREADS", &ok);
+    if (ok) {
+        setThreadCount(Decode, value);
+    }
+    
+    value = qEnvironmentVariableIntValue("VIDEOEDITOR_CONVERT_THREADS", &ok);
+    if (ok) {
+        setThreadCount(Convert, value);
+    }
+    
+    value = qEnvironmentVariableIntValue("VIDEOEDITOR_ENCODE_THREADS", &ok);
+    if (ok) {
+        setThreadCount(Encode, value);
+    }
+}
+
+int ThreadingPolicy::stageWeight(Stage stage)
+{
+    return stage == Decode ? 1 : 2;
+}
+
+int ThreadingPolicy::stageSlot(Stage stage)
+{
+    switch (stage) {
+    case Decode:
+        return 0;
+    case Convert:
+        return 1;
+    case Encode:
+    default:
+        return 2;
+    }
+}
@@ -0,0 +1,176 @@
+#include "Trace.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+std::atomic<bool> Trace::s_enabled{false};
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    int64_t startNs;
+    int64_t endNs;
+};
+
+// 单个线程的记录缓冲区，由注册表持有 (线程结束后仍可导出)
+struct ThreadBuffer {
+    int threadId = 0;
+    bool threadAlive = true;
+    QMutex mutex;                   // 记录线程与导出之间的锁，平时无竞争
+    std::vector<TraceEvent> events;
+    uint64_t dropped = 0;
+};
+
+// 每个线程最多保留的区间数 (约24MB)，超出部分丢弃并计数
+const size_t kMaxEventsPerThread = 1000000;
+
+struct Registry {
+    QMutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    int nextThreadId = 1;
+    QString outputPath;
+    int64_t originNs = 0;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+// 线程结束时标记缓冲区，下次start时回收
+struct ThreadBufferHolder {
+    ThreadBuffer *buffer = nullptr;
+
+    ~ThreadBufferHolder()
+    {
+        if (buffer) {
+            QMutexLocker locker(&registry().mutex);
+            buffer->threadAlive = false;
+        }
+    }
+};
+
+ThreadBuffer *threadBuffer()
+{
+    thread_local ThreadBufferHolder holder;
+    if (!holder.buffer) {
+        Registry &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+        holder.buffer = reg.buffers.back().get();
+        holder.buffer->threadId = reg.nextThreadId++;
+    }
+    return holder.buffer;
+}
+
+} // namespace
+
+void Trace::start(const QString &outputPath)
+{
+    Registry &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+
+    // 回收已结束线程的缓冲区，清空其余线程的旧记录
+    std::vector<std::unique_ptr<ThreadBuffer>> alive;
+    for (std::unique_ptr<ThreadBuffer> &buffer : reg.buffers) {
+        if (buffer->threadAlive) {
+            QMutexLocker bufferLocker(&buffer->mutex);
+            buffer->events.clear();
+            buffer->dropped = 0;
+            alive.push_back(std::move(buffer));
+        }
+    }
+    reg.buffers.swap(alive);
+
+    reg.outputPath = outputPath;
+    reg.originNs = nowNs();
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+bool Trace::stop()
+{
+    if (!s_enabled.exchange(false)) {
+        return false;
+    }
+
+    Registry &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+
+    // Chrome trace-event格式: 完整事件 (ph=X)，时间单位为微秒
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    uint64_t dropped = 0;
+
+    for (std::unique_ptr<ThreadBuffer> &buffer : reg.buffers) {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        QByteArray tid = QByteArray::number(buffer->threadId);
+
+        for (const TraceEvent &event : buffer->events) {
+            json += first ? "\n" : ",\n";
+            first = false;
+            json += "{\"name\":\"";
+            json += event.name;
+            json += "\",\"cat\":\"videoeditor\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+            json += tid;
+            json += ",\"ts\":";
+            json += QByteArray::number((event.startNs - reg.originNs) / 1000.0, 'f', 3);
+            json += ",\"dur\":";
+            json += QByteArray::number((event.endNs - event.startNs) / 1000.0, 'f', 3);
+            json += "}";
+        }
+
+        dropped += buffer->dropped;
+        buffer->events.clear();
+        buffer->events.shrink_to_fit();
+        buffer->dropped = 0;
+    }
+    json += "\n]}\n";
+
+    if (dropped > 0) {
+        qWarning() << "追踪记录过多，丢弃了" << (quint64)dropped << "个区间";
+    }
+
+    QFile file(reg.outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "无法写入追踪文件:" << reg.outputPath;
+        return false;
+    }
+    return file.write(json) == json.size();
+}
+
+void Trace::startFromEnvironment()
+{
+    QString outputPath = qEnvironmentVariable("VIDEOEDITOR_TRACE");
+    if (!outputPath.isEmpty()) {
+        start(outputPath);
+    }
+}
+
+void Trace::record(const char *name, int64_t startNs, int64_t endNs)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    ThreadBuffer *buffer = threadBuffer();
+    QMutexLocker locker(&buffer->mutex);
+
+    if (buffer->events.size() >= kMaxEventsPerThread) {
+        buffer->dropped++;
+        return;
+    }
+    buffer->events.push_back(TraceEvent{ name, startNs, endNs });
+}
+
+int64_t Trace::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -1,17 +1,28 @@
 #include "VideoDecoder.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
 #include <QDebug>
 
 VideoDecoder::VideoDecoder()
     : m_formatContext(nullptr)
     , m_codecContext(nullptr)
-    , m_swsContext(nullptr)
     , m_frame(nullptr)
     , m_packet(nullptr)
     , m_videoStreamIndex(-1)
+    , m_audioStreamIndex(-1)
+    , m_inputEof(false)
+    , m_hasPendingFrame(false)
+    , m_keyframesOnly(false)
+    , m_lastFrameMs(-1)
+    , m_containerIndexed(false)
+    , m_pipelineStages(ThreadingPolicy::SplitStages)
+    , m_threadCount(0)
     , m_width(0)
     , m_height(0)
     , m_frameRate(0.0)
+    , m_frameRateRational{25, 1}
     , m_totalFrames(0)
+    , m_duration(0)
 {
 }
 
@@ -23,6 +34,9 @@ VideoDecoder::~VideoDecoder()
 bool VideoDecoder::open(const QString &filePath)
 {
     m_filePath = filePath;
+    m_inputEof = false;
+    m_hasPendingFrame = false;
+    m_lastFrameMs = -1;
     
     // 打开视频文件
     if (avformat_open_input(&m_formatContext, filePath.toUtf8().constData(), nullptr, nullptr) < 0) {
@@ -35,12 +49,15 @@ bool VideoDecoder::open(const QString &filePath)
         return false;
     }
     
-    // 查找视频流
+    // 查找视频流和音频流
     m_videoStreamIndex = -1;
+    m_audioStreamIndex = -1;
     for (unsigned int i = 0; i < m_formatContext->nb_streams; i++) {
-        if (m_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        AVMediaType type = m_formatContext->streams[i]->codecpar->codec_type;
+        if (type == AVMEDIA_TYPE_VIDEO && m_videoStreamIndex == -1) {
             m_videoStreamIndex = i;
-            break;
+        } else if (type == AVMEDIA_TYPE_AUDIO && m_audioStreamIndex == -1) {
+            m_audioStreamIndex = i;
         }
     }
     
@@ -70,6 +87,12 @@ bool VideoDecoder::initDecoder()
         return false;
     }
     
+    ThreadingPolicy::instance().apply(m_codecContext, ThreadingPolicy::Decode, m_pipelineStages);
+    if (m_threadCount > 0) {
+        m_codecContext->thread_count = m_threadCount;
+    }
+    m_codecContext->skip_frame = m_keyframesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    
     if (avcodec_open2(m_codecContext, codec, nullptr) < 0) {
         return false;
     }
@@ -84,6 +107,9 @@ bool VideoDecoder::initDecoder()
     } else {
         m_frameRate = 25.0;
     }
+    m_frameRateRational = stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0 ? stream->avg_frame_rate : AVRational{25, 1};
+    
+    m_duration = m_formatContext->duration > 0 ? m_formatContext->duration * 1000 / AV_TIME_BASE : 0;
     
     if (stream->nb_frames > 0) {
         m_totalFrames = stream->nb_frames;
@@ -92,20 +118,13 @@ bool VideoDecoder::initDecoder()
         m_totalFrames = duration * m_frameRate;
     }
     
-    // 初始化像素格式转换
-    m_swsContext = sws_getContext(
-        m_width, m_height, m_codecContext->pix_fmt,
-        m_width, m_height, AV_PIX_FMT_RGB24,
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
-    
-    if (!m_swsContext) {
-        return false;
-    }
-    
     m_frame = av_frame_alloc();
     m_packet = av_packet_alloc();
     
+    // 容器自带索引时读取开销很小，没有时 (或索引时间不是显示时间时) 留到需要时再扫描
+    m_containerIndexed = avformat_index_get_entries_count(stream) > 0;
+    m_keyframeIndex.buildFromContainer(m_formatContext, m_videoStreamIndex);
+    
     return true;
 }
 
@@ -116,49 +135,243 @@ void VideoDecoder::close()
 
 bool VideoDecoder::decodeNextFrame(QImage &frame)
 {
-    while (av_read_frame(m_formatContext, m_packet) >= 0) {
-        if (m_packet->stream_index == m_videoStreamIndex) {
-            if (avcodec_send_packet(m_codecContext, m_packet) == 0) {
-                if (avcodec_receive_frame(m_codecContext, m_frame) == 0) {
-                    frame = avFrameToQImage(m_frame);
-                    av_packet_unref(m_packet);
-                    return true;
-                }
-            }
-        }
-        av_packet_unref(m_packet);
+    if (!receiveNextFrame()) {
+        return false;
     }
     
-    return false;
+    // 先释放调用方持有的上一帧，使其缓冲区可被复用
+    frame = QImage();
+    frame = avFrameToQImage(m_frame);
+    return true;
 }
 
-QImage VideoDecoder::avFrameToQImage(AVFrame *frame)
+int VideoDecoder::decodeFrames(std::vector<QImage> &frames, int maxFrames)
 {
-    AVFrame *rgbFrame = av_frame_alloc();
-    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB24, m_width, m_height, 1);
-    uint8_t *buffer = (uint8_t *)av_malloc(numBytes);
+    // 本批帧同时被调用方持有，复用池需容纳一整批
+    if (m_converter.poolSize() < maxFrames + 1) {
+        m_converter.setPoolSize(maxFrames + 1);
+    }
     
-    av_image_fill_arrays(rgbFrame->data, rgbFrame->linesize, buffer, AV_PIX_FMT_RGB24, m_width, m_height, 1);
-    sws_scale(m_swsContext, frame->data, frame->linesize, 0, m_height, rgbFrame->data, rgbFrame->linesize);
+    int count = 0;
+    while (count < maxFrames && receiveNextFrame()) {
+        frames.push_back(avFrameToQImage(m_frame));
+        count++;
+    }
+    
+    return count;
+}
+
+void VideoDecoder::setKeyframesOnly(bool enabled)
+{
+    m_keyframesOnly = enabled;
+    if (m_codecContext) {
+        m_codecContext->skip_frame = enabled ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    }
+}
+
+int VideoDecoder::decodeFrames(const std::function<bool(const AVFrame *)> &callback, int maxFrames)
+{
+    int count = 0;
+    while ((maxFrames < 0 || count < maxFrames) && receiveNextFrame()) {
+        count++;
+        if (!callback(m_frame)) {
+            break;
+        }
+    }
     
-    QImage image(m_width, m_height, QImage::Format_RGB888);
-    for (int y = 0; y < m_height; y++) {
-        memcpy(image.scanLine(y), rgbFrame->data[0] + y * rgbFrame->linesize[0], m_width * 3);
+    return count;
+}
+
+bool VideoDecoder::receiveNextFrame()
+{
+    if (!m_codecContext) {
+        return false;
     }
     
-    av_free(buffer);
-    av_frame_free(&rgbFrame);
+    if (m_hasPendingFrame) {
+        m_hasPendingFrame = false;
+        return true;
+    }
     
-    return image;
+    while (true) {
+        // 先取出解码器中已有的帧 (B帧或帧级多线程时一个数据包可能对应0或多帧)
+        int ret;
+        {
+            TraceScope span("decode/receiveFrame");
+            ret = avcodec_receive_frame(m_codecContext, m_frame);
+        }
+        if (ret == 0) {
+            m_lastFrameMs = frameTimestamp(m_frame);
+            return true;
+        }
+        if (ret != AVERROR(EAGAIN) || m_inputEof) {
+            // AVERROR_EOF: 冲刷完成，所有帧都已取出
+            return false;
+        }
+        
+        // 解码器需要更多输入
+        {
+            TraceScope span("demux/readPacket");
+            ret = av_read_frame(m_formatContext, m_packet);
+        }
+        if (ret < 0) {
+            // 文件结束: 发送空包进入冲刷模式，继续取出缓存的尾部帧
+            m_inputEof = true;
+            avcodec_send_packet(m_codecContext, nullptr);
+            continue;
+        }
+        
+        if (m_packet->stream_index == m_videoStreamIndex) {
+            // 只解码关键帧时非关键帧的数据包不送入解码器 (省去码流解析)
+            if (!m_keyframesOnly || (m_packet->flags & AV_PKT_FLAG_KEY)) {
+                // 损坏的数据包直接跳过
+                TraceScope span("decode/sendPacket");
+                avcodec_send_packet(m_codecContext, m_packet);
+            }
+        } else if (m_packet->stream_index == m_audioStreamIndex && m_audioPacketHandler) {
+            TraceScope span("demux/audioPacket");
+            m_audioPacketHandler(m_packet);
+        }
+        av_packet_unref(m_packet);
+    }
+}
+
+QImage VideoDecoder::avFrameToQImage(const AVFrame *frame)
+{
+    return m_converter.convert(frame);
+}
+
+AVStream *VideoDecoder::getAudioStream() const
+{
+    if (!m_formatContext || m_audioStreamIndex < 0) {
+        return nullptr;
+    }
+    return m_formatContext->streams[m_audioStreamIndex];
 }
 
 bool VideoDecoder::reset()
 {
+    if (!m_formatContext || !m_codecContext) {
+        return false;
+    }
+    
     av_seek_frame(m_formatContext, m_videoStreamIndex, 0, AVSEEK_FLAG_BACKWARD);
     avcodec_flush_buffers(m_codecContext);
+    m_inputEof = false;
+    m_hasPendingFrame = false;
+    m_lastFrameMs = -1;
     return true;
 }
 
+bool VideoDecoder::seek(qint64 milliseconds)
+{
+    if (!m_formatContext || !m_codecContext) {
+        return false;
+    }
+    
+    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+    int64_t timestamp = av_rescale_q(milliseconds, AVRational{1, 1000}, stream->time_base);
+    if (stream->start_time != AV_NOPTS_VALUE) {
+        timestamp += stream->start_time;
+    }
+    
+    if (av_seek_frame(m_formatContext, m_videoStreamIndex, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+        return false;
+    }
+    
+    avcodec_flush_buffers(m_codecContext);
+    m_inputEof = false;
+    m_hasPendingFrame = false;
+    m_lastFrameMs = -1;
+    return true;
+}
+
+bool VideoDecoder::seekToFrame(qint64 milliseconds)
+{
+    if (!m_formatContext || !m_codecContext) {
+        return false;
+    }
+    
+    TraceScope span("decode/seekToFrame");
+    
+    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+    int64_t timestamp = av_rescale_q(milliseconds, AVRational{1, 1000}, stream->time_base);
+    if (stream->start_time != AV_NOPTS_VALUE) {
+        timestamp += stream->start_time;
+    }
+    
+    // 有B帧的mp4等: 容器索引只有解码时间，读取各关键帧数据包的显示时间 (只读关键帧，开销远小于扫描)
+    if (!m_keyframeIndex.isReady() && m_containerIndexed) {
+        buildKeyframeIndex();
+    }
+    
+    KeyframeIndex::Entry keyframe;
+    bool indexed = m_keyframeIndex.keyframeBefore(timestamp, &keyframe);
+    
+    // 目标与当前位置之间没有关键帧: 继续向后解码比重新跳转少解码整个GOP的前半部分
+    bool decodeOn = indexed && !m_inputEof && m_lastFrameMs >= 0 &&
+                    m_lastFrameMs < milliseconds && keyframe.timeMs <= m_lastFrameMs;
+    
+    if (!decodeOn) {
+        if (indexed) {
+            if (av_seek_frame(m_formatContext, m_videoStreamIndex, keyframe.timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+                return false;
+            }
+            avcodec_flush_buffers(m_codecContext);
+            m_inputEof = false;
+            m_hasPendingFrame = false;
+            m_lastFrameMs = -1;
+        } else if (!seek(milliseconds)) {
+            return false;
+        }
+    }
+    
+    // 向后解码到覆盖目标时间的帧，之前的帧直接丢弃
+    while (receiveNextFrame()) {
+        qint64 frameMs = frameTimestamp(m_frame);
+        if (frameMs < 0 || frameMs + frameDuration(m_frame) > milliseconds) {
+            m_hasPendingFrame = true;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool VideoDecoder::buildKeyframeIndex()
+{
+    if (m_keyframeIndex.isReady()) {
+        return true;
+    }
+    if (!m_formatContext) {
+        return false;
+    }
+    return m_keyframeIndex.buildByScan(m_filePath, m_videoStreamIndex);
+}
+
+qint64 VideoDecoder::frameTimestamp(const AVFrame *frame) const
+{
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts == AV_NOPTS_VALUE || !m_formatContext) {
+        return -1;
+    }
+    
+    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+    if (stream->start_time != AV_NOPTS_VALUE) {
+        pts -= stream->start_time;
+    }
+    return av_rescale_q(pts, stream->time_base, AVRational{1, 1000});
+}
+
+qint64 VideoDecoder::frameDuration(const AVFrame *frame) const
+{
+    if (frame->duration > 0 && m_formatContext) {
+        AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+        return av_rescale_q(frame->duration, stream->time_base, AVRational{1, 1000});
+    }
+    return m_frameRate > 0 ? (qint64)(1000 / m_frameRate) : 40;
+}
+
 void VideoDecoder::cleanup()
 {
     if (m_packet) {
@@ -169,10 +382,7 @@ void VideoDecoder::cleanup()
         av_frame_free(&m_frame);
     }
     
-    if (m_swsContext) {
-        sws_freeContext(m_swsContext);
-        m_swsContext = nullptr;
-    }
+    m_converter.reset();
     
     if (m_codecContext) {
         avcodec_free_context(&m_codecContext);
@@ -181,4 +391,7 @@ void VideoDecoder::cleanup()
     if (m_formatContext) {
         avformat_close_input(&m_formatContext);
     }
+    
+    m_keyframeIndex.clear();
+    m_containerIndexed = false;
 }
@@ -1,19 +1,49 @@
 #include "VideoEncoder.h"
+#include "ThreadingPolicy.h"
+#include "AudioTrackWriter.h"
+#include "Trace.h"
 #include <QDebug>
 
+namespace {
+
+// QImage格式对应的FFmpeg像素格式，没有对应格式时返回AV_PIX_FMT_NONE
+AVPixelFormat imagePixelFormat(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGB888:
+        return AV_PIX_FMT_RGB24;
+    case QImage::Format_BGR888:
+        return AV_PIX_FMT_BGR24;
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+        // 按本机字节序存储 0xAARRGGBB (alpha不参与编码)
+        return AV_PIX_FMT_RGB32;
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+        return AV_PIX_FMT_RGBA;
+    default:
+        return AV_PIX_FMT_NONE;
+    }
+}
+
+} // namespace
+
 VideoEncoder::VideoEncoder()
     : m_formatContext(nullptr)
     , m_codecContext(nullptr)
     , m_swsContext(nullptr)
     , m_videoStream(nullptr)
     , m_frame(nullptr)
+    , m_inputFrame(nullptr)
     , m_packet(nullptr)
     , m_width(0)
     , m_height(0)
-    , m_frameRate(0.0)
+    , m_frameRate{25, 1}
     , m_bitRate(0)
     , m_frameCount(0)
     , m_useHardwareAccel(true)
+    , m_pipelineStages(ThreadingPolicy::MergeStages)
+    , m_threadCount(0)
 {
 }
 
@@ -22,8 +52,27 @@ VideoEncoder::~VideoEncoder()
     close();
 }
 
+bool VideoEncoder::setAudioSource(const QString &audioPath)
+{
+    m_audioWriter = std::make_unique<AudioTrackWriter>();
+    if (!m_audioWriter->openInput(audioPath)) {
+        m_audioWriter.reset();
+        return false;
+    }
+    return true;
+}
+
 bool VideoEncoder::open(const QString &outputPath, int width, int height, double frameRate, int64_t bitRate)
 {
+    return open(outputPath, width, height, av_d2q(frameRate, 100000), bitRate);
+}
+
+bool VideoEncoder::open(const QString &outputPath, int width, int height, AVRational frameRate, int64_t bitRate)
+{
+    if (frameRate.num <= 0 || frameRate.den <= 0) {
+        return false;
+    }
+    
     m_outputPath = outputPath;
     m_width = width;
     m_height = height;
@@ -42,10 +91,10 @@ bool VideoEncoder::initEncoder()
         return false;
     }
     
-    // 查找编码器 (优先硬件加速)
+    // 查找编码器 (配置允许时优先硬件加速)
     const AVCodec *codec = nullptr;
     
-    if (m_useHardwareAccel) {
+    if (m_useHardwareAccel && m_profile.hardware) {
         // 尝试NVIDIA硬件加速
         codec = avcodec_find_encoder_by_name("h264_nvenc");
         if (!codec) {
@@ -84,24 +133,26 @@ bool VideoEncoder::initEncoder()
     m_codecContext->codec_type = AVMEDIA_TYPE_VIDEO;
     m_codecContext->width = m_width;
     m_codecContext->height = m_height;
-    m_codecContext->time_base = AVRational{1, (int)(m_frameRate * 1000)};
-    m_codecContext->framerate = AVRational{(int)m_frameRate, 1};
-    m_codecContext->bit_rate = m_bitRate;
-    m_codecContext->gop_size = 12;
-    m_codecContext->max_b_frames = 2;
+    // 时间基为一帧 (29.97等非整数帧率也精确)，帧的pts即帧序号
+    m_codecContext->time_base = av_inv_q(m_frameRate);
+    m_codecContext->framerate = m_frameRate;
     m_codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
     
-    // 设置预设
-    if (codec->id == AV_CODEC_ID_H264) {
-        av_opt_set(m_codecContext->priv_data, "preset", "medium", 0);
-        av_opt_set(m_codecContext->priv_data, "tune", "zerolatency", 0);
-    }
+    // GOP、B帧、码率控制和preset/tune由编码配置决定
+    m_profile.apply(m_codecContext, m_bitRate);
     
     // 某些格式需要全局头
     if (m_formatContext->oformat->flags & AVFMT_GLOBALHEADER) {
         m_codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     }
     
+    // 编码线程数由线程策略统一分配
+    ThreadingPolicy::instance().apply(m_codecContext, ThreadingPolicy::Encode, m_pipelineStages);
+    int threads = m_threadCount > 0 ? m_threadCount : m_profile.threads;
+    if (threads > 0) {
+        m_codecContext->thread_count = threads;
+    }
+    
     // 打开编码器
     if (avcodec_open2(m_codecContext, codec, nullptr) < 0) {
         return false;
@@ -114,6 +165,11 @@ bool VideoEncoder::initEncoder()
     
     m_videoStream->time_base = m_codecContext->time_base;
     
+    // 添加音频流 (直接复制或转码为AAC)
+    if (m_audioWriter && !m_audioWriter->addStream(m_formatContext)) {
+        return false;
+    }
+    
     // 打开输出文件
     if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) {
         if (avio_open(&m_formatContext->pb, m_outputPath.toUtf8().constData(), AVIO_FLAG_WRITE) < 0) {
@@ -126,18 +182,8 @@ bool VideoEncoder::initEncoder()
         return false;
     }
     
-    // 初始化像素格式转换
-    m_swsContext = sws_getContext(
-        m_width, m_height, AV_PIX_FMT_RGB24,
-        m_width, m_height, AV_PIX_FMT_YUV420P,
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
-    
-    if (!m_swsContext) {
-        return false;
-    }
-    
-    // 分配帧
+    // 分配帧 (像素格式转换上下文在需要转换时按输入帧的格式创建)
+    m_inputFrame = av_frame_alloc();
     m_frame = av_frame_alloc();
     m_frame->format = m_codecContext->pix_fmt;
     m_frame->width = m_width;
@@ -163,42 +209,97 @@ bool VideoEncoder::encodeFrame(const QImage &image)
         return false;
     }
     
-    // 确保帧可写
-    if (av_frame_make_writable(m_frame) < 0) {
+    // sws_scale能直接读取的格式不再转换为RGB888 (避免整幅图像的复制)
+    QImage source = image;
+    AVPixelFormat format = imagePixelFormat(source.format());
+    if (format == AV_PIX_FMT_NONE) {
+        source = image.convertToFormat(QImage::Format_RGB888);
+        format = AV_PIX_FMT_RGB24;
+    }
+    
+    const uint8_t *srcData[1] = { source.constBits() };
+    int srcLinesize[1] = { (int)source.bytesPerLine() };
+    if (!scaleToFrame(srcData, srcLinesize, source.width(), source.height(), format)) {
+        return false;
+    }
+    
+    return sendFrame(m_frame);
+}
+
+bool VideoEncoder::encodeFrame(const AVFrame *frame)
+{
+    if (!m_codecContext || !m_frame || !frame) {
         return false;
     }
     
-    // 转换QImage为RGB数据
-    QImage rgbImage = image.convertToFormat(QImage::Format_RGB888);
+    // 格式和尺寸与编码器相同: 直接送入编码器 (引用计数的帧只增加引用，否则复制一次)
+    if (frame->format == m_codecContext->pix_fmt && frame->width == m_width && frame->height == m_height) {
+        if (av_frame_ref(m_inputFrame, frame) < 0) {
+            return false;
+        }
+        
+        // 不沿用源视频的帧类型 (libx264会按pict_type强制帧类型)
+        m_inputFrame->pict_type = AV_PICTURE_TYPE_NONE;
+        m_inputFrame->flags &= ~AV_FRAME_FLAG_KEY;
+        
+        bool ok = sendFrame(m_inputFrame);
+        av_frame_unref(m_inputFrame);
+        return ok;
+    }
+    
+    if (!scaleToFrame(frame->data, frame->linesize, frame->width, frame->height, (AVPixelFormat)frame->format)) {
+        return false;
+    }
+    return sendFrame(m_frame);
+}
+
+bool VideoEncoder::scaleToFrame(const uint8_t *const data[], const int linesize[], int width, int height, AVPixelFormat format)
+{
+    TraceScope span("encode/swsScale");
     
-    // 准备源数据
-    const uint8_t *srcData[1] = { rgbImage.bits() };
-    int srcLinesize[1] = { (int)rgbImage.bytesPerLine() };
+    // 源格式或尺寸变化时重新创建转换上下文
+    m_swsContext = sws_getCachedContext(m_swsContext,
+        width, height, format,
+        m_width, m_height, m_codecContext->pix_fmt,
+        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!m_swsContext) {
+        return false;
+    }
     
-    // 转换为YUV420P
-    sws_scale(m_swsContext, srcData, srcLinesize, 0, m_height, m_frame->data, m_frame->linesize);
+    // 编码器可能仍持有上一帧的缓冲区
+    if (av_frame_make_writable(m_frame) < 0) {
+        return false;
+    }
     
+    sws_scale(m_swsContext, data, linesize, 0, height, m_frame->data, m_frame->linesize);
+    return true;
+}
+
+bool VideoEncoder::sendFrame(AVFrame *frame)
+{
     // 设置PTS
-    m_frame->pts = m_frameCount++;
+    frame->pts = m_frameCount++;
+    frame->duration = 1;
     
     // 发送帧到编码器
-    if (avcodec_send_frame(m_codecContext, m_frame) < 0) {
-        return false;
+    {
+        TraceScope span("encode/sendFrame");
+        if (avcodec_send_frame(m_codecContext, frame) < 0) {
+            return false;
+        }
     }
     
     // 接收编码后的数据包
-    while (avcodec_receive_packet(m_codecContext, m_packet) == 0) {
-        // 重新缩放时间戳
-        av_packet_rescale_ts(m_packet, m_codecContext->time_base, m_videoStream->time_base);
-        m_packet->stream_index = m_videoStream->index;
-        
-        // 写入文件
-        if (av_interleaved_write_frame(m_formatContext, m_packet) < 0) {
-            av_packet_unref(m_packet);
+    if (!writePackets()) {
+        return false;
+    }
+    
+    // 写入与当前视频进度对应的音频
+    if (m_audioWriter) {
+        TraceScope span("mux/audio");
+        if (!m_audioWriter->writeUntil(m_frameCount / av_q2d(m_frameRate))) {
             return false;
         }
-        
-        av_packet_unref(m_packet);
     }
     
     return true;
@@ -212,18 +313,52 @@ bool VideoEncoder::finalize()
     
     // 刷新编码器
     avcodec_send_frame(m_codecContext, nullptr);
+    bool ok = writePackets();
     
-    while (avcodec_receive_packet(m_codecContext, m_packet) == 0) {
-        av_packet_rescale_ts(m_packet, m_codecContext->time_base, m_videoStream->time_base);
-        m_packet->stream_index = m_videoStream->index;
-        av_interleaved_write_frame(m_formatContext, m_packet);
-        av_packet_unref(m_packet);
+    // 写入剩余音频 (以视频时长为准)
+    if (m_audioWriter) {
+        TraceScope span("mux/audio");
+        if (!m_audioWriter->finish(m_frameCount / av_q2d(m_frameRate))) {
+            ok = false;
+        }
     }
     
     // 写入文件尾
-    av_write_trailer(m_formatContext);
+    TraceScope span("mux/writeTrailer");
+    if (av_write_trailer(m_formatContext) < 0) {
+        ok = false;
+    }
     
-    return true;
+    return ok;
+}
+
+bool VideoEncoder::writePackets()
+{
+    while (true) {
+        int ret;
+        {
+            TraceScope span("encode/receivePacket");
+            ret = avcodec_receive_packet(m_codecContext, m_packet);
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        
+        // 重新缩放时间戳
+        av_packet_rescale_ts(m_packet, m_codecContext->time_base, m_videoStream->time_base);
+        m_packet->stream_index = m_videoStream->index;
+        
+        // 写入文件
+        TraceScope span("mux/writeVideo");
+        ret = av_interleaved_write_frame(m_formatContext, m_packet);
+        av_packet_unref(m_packet);
+        if (ret < 0) {
+            return false;
+        }
+    }
 }
 
 void VideoEncoder::setHardwareAcceleration(bool enable)
@@ -233,6 +368,8 @@ void VideoEncoder::setHardwareAcceleration(bool enable)
 
 void VideoEncoder::cleanup()
 {
+    m_audioWriter.reset();
+    
     if (m_packet) {
         av_packet_free(&m_packet);
     }
@@ -241,6 +378,10 @@ void VideoEncoder::cleanup()
         av_frame_free(&m_frame);
     }
     
+    if (m_inputFrame) {
+        av_frame_free(&m_inputFrame);
+    }
+    
     if (m_swsContext) {
         sws_freeContext(m_swsContext);
         m_swsContext = nullptr;
@@ -1,13 +1,29 @@
 #include "VideoPlayer.h"
+#include "AudioOutput.h"
+#include "VideoDecoder.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
 #include <QDebug>
 #include <QThread>
+#include <QMutexLocker>
+#include <algorithm>
+
+namespace {
+// 显示线程取帧的超时 (毫秒)，超时后检查是否播放结束
+const int kPopTimeoutMs = 20;
+// 等待显示时间时单次最长等待 (毫秒)，暂停期间也按此间隔检查状态
+const int kMaxWaitMs = 10;
+// 没有关键帧索引时预取播放位置前后的时长 (毫秒)
+const qint64 kPrefetchWindowMs = 2000;
+}
 
 VideoPlayer::VideoPlayer(QObject *parent)
     : QObject(parent)
     , m_formatContext(nullptr)
     , m_codecContext(nullptr)
-    , m_swsContext(nullptr)
+    , m_audioCodecContext(nullptr)
     , m_videoStreamIndex(-1)
+    , m_audioStreamIndex(-1)
     , m_duration(0)
     , m_position(0)
     , m_width(0)
@@ -19,7 +35,33 @@ VideoPlayer::VideoPlayer(QObject *parent)
     , m_shouldStop(false)
     , m_seekRequested(false)
     , m_seekTarget(0)
+    , m_serial(0)
+    , m_decodeEof(false)
+    , m_droppedFrames(0)
+    , m_nextVideoPts(0)
+    , m_discardBeforeMs(-1)
+    , m_previewPending(false)
+    , m_gopStartMs(0)
+    , m_seekDeferred(false)
+    , m_deferredSeekTarget(0)
+    , m_prefetchCenter(0)
+    , m_prefetchRequest(0)
+    , m_videoStartOffsetMs(0)
+    , m_displayWidth(0)
+    , m_displayHeight(0)
+    , m_redrawRequested(false)
+    , m_scrubbing(false)
+    , m_resumeAfterScrub(false)
+    , m_seekRequestNs(0)
+    , m_latencySerial(-1)
+    , m_exactRecorded(false)
+    , m_indexCancel(false)
 {
+    bool ok = false;
+    int cacheMb = qEnvironmentVariableIntValue("VIDEOEDITOR_FRAME_CACHE_MB", &ok);
+    if (ok && cacheMb >= 0) {
+        m_frameCache.setBudget((int64_t)cacheMb * 1024 * 1024);
+    }
 }
 
 VideoPlayer::~VideoPlayer()
@@ -31,6 +73,7 @@ VideoPlayer::~VideoPlayer()
 bool VideoPlayer::openFile(const QString &filePath)
 {
     // 清理之前的资源
+    stop();
     cleanup();
     
     m_filePath = filePath;
@@ -69,6 +112,16 @@ bool VideoPlayer::openFile(const QString &filePath)
         return false;
     }
     
+    // 关键帧索引: 优先用容器自带的索引，没有 (或有B帧、索引中不是显示时间) 时后台读取，完成前按时间跳转
+    if (!m_keyframeIndex.buildFromContainer(m_formatContext, m_videoStreamIndex)) {
+        startIndexScan();
+    }
+    
+    // 音频可选: 没有音频流或没有输出设备时只播放画面，由系统时钟驱动
+    if (!initAudio()) {
+        qDebug() << "无可用音频，仅播放视频";
+    }
+    
     // 获取视频信息
     AVStream *videoStream = m_formatContext->streams[m_videoStreamIndex];
     m_width = m_codecContext->width;
@@ -76,6 +129,13 @@ bool VideoPlayer::openFile(const QString &filePath)
     m_duration = m_formatContext->duration * 1000 / AV_TIME_BASE; // 转换为毫秒
     m_bitRate = m_formatContext->bit_rate;
     
+    // 解码器的时间以视频流起点为零点，播放时间以文件起点为零点
+    m_videoStartOffsetMs = 0;
+    if (videoStream->start_time != AV_NOPTS_VALUE && m_formatContext->start_time != AV_NOPTS_VALUE) {
+        m_videoStartOffsetMs = av_rescale_q(videoStream->start_time, videoStream->time_base, AVRational{1, 1000}) -
+                               m_formatContext->start_time / 1000;
+    }
+    
     // 计算帧率
     if (videoStream->avg_frame_rate.den != 0) {
         m_frameRate = av_q2d(videoStream->avg_frame_rate);
@@ -102,9 +162,10 @@ bool VideoPlayer::openFile(const QString &filePath)
         if (packet->stream_index == m_videoStreamIndex) {
             if (avcodec_send_packet(m_codecContext, packet) == 0) {
                 if (avcodec_receive_frame(m_codecContext, frame) == 0) {
-                    QImage firstFrame = frameToQImage(frame);
-                    m_currentFrame = firstFrame;
-                    emit frameReady(firstFrame);
+                    // 线程尚未启动，此处是信箱唯一的写入者
+                    if (convertFrame(frame, m_mailbox.writeSlot())) {
+                        publishFrame(0);
+                    }
                     av_packet_unref(packet);
                     break;
                 }
@@ -119,6 +180,19 @@ bool VideoPlayer::openFile(const QString &filePath)
     // 重置到开始位置
     av_seek_frame(m_formatContext, m_videoStreamIndex, 0, AVSEEK_FLAG_BACKWARD);
     avcodec_flush_buffers(m_codecContext);
+    if (m_audioCodecContext) {
+        avcodec_flush_buffers(m_audioCodecContext);
+    }
+    
+    m_clock.reset(0);
+    m_position = 0;
+    m_nextVideoPts = 0;
+    m_discardBeforeMs = -1;
+    m_decodeEof = false;
+    m_droppedFrames = 0;
+    
+    // 暂停状态下也运行解码/显示线程，跳转后能立即显示目标帧
+    startThreads();
     
     return true;
 }
@@ -162,119 +236,332 @@ bool VideoPlayer::initDecoder()
         return false;
     }
     
+    // 播放时解码与格式转换同时进行
+    ThreadingPolicy::instance().apply(m_codecContext, ThreadingPolicy::Decode, ThreadingPolicy::SplitStages);
+    
     // 打开解码器
     if (avcodec_open2(m_codecContext, codec, nullptr) < 0) {
         emit error("无法打开解码器");
         return false;
     }
     
-    // 初始化像素格式转换上下文
-    m_swsContext = sws_getContext(
-        m_codecContext->width, m_codecContext->height, m_codecContext->pix_fmt,
-        m_codecContext->width, m_codecContext->height, AV_PIX_FMT_RGB24,
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
+    // 只有显示线程在转换，当前帧 + 正在发送到UI的帧会持有图像
+    m_converter.setPoolSize(4);
+    m_converter.setOutputFormat(QImage::Format_RGB32);
+    
+    return true;
+}
+
+bool VideoPlayer::initAudio()
+{
+    int streamIndex = av_find_best_stream(m_formatContext, AVMEDIA_TYPE_AUDIO, -1, m_videoStreamIndex, nullptr, 0);
+    if (streamIndex < 0) {
+        return false;
+    }
+    
+    AVCodecParameters *codecParams = m_formatContext->streams[streamIndex]->codecpar;
+    const AVCodec *codec = avcodec_find_decoder(codecParams->codec_id);
+    if (!codec) {
+        return false;
+    }
     
-    if (!m_swsContext) {
-        emit error("无法创建像素格式转换上下文");
+    m_audioCodecContext = avcodec_alloc_context3(codec);
+    if (!m_audioCodecContext) {
         return false;
     }
     
+    if (avcodec_parameters_to_context(m_audioCodecContext, codecParams) < 0 ||
+        avcodec_open2(m_audioCodecContext, codec, nullptr) < 0) {
+        avcodec_free_context(&m_audioCodecContext);
+        return false;
+    }
+    
+    m_audioOutput = std::make_unique<AudioOutput>(&m_clock);
+    if (!m_audioOutput->open(m_audioCodecContext)) {
+        m_audioOutput.reset();
+        avcodec_free_context(&m_audioCodecContext);
+        return false;
+    }
+    
+    m_audioStreamIndex = streamIndex;
     return true;
 }
 
 void VideoPlayer::play()
 {
-    if (m_isPlaying) {
+    if (m_isPlaying || !m_formatContext) {
         return;
     }
     
+    // 播放结束后再次播放从头开始
+    if (m_duration > 0 && m_position >= m_duration) {
+        seek(0);
+    }
+    
     m_isPlaying = true;
-    m_shouldStop = false;
+    startThreads();
     
-    // 在新线程中执行解码循环
-    m_workerThread = std::make_unique<QThread>();
-    QObject::connect(m_workerThread.get(), &QThread::started, this, [this]() {
-        decodeLoop();
-    });
-    m_workerThread->start();
+    m_clock.resume();
+    if (m_audioOutput) {
+        m_audioOutput->start();
+    }
+    wakeThreads();
 }
 
 void VideoPlayer::pause()
 {
     m_isPlaying = false;
+    m_clock.pause();
+    
+    if (m_audioOutput) {
+        m_audioOutput->suspend();
+    }
+    schedulePrefetch(m_position);
+    wakeThreads();
 }
 
 void VideoPlayer::stop()
 {
-    m_shouldStop = true;
     m_isPlaying = false;
+    m_clock.pause();
     
-    if (m_workerThread && m_workerThread->isRunning()) {
-        m_workerThread->quit();
-        m_workerThread->wait();
+    stopThreads();
+    
+    if (m_audioOutput) {
+        m_audioOutput->stop();
     }
 }
 
 void VideoPlayer::seek(qint64 milliseconds)
 {
-    m_seekRequested = true;
+    if (!m_formatContext) {
+        return;
+    }
+    
+    m_seekRequestNs = Trace::nowNs();
     m_seekTarget = milliseconds;
+    m_serial++;
+    m_seekRequested = true;
+    m_position = milliseconds;
+    
+    // 丢弃旧位置的帧和音频，同时唤醒阻塞在队列上的解码线程
+    m_frameQueue.clear();
+    if (m_audioOutput) {
+        m_audioOutput->flush(milliseconds);
+    }
+    m_clock.reset(milliseconds);
+    startThreads();
+    
+    // 拖动过程中不预取，停下来后再预取周围的帧
+    if (!m_isPlaying && !m_scrubbing) {
+        schedulePrefetch(milliseconds);
+    }
+    wakeThreads();
+}
+
+void VideoPlayer::beginScrub()
+{
+    if (m_scrubbing) {
+        return;
+    }
+    
+    m_resumeAfterScrub = m_isPlaying;
+    if (m_isPlaying) {
+        pause();
+    }
+    m_scrubbing = true;
+}
+
+void VideoPlayer::scrubTo(qint64 milliseconds)
+{
+    // 只记录最新目标并中止解码线程当前的工作，请求再密集也只解码最后一个
+    seek(milliseconds);
+}
+
+void VideoPlayer::endScrub(qint64 milliseconds)
+{
+    m_scrubbing = false;
+    seek(milliseconds);
+    
+    if (m_resumeAfterScrub) {
+        m_resumeAfterScrub = false;
+        play();
+    }
+}
+
+VideoPlayer::SeekLatency VideoPlayer::previewLatency() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_previewLatency;
+}
+
+VideoPlayer::SeekLatency VideoPlayer::exactLatency() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_exactLatency;
+}
+
+void VideoPlayer::recordSeekLatency(const PlaybackFrame &item)
+{
+    // 每次跳转只记录第一次显示预览帧和第一次显示目标帧
+    if (item.serial != m_latencySerial) {
+        m_latencySerial = item.serial;
+        m_exactRecorded = false;
+    } else if (item.preview || m_exactRecorded) {
+        return;
+    }
+    
+    int64_t requestNs = m_seekRequestNs;
+    if (requestNs <= 0) {
+        return;
+    }
+    
+    int64_t nowNs = Trace::nowNs();
+    qint64 latencyMs = (nowNs - requestNs) / 1000000;
+    Trace::record(item.preview ? "seek/toPreview" : "seek/toExact", requestNs, nowNs);
+    
+    QMutexLocker locker(&m_statsMutex);
+    SeekLatency &stats = item.preview ? m_previewLatency : m_exactLatency;
+    stats.count++;
+    stats.lastMs = latencyMs;
+    stats.maxMs = qMax(stats.maxMs, latencyMs);
+    stats.totalMs += latencyMs;
+    
+    // 目标帧直接命中时预览延迟与精确延迟相同
+    if (!item.preview) {
+        m_exactRecorded = true;
+    }
+}
+
+void VideoPlayer::startThreads()
+{
+    if (m_decodeThread) {
+        return;
+    }
+    
+    m_shouldStop = false;
+    m_frameQueue.restart();
+    
+    m_decodeThread.reset(QThread::create([this]() { decodeLoop(); }));
+    m_presentThread.reset(QThread::create([this]() { presentLoop(); }));
+    m_prefetchThread.reset(QThread::create([this]() { prefetchLoop(); }));
+    m_decodeThread->start();
+    m_presentThread->start();
+    m_prefetchThread->start();
+}
+
+void VideoPlayer::stopThreads()
+{
+    if (!m_decodeThread) {
+        return;
+    }
+    
+    m_shouldStop = true;
+    m_frameQueue.abort();
+    if (m_audioOutput) {
+        m_audioOutput->abort();
+    }
+    wakeThreads();
+    
+    m_decodeThread->wait();
+    m_presentThread->wait();
+    m_prefetchThread->wait();
+    m_decodeThread.reset();
+    m_presentThread.reset();
+    m_prefetchThread.reset();
+    
+    m_frameQueue.clear();
+    m_shouldStop = false;
+    
+    // 解码位置已超前于显示位置，下次启动时从当前显示位置继续
+    m_seekTarget = m_position.load();
+    m_seekRequestNs = 0;
+    m_serial++;
+    m_seekRequested = true;
+}
+
+void VideoPlayer::startIndexScan()
+{
+    m_indexCancel = false;
+    QString filePath = m_filePath;
+    int streamIndex = m_videoStreamIndex;
+    m_indexThread.reset(QThread::create([this, filePath, streamIndex]() {
+        m_keyframeIndex.buildByScan(filePath, streamIndex, &m_indexCancel);
+    }));
+    m_indexThread->start();
+}
+
+void VideoPlayer::stopIndexScan()
+{
+    if (m_indexThread) {
+        m_indexCancel = true;
+        m_indexThread->wait();
+        m_indexThread.reset();
+    }
+    m_keyframeIndex.clear();
+}
+
+void VideoPlayer::wakeThreads()
+{
+    QMutexLocker locker(&m_mutex);
+    m_condition.wakeAll();
 }
 
 void VideoPlayer::decodeLoop()
 {
     AVPacket *packet = av_packet_alloc();
     AVFrame *frame = av_frame_alloc();
-    
-    qint64 frameDelay = 1000 / m_frameRate; // 每帧延迟(毫秒)
+    int serial = m_serial;
+    bool inputEof = false;
     
     while (!m_shouldStop) {
         // 处理跳转请求
         if (m_seekRequested) {
-            qint64 timestamp = (m_seekTarget * AV_TIME_BASE) / 1000;
-            av_seek_frame(m_formatContext, -1, timestamp, AVSEEK_FLAG_BACKWARD);
-            avcodec_flush_buffers(m_codecContext);
-            m_position = m_seekTarget;
-            m_seekRequested = false;
+            handleSeek(serial);
+            inputEof = false;
         }
         
-        // 如果暂停,等待
-        if (!m_isPlaying) {
-            QThread::msleep(10);
+        // 跳转由缓存满足: 暂停时不必解码，开始播放时才真正跳转
+        if (m_seekDeferred) {
+            if (!m_isPlaying) {
+                QMutexLocker locker(&m_mutex);
+                if (!m_seekRequested && !m_shouldStop && !m_isPlaying) {
+                    m_condition.wait(&m_mutex);
+                }
+                continue;
+            }
+            m_seekDeferred = false;
+            seekDemuxer(m_deferredSeekTarget);
+        }
+        
+        // 已全部解码，等待跳转或停止
+        if (inputEof) {
+            QMutexLocker locker(&m_mutex);
+            if (!m_seekRequested && !m_shouldStop) {
+                m_condition.wait(&m_mutex);
+            }
             continue;
         }
         
         // 读取数据包
         int ret = av_read_frame(m_formatContext, packet);
         if (ret < 0) {
-            // 到达文件末尾
-            m_isPlaying = false;
-            emit positionChanged(m_duration);
-            av_packet_unref(packet);
-            break;
+            // 到达文件末尾: 冲刷解码器中剩余的帧
+            inputEof = true;
+            avcodec_send_packet(m_codecContext, nullptr);
+            if (receiveVideoFrames(frame, serial)) {
+                m_decodeEof = true;
+            }
+            continue;
         }
         
-        // 只处理视频流
         if (packet->stream_index == m_videoStreamIndex) {
-            // 发送数据包到解码器
             if (avcodec_send_packet(m_codecContext, packet) == 0) {
-                // 接收解码后的帧
-                if (avcodec_receive_frame(m_codecContext, frame) == 0) {
-                    // 转换为QImage
-                    QImage image = frameToQImage(frame);
-                    m_currentFrame = image;
-                    emit frameReady(image);
-                    
-                    // 更新播放位置
-                    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
-                    m_position = (frame->pts * 1000 * stream->time_base.num) / stream->time_base.den;
-                    emit positionChanged(m_position);
-                    
-                    // 控制播放速度
-                    QThread::msleep(frameDelay);
-                }
+                receiveVideoFrames(frame, serial);
             }
+        } else if (packet->stream_index == m_audioStreamIndex && !m_scrubbing) {
+            // 拖动期间不播放声音，跳过音频解码
+            decodeAudioPacket(packet, frame);
         }
         
         av_packet_unref(packet);
@@ -284,28 +571,370 @@ void VideoPlayer::decodeLoop()
     av_packet_free(&packet);
 }
 
-QImage VideoPlayer::frameToQImage(AVFrame *frame)
+void VideoPlayer::handleSeek(int &serial)
 {
-    // 分配RGB帧
-    AVFrame *rgbFrame = av_frame_alloc();
-    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB24, m_width, m_height, 1);
-    uint8_t *buffer = (uint8_t *)av_malloc(numBytes);
+    m_seekRequested = false;
+    qint64 target = m_seekTarget;
+    serial = m_serial;
     
-    av_image_fill_arrays(rgbFrame->data, rgbFrame->linesize, buffer, AV_PIX_FMT_RGB24, m_width, m_height, 1);
+    m_frameQueue.clear();
+    if (m_audioOutput) {
+        m_audioOutput->flush(target);
+    }
+    m_clock.reset(target);
+    m_nextVideoPts = target;
+    m_decodeEof = false;
+    
+    // 缓存命中: 直接送显，不必从关键帧重新解码
+    PlaybackFrame cached;
+    cached.frame = m_frameCache.lookup(m_videoStreamIndex, target, &cached.ptsMs, &cached.durationMs);
+    if (cached.frame) {
+        cached.serial = serial;
+        m_frameQueue.push(cached);
+        
+        // 继续播放时从该帧之后开始
+        m_discardBeforeMs = cached.ptsMs + cached.durationMs;
+        m_previewPending = false;
+        m_deferredSeekTarget = target;
+        m_seekDeferred = true;
+        return;
+    }
     
-    // 转换像素格式
-    sws_scale(m_swsContext, frame->data, frame->linesize, 0, m_height, rgbFrame->data, rgbFrame->linesize);
+    // 从关键帧向后解码，目标之前的帧在解码线程中丢弃，不放入队列也不做转换
+    m_seekDeferred = false;
+    seekDemuxer(target);
+    m_discardBeforeMs = target;
+    m_previewPending = m_scrubbing;
+}
+
+void VideoPlayer::seekDemuxer(qint64 target)
+{
+    // 目标时间换算为视频流的时间戳 (播放时间以文件起始时间为零点)
+    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+    int64_t timestamp = av_rescale(target, AV_TIME_BASE, 1000);
+    if (m_formatContext->start_time != AV_NOPTS_VALUE) {
+        timestamp += m_formatContext->start_time;
+    }
     
-    // 创建QImage
-    QImage image(m_width, m_height, QImage::Format_RGB888);
-    for (int y = 0; y < m_height; y++) {
-        memcpy(image.scanLine(y), rgbFrame->data[0] + y * rgbFrame->linesize[0], m_width * 3);
+    // 有索引时直接跳到目标之前最近的关键帧，否则由解复用器按时间查找
+    KeyframeIndex::Entry keyframe;
+    if (m_keyframeIndex.keyframeBefore(av_rescale_q(timestamp, AVRational{1, AV_TIME_BASE}, stream->time_base), &keyframe)) {
+        av_seek_frame(m_formatContext, m_videoStreamIndex, keyframe.timestamp, AVSEEK_FLAG_BACKWARD);
+    } else {
+        av_seek_frame(m_formatContext, -1, timestamp, AVSEEK_FLAG_BACKWARD);
+    }
+    avcodec_flush_buffers(m_codecContext);
+    if (m_audioCodecContext) {
+        avcodec_flush_buffers(m_audioCodecContext);
+    }
+    m_gopStartMs = target;
+}
+
+bool VideoPlayer::receiveVideoFrames(AVFrame *frame, int serial)
+{
+    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+    
+    while (!m_seekRequested && !m_shouldStop) {
+        int ret = avcodec_receive_frame(m_codecContext, frame);
+        if (ret < 0) {
+            return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+        }
+        
+        PlaybackFrame item;
+        item.serial = serial;
+        item.ptsMs = frameTimeMs(frame, stream->time_base);
+        if (frame->duration > 0) {
+            item.durationMs = av_rescale_q(frame->duration, stream->time_base, AVRational{1, 1000});
+        } else {
+            item.durationMs = m_frameRate > 0 ? (qint64)(1000 / m_frameRate) : 40;
+        }
+        
+        if (item.ptsMs < 0) {
+            item.ptsMs = m_nextVideoPts;
+        }
+        m_nextVideoPts = item.ptsMs + item.durationMs;
+        
+        // 解码出的每一帧 (包括跳转时丢弃的帧) 都放入缓存，来回拖动时不必重新解码
+        if (frame->flags & AV_FRAME_FLAG_KEY) {
+            m_gopStartMs = item.ptsMs;
+        }
+        m_frameCache.insert(m_videoStreamIndex, m_gopStartMs, item.ptsMs, item.durationMs, frame);
+        
+        // 跳转目标之前的帧: 拖动时第一帧 (关键帧) 作为预览立即显示，其余丢弃
+        if (item.ptsMs + item.durationMs <= m_discardBeforeMs) {
+            if (!m_previewPending) {
+                av_frame_unref(frame);
+                continue;
+            }
+            item.preview = true;
+        }
+        m_previewPending = false;
+        
+        // 队列中只保存帧引用，不做拷贝和格式转换
+        item.frame = av_frame_alloc();
+        av_frame_move_ref(item.frame, frame);
+        
+        if (!m_frameQueue.push(item)) {
+            return false;
+        }
     }
     
-    av_free(buffer);
-    av_frame_free(&rgbFrame);
+    return false;
+}
+
+void VideoPlayer::decodeAudioPacket(const AVPacket *packet, AVFrame *frame)
+{
+    if (!m_audioOutput || avcodec_send_packet(m_audioCodecContext, packet) < 0) {
+        return;
+    }
     
-    return image;
+    AVStream *stream = m_formatContext->streams[m_audioStreamIndex];
+    while (avcodec_receive_frame(m_audioCodecContext, frame) == 0) {
+        // 音频缓冲区满时在这里阻塞，视频队列同时起到限速作用
+        bool written = m_audioOutput->writeFrame(frame, frameTimeMs(frame, stream->time_base));
+        av_frame_unref(frame);
+        if (!written) {
+            break;
+        }
+    }
+}
+
+qint64 VideoPlayer::frameTimeMs(const AVFrame *frame, AVRational timeBase) const
+{
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts == AV_NOPTS_VALUE) {
+        return -1;
+    }
+    
+    // 音视频都以文件起始时间为零点
+    qint64 ms = av_rescale_q(pts, timeBase, AVRational{1, 1000});
+    if (m_formatContext->start_time != AV_NOPTS_VALUE) {
+        ms -= m_formatContext->start_time / 1000;
+    }
+    return qMax<qint64>(0, ms);
+}
+
+void VideoPlayer::presentLoop()
+{
+    while (!m_shouldStop) {
+        if (m_redrawRequested) {
+            redrawCurrentFrame();
+        }
+        
+        PlaybackFrame item;
+        if (!m_frameQueue.pop(item, kPopTimeoutMs)) {
+            // 队列已空且全部解码完成: 播放结束
+            if (m_isPlaying && m_decodeEof && !m_seekRequested && m_frameQueue.size() == 0) {
+                m_isPlaying = false;
+                m_clock.pause();
+                m_position = m_duration;
+                emit positionChanged(m_duration);
+                emit playbackFinished();
+            }
+            continue;
+        }
+        
+        // 跳转之前解码的帧
+        if (item.serial != m_serial) {
+            FrameQueue::release(item);
+            continue;
+        }
+        
+        // 预览帧不等待时钟，只显示画面不更新播放位置
+        if (item.preview) {
+            bool converted = convertFrame(item.frame, m_mailbox.writeSlot());
+            recordSeekLatency(item);
+            FrameQueue::release(item);
+            if (converted) {
+                publishFrame(item.ptsMs);
+            }
+            continue;
+        }
+        
+        // 显示时间已过且后面还有帧: 直接丢弃，不做转换
+        if (m_clock.now() > item.ptsMs + item.durationMs && m_frameQueue.size() > 0) {
+            m_droppedFrames++;
+            FrameQueue::release(item);
+            continue;
+        }
+        
+        // 先转换到信箱的写入槽再等待，到显示时间时直接发布
+        bool converted = convertFrame(item.frame, m_mailbox.writeSlot());
+        qint64 pts = item.ptsMs;
+        int serial = item.serial;
+        
+        // 暂停时等待中的帧已占用写入槽: 重绘当前帧后重新转换等待中的帧
+        bool due = converted && waitUntilDue(pts, serial);
+        while (!due && converted && m_redrawRequested) {
+            redrawCurrentFrame();
+            converted = convertFrame(item.frame, m_mailbox.writeSlot());
+            due = converted && waitUntilDue(pts, serial);
+        }
+        
+        if (!due) {
+            FrameQueue::release(item);
+            continue;
+        }
+        
+        recordSeekLatency(item);
+        FrameQueue::release(item);
+        
+        m_position = pts;
+        publishFrame(pts);
+        emit positionChanged(pts);
+    }
+}
+
+bool VideoPlayer::waitUntilDue(qint64 ptsMs, int serial)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    while (!m_shouldStop && serial == m_serial && !m_redrawRequested) {
+        qint64 delay = ptsMs - m_clock.now();
+        if (delay <= 0) {
+            return true;
+        }
+        m_condition.wait(&m_mutex, (unsigned long)qMin<qint64>(delay, kMaxWaitMs));
+    }
+    
+    return false;
+}
+
+void VideoPlayer::schedulePrefetch(qint64 centerMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_prefetchCenter = centerMs;
+    m_prefetchRequest++;
+    m_condition.wakeAll();
+}
+
+void VideoPlayer::prefetchLoop()
+{
+    // 预取用独立的解码器，不影响播放的读取位置；第一次预取时才打开
+    std::unique_ptr<VideoDecoder> decoder;
+    int handled = m_prefetchRequest;
+    
+    while (!m_shouldStop) {
+        qint64 center;
+        int request;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_shouldStop && (m_prefetchRequest == handled || m_isPlaying)) {
+                m_condition.wait(&m_mutex);
+            }
+            if (m_shouldStop) {
+                break;
+            }
+            request = m_prefetchRequest;
+            center = m_prefetchCenter;
+        }
+        handled = request;
+        
+        if (!decoder) {
+            decoder = std::make_unique<VideoDecoder>();
+            decoder->setPipelineStages(ThreadingPolicy::Decode);
+            if (!decoder->open(m_filePath)) {
+                return;
+            }
+        }
+        prefetchAround(*decoder, center, request);
+    }
+}
+
+void VideoPlayer::prefetchAround(VideoDecoder &decoder, qint64 centerMs, int request)
+{
+    TraceScope span("player/prefetch");
+    
+    // 预取 前一个GOP + 当前GOP + 后一个GOP，没有索引时取前后固定时长
+    qint64 center = centerMs - m_videoStartOffsetMs;
+    qint64 start = qMax<qint64>(0, center - kPrefetchWindowMs);
+    qint64 end = center + kPrefetchWindowMs;
+    
+    std::vector<qint64> keyframes = decoder.keyframeIndex().keyframeTimes();
+    if (!keyframes.empty()) {
+        int current = (int)(std::upper_bound(keyframes.begin(), keyframes.end(), center) - keyframes.begin()) - 1;
+        current = qMax(0, current);
+        start = qMax<qint64>(0, keyframes[qMax(0, current - 1)]);
+        end = current + 2 < (int)keyframes.size() ? keyframes[current + 2] : decoder.getDuration() + 1;
+    }
+    
+    if (!decoder.seekToFrame(start)) {
+        return;
+    }
+    
+    qint64 gopStartMs = start + m_videoStartOffsetMs;
+    decoder.decodeFrames([&](const AVFrame *frame) {
+        // 开始播放、开始拖动、有新的预取请求或停止时中止
+        if (m_shouldStop || m_isPlaying || m_scrubbing || m_prefetchRequest != request) {
+            return false;
+        }
+        
+        qint64 frameMs = decoder.frameTimestamp(frame);
+        if (frameMs >= end) {
+            return false;
+        }
+        
+        frameMs += m_videoStartOffsetMs;
+        if (frame->flags & AV_FRAME_FLAG_KEY) {
+            gopStartMs = frameMs;
+        }
+        m_frameCache.insert(m_videoStreamIndex, gopStartMs, frameMs, decoder.frameDuration(frame), frame);
+        return true;
+    });
+}
+
+bool VideoPlayer::convertFrame(AVFrame *frame, QImage &image)
+{
+    // 尺寸变化时转换器自动重建转换上下文；槽中的图像没有被UI持有时原地写入
+    m_converter.setOutputSize(QSize(m_displayWidth, m_displayHeight));
+    return m_converter.convertInto(frame, image);
+}
+
+void VideoPlayer::publishFrame(qint64 ptsMs)
+{
+    // 上一次通知还没被处理时不再发送，UI取帧时自然拿到最新的一帧，事件队列中最多只有一个通知
+    if (m_mailbox.publish(ptsMs)) {
+        emit frameReady();
+    }
+}
+
+void VideoPlayer::setDisplaySize(const QSize &size)
+{
+    if (size.width() == m_displayWidth && size.height() == m_displayHeight) {
+        return;
+    }
+    
+    m_displayWidth = size.isValid() ? size.width() : 0;
+    m_displayHeight = size.isValid() ? size.height() : 0;
+    
+    // 暂停时按新尺寸重新显示当前帧: 帧在缓存中时由显示线程直接重新转换，不经过跳转
+    // (不增加跳转序号、不清空队列、不计入跳转延迟)；不在缓存中时才重新解码
+    if (m_formatContext && !m_isPlaying && !m_scrubbing && m_decodeThread && m_position < m_duration) {
+        if (m_frameCache.contains(m_videoStreamIndex, m_position)) {
+            m_redrawRequested = true;
+            wakeThreads();
+        } else {
+            seek(m_position);
+        }
+    }
+}
+
+bool VideoPlayer::redrawCurrentFrame()
+{
+    m_redrawRequested = false;
+    
+    qint64 ptsMs = 0;
+    AVFrame *frame = m_frameCache.lookup(m_videoStreamIndex, m_position, &ptsMs);
+    if (!frame) {
+        return false;
+    }
+    
+    bool converted = convertFrame(frame, m_mailbox.writeSlot());
+    av_frame_free(&frame);
+    if (converted) {
+        publishFrame(ptsMs);
+    }
+    return converted;
 }
 
 QString VideoPlayer::getVideoInfo() const
@@ -326,14 +955,40 @@ QString VideoPlayer::getVideoInfo() const
 
 QImage VideoPlayer::getCurrentFrame()
 {
-    return m_currentFrame;
+    if (!m_formatContext) {
+        return QImage();
+    }
+    
+    // 从帧缓存取当前位置的解码帧，按原始分辨率转换
+    AVFrame *frame = m_frameCache.lookup(m_videoStreamIndex, m_position);
+    if (frame) {
+        FrameConverter converter;
+        QImage image = converter.convert(frame);
+        av_frame_free(&frame);
+        return image;
+    }
+    
+    // 缓存中没有时单独打开解码器解码当前位置的帧
+    VideoDecoder decoder;
+    QImage image;
+    if (decoder.open(m_filePath) && decoder.seekToFrame(qMax<qint64>(0, m_position - m_videoStartOffsetMs))) {
+        decoder.decodeNextFrame(image);
+    }
+    return image;
 }
 
 void VideoPlayer::cleanup()
 {
-    if (m_swsContext) {
-        sws_freeContext(m_swsContext);
-        m_swsContext = nullptr;
+    stopIndexScan();
+    m_frameCache.clear();
+    m_mailbox.reset();
+    m_converter.reset();
+    
+    // 先关闭音频设备，再释放解码器
+    m_audioOutput.reset();
+    
+    if (m_audioCodecContext) {
+        avcodec_free_context(&m_audioCodecContext);
     }
     
     if (m_codecContext) {
@@ -345,6 +1000,10 @@ void VideoPlayer::cleanup()
     }
     
     m_videoStreamIndex = -1;
+    m_audioStreamIndex = -1;
     m_duration = 0;
     m_position = 0;
+    m_seekRequested = false;
+    m_seekDeferred = false;
+    m_decodeEof = false;
 }
@@ -1,18 +1,223 @@
 #include "VideoProcessor.h"
 #include "VideoDecoder.h"
 #include "VideoEncoder.h"
+#include "AudioRemuxer.h"
+#include "StreamConcatenator.h"
+#include "StreamTrimmer.h"
+#include "ImageLoadPipeline.h"
+#include "SplitManifest.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QDebug>
-#include <QProcess>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
 }
 
+namespace {
+
+// 单独读一遍文件中的音频数据包 (按时间间隔抽帧时视频会跳转，音频不能与视频共用解复用)
+bool readAudioPackets(const QString &path, qint64 startMs, const std::function<void(AVPacket *)> &handler)
+{
+    AVFormatContext *context = nullptr;
+    if (avformat_open_input(&context, path.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    
+    int audioIndex = -1;
+    if (avformat_find_stream_info(context, nullptr) >= 0) {
+        // 与VideoDecoder相同，使用第一个音频流；其余流不读取
+        for (unsigned int i = 0; i < context->nb_streams; i++) {
+            if (audioIndex < 0 && context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+                audioIndex = i;
+            } else {
+                context->streams[i]->discard = AVDISCARD_ALL;
+            }
+        }
+    }
+    
+    if (audioIndex >= 0 && startMs > 0) {
+        int64_t timestamp = av_rescale(startMs, AV_TIME_BASE, 1000);
+        if (context->start_time != AV_NOPTS_VALUE) {
+            timestamp += context->start_time;
+        }
+        av_seek_frame(context, -1, timestamp, AVSEEK_FLAG_BACKWARD);
+    }
+    
+    AVPacket *packet = av_packet_alloc();
+    while (audioIndex >= 0 && packet && av_read_frame(context, packet) >= 0) {
+        if (packet->stream_index == audioIndex) {
+            handler(packet);
+        }
+        av_packet_unref(packet);
+    }
+    
+    av_packet_free(&packet);
+    avformat_close_input(&context);
+    return audioIndex >= 0;
+}
+
+// 自动分段编码时每段至少这么多帧: 段太短时启动编码器的开销和码率控制在段首的波动不划算
+const int kMinChunkFrames = 250;
+
+// 合成时预读图片的内存上限，分段并行编码时各段平分
+const qint64 kImageLoadBudget = 512LL * 1024 * 1024;
+
+// 按时长把时间轴平分成最多count段，每段从关键帧的显示时间开始 (第一段从头开始)，返回各段起点 (毫秒)
+std::vector<qint64> splitRangeStarts(const std::vector<qint64> &keyframes, qint64 durationMs, int count)
+{
+    std::vector<qint64> starts{0};
+    for (int i = 1; i < count && durationMs > 0; i++) {
+        auto keyframe = std::lower_bound(keyframes.begin(), keyframes.end(), durationMs * i / count);
+        if (keyframe != keyframes.end() && *keyframe > starts.back()) {
+            starts.push_back(*keyframe);
+        }
+    }
+    return starts;
+}
+
+// 并行拆分中的一段: 显示时间在 [startMs, endMs) 内的帧 (endMs为0表示到结尾)，
+// 写到单独的文件夹，序号从0开始
+struct SplitRange
+{
+    qint64 startMs = 0;
+    qint64 endMs = 0;
+    QString dir;
+    std::vector<SplitManifest::Entry> entries;
+    bool ok = false;
+};
+
+bool extractRange(const QString &videoPath, SplitRange &range, const FrameSink::Options &options, int decodeThreads,
+                  std::atomic<qint64> &decodedMs, const std::atomic<bool> &cancel)
+{
+    VideoDecoder decoder;
+    decoder.setThreadCount(decodeThreads);
+    if (!decoder.open(videoPath)) {
+        return false;
+    }
+    // 起点是关键帧的显示时间: 按时间跳转会落在这个关键帧 (索引按解码时间查找时不会晚于它) 或更早的关键帧上，
+    // 起点之前的帧在下面按显示时间丢弃，不需要精确跳转
+    if (range.startMs > 0 && !decoder.seek(range.startMs)) {
+        return false;
+    }
+    
+    std::unique_ptr<FrameSink> sink = FrameSink::create(options, range.dir);
+    if (!sink) {
+        return false;
+    }
+    sink->setFrameRate(av_d2q(decoder.getFrameRate(), 100000));
+    
+    // 与extractFrames相同，帧文件可能晚几帧写出，时间先排队
+    std::deque<qint64> pendingMs;
+    sink->setFileWrittenCallback([&](int index, const QString &fileName, const uint8_t *data, int64_t size) {
+        if (pendingMs.empty()) {
+            return false;
+        }
+        
+        SplitManifest::Entry entry;
+        entry.index = index;
+        entry.ptsMs = pendingMs.front();
+        entry.sourceFrame = index;
+        entry.fileName = fileName;
+        entry.size = size;
+        entry.hash = SplitManifest::contentHash(data, size);
+        pendingMs.pop_front();
+        range.entries.push_back(entry);
+        return true;
+    });
+    
+    // 两段的分界只按帧的显示时间判断: 跳转后先解码出的、显示时间在起点之前的帧 (开放GOP)
+    // 由上一段输出，上一段解码到起点为止。没有时间戳的帧留在当前段
+    bool ok = true;
+    qint64 positionMs = range.startMs;
+    decoder.decodeFrames([&](const AVFrame *frame) {
+        if (cancel) {
+            ok = false;
+            return false;
+        }
+        
+        qint64 frameMs = decoder.frameTimestamp(frame);
+        if (range.endMs > 0 && frameMs >= range.endMs) {
+            return false;
+        }
+        if (frameMs >= 0 && frameMs < range.startMs) {
+            return true;
+        }
+        
+        pendingMs.push_back(frameMs);
+        if (!sink->write(frame)) {
+            ok = false;
+            return false;
+        }
+        
+        if (frameMs > positionMs) {
+            decodedMs += frameMs - positionMs;
+            positionMs = frameMs;
+        }
+        return true;
+    });
+    
+    return sink->finish() && ok;
+}
+
+// 分段编码中的一段: 图片编码到单独的文件，每段的编码器从关键帧开始，段之间没有参考关系
+struct EncodeChunk
+{
+    QStringList imagePaths;
+    QString outputPath;
+    bool ok = false;
+};
+
+bool encodeChunk(const EncodeChunk &chunk, const EncodeProfile &profile, const QSize &size, double frameRate, int encodeThreads,
+                 int loadThreads, qint64 loadBudget, std::atomic<int> &encodedFrames, const std::atomic<bool> &cancel)
+{
+    // 硬件编码器同时打开的会话数有限，并行编码使用软件编码器
+    VideoEncoder encoder;
+    encoder.setProfile(profile);
+    encoder.setHardwareAcceleration(false);
+    encoder.setThreadCount(encodeThreads);
+    if (!encoder.open(chunk.outputPath, size.width(), size.height(), frameRate, 2000000)) {
+        return false;
+    }
+    
+    ImageLoadPipeline loader(chunk.imagePaths, size, QImage::Format_RGB32, loadThreads, loadBudget);
+    QImage image;
+    while (loader.next(image)) {
+        encodedFrames++;
+        if (cancel) {
+            loader.stop();
+            return false;
+        }
+        if (image.isNull()) {
+            continue;
+        }
+        if (!encoder.encodeFrame(image)) {
+            loader.stop();
+            return false;
+        }
+    }
+    
+    return encoder.finalize();
+}
+
+} // namespace
+
 VideoProcessor::VideoProcessor(QObject *parent)
     : QObject(parent)
+    , m_trimStartMs(0)
+    , m_trimEndMs(0)
+    , m_resumeSplit(false)
+    , m_splitWorkers(0)
+    , m_mergeWorkers(0)
+    , m_videoProgress(0)
+    , m_audioProgress(0)
 {
 }
 
@@ -53,182 +258,647 @@ void VideoProcessor::mergeVideo(const QString &imageDir, const QString &audioPat
     m_workerThread->start();
 }
 
-void VideoProcessor::saveCover(const QImage &frame, const QString &outputPath)
+void VideoProcessor::trimVideo(const QString &videoPath, const QString &outputPath, qint64 startMs, qint64 endMs)
+{
+    m_videoPath = videoPath;
+    m_outputPath = outputPath;
+    m_trimStartMs = startMs;
+    m_trimEndMs = endMs;
+    
+    // 在工作线程中执行
+    m_workerThread = std::make_unique<QThread>();
+    
+    QObject::connect(m_workerThread.get(), &QThread::started, this, &VideoProcessor::processTrim);
+    QObject::connect(m_workerThread.get(), &QThread::finished, m_workerThread.get(), &QThread::deleteLater);
+    
+    m_workerThread->start();
+}
+
+void VideoProcessor::concatVideos(const QStringList &inputPaths, const QString &outputPath)
+{
+    m_inputPaths = inputPaths;
+    m_outputPath = outputPath;
+    
+    // 在工作线程中执行
+    m_workerThread = std::make_unique<QThread>();
+    
+    QObject::connect(m_workerThread.get(), &QThread::started, this, &VideoProcessor::processConcat);
+    QObject::connect(m_workerThread.get(), &QThread::finished, m_workerThread.get(), &QThread::deleteLater);
+    
+    m_workerThread->start();
+}
+
+bool VideoProcessor::saveCover(const QImage &frame, const QString &outputPath)
 {
     if (frame.save(outputPath)) {
         emit finished(true, "封面保存成功！");
-    } else {
-        emit finished(false, "封面保存失败！");
+        return true;
     }
+    
+    emit finished(false, "封面保存失败！");
+    return false;
 }
 
 void VideoProcessor::processSplit()
 {
+    runSplit(m_videoPath, m_outputDir);
+}
+
+void VideoProcessor::processMerge()
+{
+    runMerge(m_imageDir, m_audioPath, m_outputPath);
+}
+
+void VideoProcessor::processTrim()
+{
+    runTrim(m_videoPath, m_outputPath, m_trimStartMs, m_trimEndMs);
+}
+
+void VideoProcessor::processConcat()
+{
+    runConcat(m_inputPaths, m_outputPath);
+}
+
+bool VideoProcessor::runSplit(const QString &videoPath, const QString &outputDir)
+{
+    TraceScope span("split");
+    
     // 创建输出目录
-    QDir dir(m_outputDir);
+    QDir dir(outputDir);
     if (!dir.exists()) {
         dir.mkpath(".");
     }
     
     // 创建frames子目录
-    QString framesDir = m_outputDir + "/frames";
+    QString framesDir = outputDir + "/frames";
     QDir().mkpath(framesDir);
     
-    // 提取帧
+    VideoDecoder decoder;
+    if (!decoder.open(videoPath)) {
+        emit finished(false, "提取视频帧失败！");
+        return false;
+    }
+    
+    // 音频与视频共用一次解复用：解码器读到的音频包直接交给重封装器；没有音频流时只输出帧
+    QString audioPath = outputDir + "/audio.mp3";
+    AVStream *audioStream = decoder.getAudioStream();
+    AudioRemuxer audioRemuxer;
+    if (audioStream && !audioRemuxer.open(audioStream, audioPath)) {
+        emit finished(false, "提取音频失败！");
+        return false;
+    }
+    
+    // 指定区间时音频只保留区间内的部分，时间戳从区间起点开始
+    const bool ranged = m_sampling.startMs > 0 || m_sampling.endMs > 0;
+    const qint64 rangeStartMs = qMax<qint64>(0, m_sampling.startMs);
+    const qint64 rangeEndMs = m_sampling.endMs > 0 ? m_sampling.endMs : decoder.getDuration();
+    const AVRational audioTimeBase = audioStream ? audioStream->time_base : AVRational{1, 1000};
+    const int64_t audioStart = audioStream && audioStream->start_time != AV_NOPTS_VALUE ? audioStream->start_time : 0;
+    const int64_t rangeOffset = av_rescale_q(rangeStartMs, AVRational{1, 1000}, audioTimeBase);
+    bool audioOk = true;
+    
+    auto writeAudio = [&](AVPacket *packet) {
+        if (packet->pts != AV_NOPTS_VALUE) {
+            qint64 packetMs = av_rescale_q(packet->pts - audioStart, audioTimeBase, AVRational{1, 1000});
+            if (ranged && (packetMs < rangeStartMs || (m_sampling.endMs > 0 && packetMs >= rangeEndMs))) {
+                return;
+            }
+            if (rangeEndMs > rangeStartMs) {
+                int audioPercentage = (int)qBound<qint64>(0, (packetMs - rangeStartMs) * 100 / (rangeEndMs - rangeStartMs), 100);
+                updateSplitProgress(m_videoProgress, audioPercentage);
+            }
+        }
+        if (rangeOffset > 0) {
+            packet->pts = packet->pts != AV_NOPTS_VALUE ? packet->pts - rangeOffset : AV_NOPTS_VALUE;
+            packet->dts = packet->dts != AV_NOPTS_VALUE ? packet->dts - rangeOffset : AV_NOPTS_VALUE;
+        }
+        if (!audioRemuxer.writePacket(packet)) {
+            audioOk = false;
+        }
+    };
+    
+    // 每帧一个文件的格式记录输出清单，续拆时从最后一个有效帧之后继续
+    std::unique_ptr<SplitManifest> manifest;
+    if (FrameSink::writesFramePerFile(m_frameSinkOptions.format)) {
+        manifest = std::make_unique<SplitManifest>();
+        QString manifestPath = framesDir + "/manifest.jsonl";
+        QJsonObject header = splitManifestHeader(videoPath);
+        if (m_resumeSplit && manifest->load(manifestPath, header)
+            && !manifest->entries().empty() && manifest->entries().back().ptsMs < 0) {
+            // 没有时间戳的帧无法定位，只能重新拆分
+            manifest->clearEntries();
+        }
+        if (!manifest->open(manifestPath, header)) {
+            emit finished(false, "无法写入拆分清单！");
+            return false;
+        }
+    } else if (m_resumeSplit) {
+        qWarning() << "y4m/ffv1输出为单个文件，不能续拆，重新拆分";
+    }
+    const int resumedFrames = manifest ? (int)manifest->entries().size() : 0;
+    
+    // 按时间间隔抽帧时在取样点之间跳转 (需要关键帧索引，容器没有索引时扫描一遍)，
+    // 跳过的部分不读取；续拆时视频从中间开始。这两种情况音频改为单独读取
+    bool seekBetweenSamples = m_sampling.intervalMs > 0 && decoder.buildKeyframeIndex();
+    
+    // 提取全部帧时按关键帧把时间轴分段，每段由单独的解码器在各自的线程中拆分。
+    // 一个解码器时像素转换和写文件都在调用线程中，核心较多时用不满；
+    // 默认每段分两个核心 (解码的帧级多线程和图片压缩)
+    std::vector<qint64> rangeStarts;
+    if (m_sampling.isFull() && manifest && resumedFrames == 0) {
+        ThreadingPolicy &policy = ThreadingPolicy::instance();
+        int workers = m_splitWorkers > 0 ? m_splitWorkers : policy.coreCount() / qMax(1, policy.concurrentJobs()) / 2;
+        if (workers > 1 && decoder.buildKeyframeIndex()) {
+            rangeStarts = splitRangeStarts(decoder.keyframeIndex().keyframeTimes(), decoder.getDuration(), workers);
+        }
+    }
+    const bool parallel = rangeStarts.size() > 1;
+    
+    bool separateAudio = seekBetweenSamples || resumedFrames > 0 || parallel;
+    if (!separateAudio) {
+        decoder.setAudioPacketHandler(writeAudio);
+    }
+    
+    m_videoProgress = 0;
+    m_audioProgress = 0;
     emit progressUpdated(10);
-    if (!extractFrames(m_videoPath, framesDir)) {
+    
+    // 提取帧 (同时复制音频)；并行拆分时音频在当前线程中与各段同时读取
+    bool framesOk;
+    if (parallel) {
+        framesOk = extractFramesParallel(videoPath, framesDir, rangeStarts, decoder.getDuration(), manifest.get(), [&]() {
+            if (audioStream && !readAudioPackets(videoPath, rangeStartMs, writeAudio)) {
+                audioOk = false;
+            }
+        });
+    } else {
+        framesOk = extractFrames(decoder, framesDir, seekBetweenSamples, manifest.get());
+    }
+    if (!framesOk) {
         emit finished(false, "提取视频帧失败！");
-        return;
+        return false;
     }
     
-    emit progressUpdated(60);
+    if (audioStream && separateAudio && !parallel && !readAudioPackets(videoPath, rangeStartMs, writeAudio)) {
+        audioOk = false;
+    }
     
-    // 提取音频
-    QString audioPath = m_outputDir + "/audio.mp3";
-    if (!extractAudio(m_videoPath, audioPath)) {
+    if (!audioOk || (audioStream && !audioRemuxer.finalize())) {
         emit finished(false, "提取音频失败！");
-        return;
+        return false;
     }
     
+    updateSplitProgress(100, 100);
     emit progressUpdated(100);
-    emit finished(true, "视频拆分完成！\n图片序列: " + framesDir + "\n音频文件: " + audioPath);
+    QString message = QString("视频拆分完成！\n视频帧 (%1): %2\n音频文件: %3")
+                      .arg(FrameSink::formatName(m_frameSinkOptions.format), framesDir, audioStream ? audioPath : "无 (视频没有音频流)");
+    if (resumedFrames > 0) {
+        message += QString("\n续拆: 保留已有的 %1 帧").arg(resumedFrames);
+    }
+    emit finished(true, message);
+    return true;
 }
 
-void VideoProcessor::processMerge()
+bool VideoProcessor::runMerge(const QString &imageDir, const QString &audioPath, const QString &outputPath)
 {
+    TraceScope span("merge");
+    
     emit progressUpdated(10);
     
-    if (!mergeFramesAndAudio(m_imageDir, m_audioPath, m_outputPath)) {
+    if (!mergeFramesAndAudio(imageDir, audioPath, outputPath)) {
         emit finished(false, "视频合成失败！");
-        return;
+        return false;
     }
     
     emit progressUpdated(100);
-    emit finished(true, "视频合成完成！\n输出文件: " + m_outputPath);
+    emit finished(true, "视频合成完成！\n输出文件: " + outputPath);
+    return true;
 }
 
-bool VideoProcessor::extractFrames(const QString &videoPath, const QString &framesDir)
+bool VideoProcessor::runCover(const QString &videoPath, qint64 positionMs, const QString &outputPath)
 {
-    VideoDecoder decoder;
+    TraceScope span("cover");
     
+    // 只解码单帧，不与其他阶段并行
+    VideoDecoder decoder;
+    decoder.setPipelineStages(ThreadingPolicy::Decode);
     if (!decoder.open(videoPath)) {
+        emit finished(false, "无法打开视频文件！");
+        return false;
+    }
+    
+    // 从关键帧解码到目标时间，之前的帧不做RGB转换
+    if (positionMs > 0 && !decoder.seekToFrame(positionMs)) {
+        emit finished(false, "跳转到指定时间失败！");
+        return false;
+    }
+    
+    QImage cover;
+    if (!decoder.decodeNextFrame(cover) || cover.isNull()) {
+        emit finished(false, "指定时间没有视频帧！");
+        return false;
+    }
+    
+    return saveCover(cover, outputPath);
+}
+
+bool VideoProcessor::runTranscode(const QString &inputPath, const QString &outputPath)
+{
+    TraceScope span("transcode");
+    
+    emit progressUpdated(0);
+    
+    VideoDecoder decoder;
+    decoder.setPipelineStages(ThreadingPolicy::TranscodeStages);
+    if (!decoder.open(inputPath)) {
+        emit finished(false, "无法打开视频文件！");
+        return false;
+    }
+    
+    // 源文件的音频直接复制或转码到输出文件
+    VideoEncoder encoder;
+    encoder.setPipelineStages(ThreadingPolicy::TranscodeStages);
+    if (decoder.getAudioStream() && !encoder.setAudioSource(inputPath)) {
+        emit finished(false, "无法读取音频文件！");
+        return false;
+    }
+    
+    encoder.setProfile(m_encodeProfile);
+    if (!encoder.open(outputPath, decoder.getWidth(), decoder.getHeight(), decoder.getFrameRateRational(), 2000000)) {
+        emit finished(false, "无法创建编码器！");
         return false;
     }
     
     int frameCount = 0;
-    int totalFrames = decoder.getTotalFrames();
-    QImage frame;
+    int64_t totalFrames = decoder.getTotalFrames();
+    int lastProgress = 0;
+    bool encodeFailed = false;
     
-    while (decoder.decodeNextFrame(frame)) {
-        QString framePath = QString("%1/frame_%2.jpg")
-            .arg(framesDir)
-            .arg(frameCount, 6, 10, QChar('0'));
-        
-        if (!frame.save(framePath, "JPEG", 95)) {
+    // 解码帧直接交给编码器: YUV420P的源不经过RGB，其余格式只做一次转换
+    decoder.decodeFrames([&](const AVFrame *frame) {
+        if (!encoder.encodeFrame(frame)) {
+            encodeFailed = true;
             return false;
         }
         
         frameCount++;
         
-        // 更新进度
         if (totalFrames > 0) {
-            int progress = 10 + (frameCount * 50 / totalFrames);
-            emit progressUpdated(progress);
+            int progress = (int)qMin<int64_t>(frameCount * 100 / totalFrames, 99);
+            if (progress != lastProgress) {
+                lastProgress = progress;
+                emit progressUpdated(progress);
+            }
         }
+        return true;
+    });
+    
+    if (encodeFailed) {
+        emit finished(false, "编码帧失败！");
+        encoder.close();
+        return false;
     }
     
-    decoder.close();
-    return frameCount > 0;
+    if (frameCount == 0 || !encoder.finalize()) {
+        emit finished(false, "写入视频文件失败！");
+        encoder.close();
+        return false;
+    }
+    encoder.close();
+    
+    emit progressUpdated(100);
+    emit finished(true, "视频转码完成！\n输出文件: " + outputPath);
+    return true;
 }
 
-bool VideoProcessor::extractAudio(const QString &videoPath, const QString &audioPath)
+bool VideoProcessor::runTrim(const QString &inputPath, const QString &outputPath, qint64 startMs, qint64 endMs)
 {
-    AVFormatContext *inputContext = nullptr;
-    AVFormatContext *outputContext = nullptr;
+    TraceScope span("trim");
     
-    // 打开输入文件
-    if (avformat_open_input(&inputContext, videoPath.toUtf8().constData(), nullptr, nullptr) < 0) {
+    emit progressUpdated(0);
+    
+    if (startMs < 0 || endMs <= startMs) {
+        emit finished(false, "裁剪区间无效！");
         return false;
     }
     
-    if (avformat_find_stream_info(inputContext, nullptr) < 0) {
-        avformat_close_input(&inputContext);
+    StreamTrimmer trimmer;
+    trimmer.setProgressCallback([this](int percentage) {
+        emit progressUpdated(percentage);
+    });
+    
+    if (!trimmer.trim(inputPath, outputPath, startMs, endMs)) {
+        emit finished(false, "视频裁剪失败！");
         return false;
     }
     
-    // 查找音频流
-    int audioStreamIndex = -1;
-    for (unsigned int i = 0; i < inputContext->nb_streams; i++) {
-        if (inputContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-            audioStreamIndex = i;
-            break;
-        }
+    const StreamTrimmer::Stats &stats = trimmer.stats();
+    emit progressUpdated(100);
+    emit finished(true, QString("视频裁剪完成！\n输出文件: %1\n直接复制 %2 个数据包，重新编码 %3 帧")
+                  .arg(outputPath).arg(stats.copiedPackets).arg(stats.encodedFrames));
+    return true;
+}
+
+bool VideoProcessor::runConcat(const QStringList &inputPaths, const QString &outputPath)
+{
+    TraceScope span("concat");
+    
+    emit progressUpdated(0);
+    
+    if (inputPaths.size() < 2) {
+        emit finished(false, "至少需要两个视频片段！");
+        return false;
     }
     
-    if (audioStreamIndex == -1) {
-        avformat_close_input(&inputContext);
+    StreamConcatenator concatenator;
+    concatenator.setProgressCallback([this](int percentage) {
+        emit progressUpdated(percentage);
+    });
+    
+    if (!concatenator.concat(inputPaths, outputPath)) {
+        emit finished(false, "视频拼接失败！");
         return false;
     }
     
-    // 创建输出上下文
-    avformat_alloc_output_context2(&outputContext, nullptr, nullptr, audioPath.toUtf8().constData());
-    if (!outputContext) {
-        avformat_close_input(&inputContext);
+    // 报告每个片段采用的方式
+    int copied = concatenator.streamCopyCount();
+    QString message = QString("视频拼接完成！\n输出文件: %1\n直接复制 %2 个片段，重新编码 %3 个片段")
+                      .arg(outputPath).arg(copied).arg(inputPaths.size() - copied);
+    for (const StreamConcatenator::ClipResult &result : concatenator.results()) {
+        if (!result.streamCopy) {
+            message += QString("\n重新编码: %1 (%2)").arg(QFileInfo(result.path).fileName(), result.reason);
+        }
+    }
+    
+    emit progressUpdated(100);
+    emit finished(true, message);
+    return true;
+}
+
+QJsonObject VideoProcessor::splitManifestHeader(const QString &videoPath) const
+{
+    // 源文件或任何影响输出的参数不同时，已有的帧不能续用
+    QFileInfo source(videoPath);
+    QJsonObject header;
+    header["source"] = source.absoluteFilePath();
+    header["sourceSize"] = source.size();
+    header["format"] = FrameSink::formatName(m_frameSinkOptions.format);
+    header["jpegQuality"] = m_frameSinkOptions.jpegQuality;
+    header["pngLevel"] = m_frameSinkOptions.pngCompression;
+    header["rawRgb"] = m_frameSinkOptions.rawRgb;
+    header["everyNth"] = m_sampling.everyNth;
+    header["interval"] = m_sampling.intervalMs;
+    header["start"] = m_sampling.startMs;
+    header["end"] = m_sampling.endMs;
+    header["keyframesOnly"] = m_sampling.keyframesOnly;
+    return header;
+}
+
+bool VideoProcessor::extractFrames(VideoDecoder &decoder, const QString &framesDir, bool seekBetweenSamples, SplitManifest *manifest)
+{
+    // 解码帧直接交给输出格式，不转换为QImage (jpeg/png/ffv1的压缩由编码器多线程完成)；
+    // 不输出的帧只解码，不做像素转换
+    std::unique_ptr<FrameSink> sink = FrameSink::create(m_frameSinkOptions, framesDir);
+    if (!sink) {
         return false;
     }
     
-    // 复制音频流
-    AVStream *inStream = inputContext->streams[audioStreamIndex];
-    AVStream *outStream = avformat_new_stream(outputContext, nullptr);
+    // 抽帧后的帧率 (y4m/ffv1写入文件头)
+    const int everyNth = qMax(1, m_sampling.everyNth);
+    AVRational frameRate = av_d2q(decoder.getFrameRate(), 100000);
+    if (m_sampling.intervalMs > 0) {
+        frameRate = AVRational{1000, (int)m_sampling.intervalMs};
+    } else if (everyNth > 1) {
+        frameRate = av_div_q(frameRate, AVRational{everyNth, 1});
+    }
+    sink->setFrameRate(frameRate);
+    
+    decoder.setKeyframesOnly(m_sampling.keyframesOnly);
     
-    if (!outStream) {
-        avformat_free_context(outputContext);
-        avformat_close_input(&inputContext);
+    const qint64 startMs = qMax<qint64>(0, m_sampling.startMs);
+    const qint64 endMs = m_sampling.endMs > 0 ? m_sampling.endMs : decoder.getDuration();
+    
+    int frameCount = 0;
+    qint64 decodedCount = 0;
+    qint64 nextSampleMs = startMs;
+    qint64 seekMs = startMs;
+    bool ok = true;
+    
+    // 续拆: 接着最后一个有效帧的序号和取样位置，从它之前的关键帧开始解码
+    qint64 resumeAfterMs = -1;
+    if (manifest && !manifest->entries().empty()) {
+        const SplitManifest::Entry &last = manifest->entries().back();
+        sink->setFirstIndex(last.index + 1);
+        frameCount = last.index + 1;
+        decodedCount = last.sourceFrame + 1;
+        resumeAfterMs = last.ptsMs;
+        seekMs = last.ptsMs;
+        while (m_sampling.intervalMs > 0 && nextSampleMs <= last.ptsMs) {
+            nextSampleMs += m_sampling.intervalMs;
+        }
+    }
+    
+    // 跳到区间起点: 之前的帧只解码不转换
+    if (seekMs > 0 && !seekBetweenSamples && !decoder.seekToFrame(seekMs)) {
         return false;
     }
     
-    avcodec_parameters_copy(outStream->codecpar, inStream->codecpar);
-    outStream->codecpar->codec_tag = 0;
+    // 清单记录每个帧文件。文件按提交顺序写出，但帧级多线程的编码器会晚几帧输出，
+    // 提交时的时间和帧序号先排队
+    std::deque<std::pair<qint64, qint64>> pendingFrames;
+    if (manifest) {
+        sink->setFileWrittenCallback([&](int index, const QString &fileName, const uint8_t *data, int64_t size) {
+            if (pendingFrames.empty()) {
+                return false;
+            }
+            
+            SplitManifest::Entry entry;
+            entry.index = index;
+            entry.ptsMs = pendingFrames.front().first;
+            entry.sourceFrame = pendingFrames.front().second;
+            entry.fileName = fileName;
+            entry.size = size;
+            pendingFrames.pop_front();
+            
+            TraceScope span("split/manifest");
+            entry.hash = SplitManifest::contentHash(data, size);
+            return manifest->append(entry);
+        });
+    }
     
-    // 打开输出文件
-    if (!(outputContext->oformat->flags & AVFMT_NOFILE)) {
-        if (avio_open(&outputContext->pb, audioPath.toUtf8().constData(), AVIO_FLAG_WRITE) < 0) {
-            avformat_free_context(outputContext);
-            avformat_close_input(&inputContext);
+    auto handleFrame = [&](const AVFrame *frame) {
+        qint64 frameMs = decoder.frameTimestamp(frame);
+        if (m_sampling.endMs > 0 && frameMs >= m_sampling.endMs) {
             return false;
         }
+        
+        // 续拆时已输出过的帧
+        if (resumeAfterMs >= 0 && frameMs >= 0 && frameMs <= resumeAfterMs) {
+            return true;
+        }
+        
+        bool selected;
+        if (m_sampling.intervalMs > 0) {
+            // 显示时间覆盖取样点的帧
+            selected = frameMs < 0 || frameMs + decoder.frameDuration(frame) > nextSampleMs;
+        } else {
+            selected = decodedCount % everyNth == 0;
+        }
+        qint64 sourceFrame = decodedCount++;
+        
+        if (selected) {
+            if (manifest) {
+                pendingFrames.emplace_back(frameMs, sourceFrame);
+            }
+            if (!sink->write(frame)) {
+                ok = false;
+                return false;
+            }
+            frameCount++;
+            
+            if (m_sampling.intervalMs > 0) {
+                do {
+                    nextSampleMs += m_sampling.intervalMs;
+                } while (nextSampleMs <= frameMs);
+            }
+        }
+        
+        // 更新进度
+        if (endMs > startMs && frameMs >= 0) {
+            updateSplitProgress((int)qBound<qint64>(0, (frameMs - startMs) * 100 / (endMs - startMs), 100), m_audioProgress);
+        }
+        return true;
+    };
+    
+    if (seekBetweenSamples) {
+        // 每次跳到下一个取样点: 之间隔着关键帧时直接跳转，否则继续向后解码
+        while (ok && (endMs <= 0 || nextSampleMs < endMs)) {
+            if (!decoder.seekToFrame(nextSampleMs)) {
+                break;
+            }
+            bool more = false;
+            decoder.decodeFrames([&](const AVFrame *frame) {
+                more = handleFrame(frame);
+                return more;
+            }, 1);
+            if (!more) {
+                break;
+            }
+        }
+    } else {
+        decoder.decodeFrames(handleFrame);
     }
     
-    // 写入头部
-    if (avformat_write_header(outputContext, nullptr) < 0) {
-        avio_closep(&outputContext->pb);
-        avformat_free_context(outputContext);
-        avformat_close_input(&inputContext);
+    if (!sink->finish() || !ok) {
         return false;
     }
+    return frameCount > 0;
+}
+
+bool VideoProcessor::extractFramesParallel(const QString &videoPath, const QString &framesDir, const std::vector<qint64> &rangeStarts,
+                                           qint64 durationMs, SplitManifest *manifest, const std::function<void()> &concurrentWork)
+{
+    const int count = (int)rangeStarts.size();
+    std::vector<SplitRange> ranges(count);
+    for (int i = 0; i < count; i++) {
+        ranges[i].startMs = rangeStarts[i];
+        ranges[i].endMs = i + 1 < count ? rangeStarts[i + 1] : 0;
+        ranges[i].dir = framesDir + QString("/.part_%1").arg(i);
+        QDir(ranges[i].dir).removeRecursively();
+        QDir().mkpath(ranges[i].dir);
+    }
     
-    // 复制数据包
-    AVPacket *packet = av_packet_alloc();
-    while (av_read_frame(inputContext, packet) >= 0) {
-        if (packet->stream_index == audioStreamIndex) {
-            av_packet_rescale_ts(packet, inStream->time_base, outStream->time_base);
-            packet->stream_index = 0;
-            av_interleaved_write_frame(outputContext, packet);
+    // 各段平分解码和图片压缩的线程
+    ThreadingPolicy &policy = ThreadingPolicy::instance();
+    const int decodeThreads = qMax(1, policy.threadCount(ThreadingPolicy::Decode, ThreadingPolicy::SplitStages) / count);
+    FrameSink::Options options = m_frameSinkOptions;
+    if (options.threads <= 0) {
+        options.threads = qMax(1, policy.threadCount(ThreadingPolicy::Convert, ThreadingPolicy::SplitStages) / count);
+    }
+    
+    std::atomic<qint64> decodedMs{0};
+    std::atomic<bool> cancel{false};
+    std::vector<std::unique_ptr<QThread>> threads;
+    for (int i = 0; i < count; i++) {
+        threads.emplace_back(QThread::create([&, i]() {
+            TraceScope span("split/range");
+            ranges[i].ok = extractRange(videoPath, ranges[i], options, decodeThreads, decodedMs, cancel);
+            if (!ranges[i].ok) {
+                cancel = true;
+            }
+        }));
+        threads.back()->start();
+    }
+    
+    if (concurrentWork) {
+        concurrentWork();
+    }
+    
+    for (auto &thread : threads) {
+        while (!thread->wait(100)) {
+            if (durationMs > 0) {
+                updateSplitProgress((int)qBound<qint64>(0, decodedMs * 100 / durationMs, 99), m_audioProgress);
+            }
         }
-        av_packet_unref(packet);
     }
+    threads.clear();
     
-    av_packet_free(&packet);
+    bool ok = true;
+    for (const SplitRange &range : ranges) {
+        ok = ok && range.ok;
+    }
     
-    // 写入尾部
-    av_write_trailer(outputContext);
+    // 按段的顺序换成连续的序号移到frames文件夹并记入清单，与不分段拆分的输出相同
+    int frameCount = 0;
+    for (int i = 0; ok && i < count; i++) {
+        QDir partDir(ranges[i].dir);
+        for (SplitManifest::Entry entry : ranges[i].entries) {
+            QByteArray suffix = QFileInfo(entry.fileName).suffix().toUtf8();
+            QString fileName = FrameSink::frameFileName(frameCount, suffix.constData());
+            QString target = framesDir + "/" + fileName;
+            QFile::remove(target);
+            if (!QFile::rename(partDir.filePath(entry.fileName), target)) {
+                ok = false;
+                break;
+            }
+            
+            entry.index = frameCount;
+            entry.sourceFrame = frameCount;
+            entry.fileName = fileName;
+            if (!manifest->append(entry)) {
+                ok = false;
+                break;
+            }
+            frameCount++;
+        }
+        
+        // 帧以外的文件 (raw的format.json) 各段相同，保留第一段的
+        if (ok && i == 0) {
+            for (const QString &name : partDir.entryList(QDir::Files)) {
+                QFile::remove(framesDir + "/" + name);
+                QFile::rename(partDir.filePath(name), framesDir + "/" + name);
+            }
+        }
+    }
     
-    // 清理
-    avio_closep(&outputContext->pb);
-    avformat_free_context(outputContext);
-    avformat_close_input(&inputContext);
+    for (const SplitRange &range : ranges) {
+        QDir(range.dir).removeRecursively();
+    }
     
-    return true;
+    return ok && frameCount > 0;
+}
+
+void VideoProcessor::updateSplitProgress(int videoPercentage, int audioPercentage)
+{
+    if (videoPercentage == m_videoProgress && audioPercentage == m_audioProgress) {
+        return;
+    }
+    
+    m_videoProgress = videoPercentage;
+    m_audioProgress = audioPercentage;
+    
+    emit streamProgressUpdated(m_videoProgress, m_audioProgress);
+    emit progressUpdated(10 + (m_videoProgress + m_audioProgress) * 90 / 200);
 }
 
 bool VideoProcessor::mergeFramesAndAudio(const QString &imageDir, const QString &audioPath, const QString &outputPath)
@@ -255,69 +925,155 @@ bool VideoProcessor::mergeFramesAndAudio(const QString &imageDir, const QString
     int height = firstImage.height();
     double frameRate = 25.0; // 默认帧率
     
-    // 创建编码器
+    QStringList imagePaths;
+    for (const QFileInfo &fileInfo : imageFiles) {
+        imagePaths << fileInfo.absoluteFilePath();
+    }
+    
+    // 图片较多时分段并行编码。一个编码器的帧内多线程在核心较多时用不满；
+    // 默认每段分两个核心 (编码和图片读取)
+    ThreadingPolicy &policy = ThreadingPolicy::instance();
+    int chunkCount;
+    if (m_mergeWorkers > 0) {
+        chunkCount = qMin(m_mergeWorkers, (int)imagePaths.size());
+    } else {
+        chunkCount = qMin(policy.coreCount() / qMax(1, policy.concurrentJobs()) / 2, (int)imagePaths.size() / kMinChunkFrames);
+    }
+    if (chunkCount > 1) {
+        return encodeChunked(imagePaths, QSize(width, height), frameRate, audioPath, outputPath, chunkCount);
+    }
+    
+    // 创建编码器 (有音频文件时音频在编码过程中直接写入同一文件)
     VideoEncoder encoder;
+    encoder.setProfile(m_encodeProfile);
+    if (!audioPath.isEmpty() && !encoder.setAudioSource(audioPath)) {
+        emit error("无法读取音频文件！");
+        return false;
+    }
+    
     if (!encoder.open(outputPath, width, height, frameRate, 2000000)) {
         emit error("无法创建编码器！");
         return false;
     }
     
-    // 编码所有图片
+    // 编码所有图片: 读取、解码、缩放由预读流水线并行完成，按原顺序交给编码器。
+    // 交付JPEG解码的原生格式RGB32，编码器的sws_scale直接读取，不再整幅转换为RGB888
+    ImageLoadPipeline loader(imagePaths, QSize(width, height), QImage::Format_RGB32);
+    
     int frameCount = 0;
     int totalFrames = imageFiles.size();
+    QImage image;
     
-    for (const QFileInfo &fileInfo : imageFiles) {
-        QImage image(fileInfo.absoluteFilePath());
+    while (loader.next(image)) {
+        frameCount++;
+        
         if (image.isNull()) {
             continue;
         }
         
-        // 确保图片尺寸一致
-        if (image.width() != width || image.height() != height) {
-            image = image.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        }
-        
         if (!encoder.encodeFrame(image)) {
             emit error("编码帧失败！");
+            loader.stop();
             encoder.close();
             return false;
         }
         
-        frameCount++;
         int progress = 10 + (frameCount * 80 / totalFrames);
         emit progressUpdated(progress);
     }
     
     // 完成编码
-    encoder.finalize();
+    if (!encoder.finalize()) {
+        emit error("写入视频文件失败！");
+        encoder.close();
+        return false;
+    }
     encoder.close();
     
-    // 使用FFmpeg合并音频 (如果有音频文件)
-    if (!audioPath.isEmpty() && QFile::exists(audioPath)) {
-        QString tempOutput = outputPath + ".temp.mp4";
-        QFile::rename(outputPath, tempOutput);
-        
-        QProcess ffmpeg;
-        QStringList args;
-        args << "-i" << tempOutput
-             << "-i" << audioPath
-             << "-c:v" << "copy"
-             << "-c:a" << "aac"
-             << "-strict" << "experimental"
-             << "-shortest"
-             << outputPath;
-        
-        ffmpeg.start("ffmpeg", args);
-        ffmpeg.waitForFinished(-1);
-        
-        if (ffmpeg.exitCode() == 0) {
-            QFile::remove(tempOutput);
-        } else {
-            // 如果合并失败,保留纯视频文件
-            QFile::rename(tempOutput, outputPath);
+    emit progressUpdated(100);
+    return true;
+}
+
+bool VideoProcessor::encodeChunked(const QStringList &imagePaths, const QSize &size, double frameRate,
+                                   const QString &audioPath, const QString &outputPath, int chunkCount)
+{
+    TraceScope span("merge/chunked");
+    
+    // 段比GOP长时每段的帧数取GOP长度的整数倍，各段的GOP与不分段编码时相同；段文件与输出使用同一种容器
+    const int gopSize = qMax(1, m_encodeProfile.gopSize);
+    int chunkFrames = ((int)imagePaths.size() + chunkCount - 1) / chunkCount;
+    if (chunkFrames > gopSize) {
+        chunkFrames = (chunkFrames + gopSize - 1) / gopSize * gopSize;
+    }
+    
+    const QString suffix = QFileInfo(outputPath).suffix();
+    std::vector<EncodeChunk> chunks;
+    QStringList chunkPaths;
+    for (int start = 0; start < imagePaths.size(); start += chunkFrames) {
+        EncodeChunk chunk;
+        chunk.imagePaths = imagePaths.mid(start, chunkFrames);
+        chunk.outputPath = QString("%1.part%2.%3").arg(outputPath).arg(chunks.size()).arg(suffix);
+        chunkPaths << chunk.outputPath;
+        chunks.push_back(chunk);
+    }
+    const int count = (int)chunks.size();
+    
+    // 各段平分编码和图片读取的线程以及预读内存
+    ThreadingPolicy &policy = ThreadingPolicy::instance();
+    const int encodeThreads = qMax(1, policy.threadCount(ThreadingPolicy::Encode, ThreadingPolicy::MergeStages) / count);
+    const int loadThreads = qMax(1, policy.threadCount(ThreadingPolicy::Convert, ThreadingPolicy::MergeStages) / count);
+    const qint64 loadBudget = kImageLoadBudget / count;
+    
+    std::atomic<int> encodedFrames{0};
+    std::atomic<bool> cancel{false};
+    std::vector<std::unique_ptr<QThread>> threads;
+    for (int i = 0; i < count; i++) {
+        threads.emplace_back(QThread::create([&, i]() {
+            TraceScope chunkSpan("merge/chunk");
+            chunks[i].ok = encodeChunk(chunks[i], m_encodeProfile, size, frameRate, encodeThreads, loadThreads, loadBudget, encodedFrames, cancel);
+            if (!chunks[i].ok) {
+                cancel = true;
+            }
+        }));
+        threads.back()->start();
+    }
+    
+    for (auto &thread : threads) {
+        while (!thread->wait(100)) {
+            emit progressUpdated(10 + encodedFrames * 80 / (int)imagePaths.size());
         }
     }
+    threads.clear();
     
-    emit progressUpdated(100);
-    return true;
+    bool ok = true;
+    for (const EncodeChunk &chunk : chunks) {
+        ok = ok && chunk.ok;
+    }
+    if (!ok) {
+        emit error("编码帧失败！");
+    }
+    
+    // 各段的编码参数相同，拼接时直接复制数据包，时间戳按前面各段的时长顺延；音频在拼接时写入
+    if (ok) {
+        emit progressUpdated(90);
+        StreamConcatenator concatenator;
+        if (!audioPath.isEmpty()) {
+            concatenator.setAudioSource(audioPath);
+        }
+        ok = concatenator.concat(chunkPaths, outputPath);
+        if (!ok) {
+            emit error("写入视频文件失败！");
+        } else if (concatenator.streamCopyCount() < count) {
+            qWarning() << "分段编码的参数不一致，部分段重新编码:" << count - concatenator.streamCopyCount();
+        }
+    }
+    
+    for (const QString &path : chunkPaths) {
+        QFile::remove(path);
+    }
+    
+    if (ok) {
+        emit progressUpdated(100);
+    }
+    return ok;
 }
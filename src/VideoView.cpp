@@ -0,0 +1,67 @@
+#include "VideoView.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+
+VideoView::VideoView(QWidget *parent)
+    : QWidget(parent)
+{
+    // 每次重绘都覆盖整个控件，不需要Qt先擦除背景
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void VideoView::setFrame(const QImage &frame)
+{
+    m_frame = frame;
+    update();
+}
+
+void VideoView::clearFrame()
+{
+    m_frame = QImage();
+    update();
+}
+
+void VideoView::setPlaceholderText(const QString &text)
+{
+    m_placeholderText = text;
+    update();
+}
+
+QSize VideoView::displaySize() const
+{
+    qreal ratio = devicePixelRatioF();
+    return QSize(qRound(width() * ratio), qRound(height() * ratio));
+}
+
+void VideoView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    
+    if (m_frame.isNull()) {
+        painter.setPen(Qt::white);
+        painter.drawText(rect(), Qt::AlignCenter, m_placeholderText);
+        return;
+    }
+    
+    // 帧按物理像素生成，换算为逻辑尺寸后居中；尺寸一致时为1:1拷贝
+    qreal ratio = devicePixelRatioF();
+    QSize frameSize(qRound(m_frame.width() / ratio), qRound(m_frame.height() / ratio));
+    if (frameSize.width() > width() || frameSize.height() > height()) {
+        // 控件刚缩小、新尺寸的帧还没到: 临时缩放到控件以内
+        frameSize = frameSize.scaled(size(), Qt::KeepAspectRatio);
+    }
+    
+    QRect target((width() - frameSize.width()) / 2, (height() - frameSize.height()) / 2,
+                 frameSize.width(), frameSize.height());
+    painter.drawImage(target, m_frame);
+}
+
+void VideoView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    emit displaySizeChanged(displaySize());
+}
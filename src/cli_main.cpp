@@ -0,0 +1,348 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <cstdio>
+#include "VideoProcessor.h"
+#include "EncodeProfile.h"
+#include "FrameSink.h"
+#include "ThreadingPolicy.h"
+#include "Trace.h"
+
+namespace {
+
+// 退出码: 0 全部成功, 1 有任务失败, 2 参数错误
+enum ExitCode {
+    ExitSuccess = 0,
+    ExitJobFailed = 1,
+    ExitUsage = 2
+};
+
+// 一个处理任务 (命令行参数或任务文件中的一项)
+struct Job
+{
+    QString command;        // split / merge / cover / transcode / trim / concat
+    QString input;          // 视频文件或图片文件夹
+    QStringList inputs;     // concat: 按顺序拼接的片段
+    QString output;         // 输出文件夹或输出文件
+    QString audio;          // merge: 音频文件 (可选)
+    qint64 position = 0;    // cover: 截取时间 (毫秒)
+    qint64 start = 0;       // trim/split: 起点 (毫秒)
+    qint64 end = 0;         // trim/split: 终点 (毫秒)
+    FrameSink::Options frames;  // split: 帧的输出格式
+    int everyNth = 1;       // split: 每N帧取一帧
+    qint64 interval = 0;    // split: 取样间隔 (毫秒)
+    bool keyframes = false; // split: 只提取关键帧
+    bool resume = false;    // split: 从上次中断处继续
+    int splitWorkers = 0;   // split: 并行拆分的段数，0表示自动
+    int mergeWorkers = 0;   // merge: 分段并行编码的段数，0表示自动
+    EncodeProfile::Kind profile = EncodeProfile::Throughput;   // merge/transcode: 编码配置
+    QString error;          // 任务文件中无法识别的参数，非空时任务失败
+};
+
+bool runJob(VideoProcessor &processor, const Job &job)
+{
+    if (!job.error.isEmpty()) {
+        fprintf(stderr, "%s\n", qPrintable(job.error));
+        return false;
+    }
+    
+    if (job.command == "split") {
+        FrameSampling sampling;
+        sampling.everyNth = job.everyNth;
+        sampling.intervalMs = job.interval;
+        sampling.startMs = job.start;
+        sampling.endMs = job.end;
+        sampling.keyframesOnly = job.keyframes;
+        processor.setFrameSampling(sampling);
+        processor.setFrameSinkOptions(job.frames);
+        processor.setResumeSplit(job.resume);
+        processor.setSplitWorkers(job.splitWorkers);
+        return processor.runSplit(job.input, job.output);
+    }
+    if (job.command == "merge") {
+        processor.setMergeWorkers(job.mergeWorkers);
+        processor.setEncodeProfile(EncodeProfile::forKind(job.profile));
+        return processor.runMerge(job.input, job.audio, job.output);
+    }
+    if (job.command == "cover") {
+        return processor.runCover(job.input, job.position, job.output);
+    }
+    if (job.command == "transcode") {
+        processor.setEncodeProfile(EncodeProfile::forKind(job.profile));
+        return processor.runTranscode(job.input, job.output);
+    }
+    if (job.command == "trim") {
+        return processor.runTrim(job.input, job.output, job.start, job.end);
+    }
+    if (job.command == "concat") {
+        return processor.runConcat(job.inputs, job.output);
+    }
+    
+    fprintf(stderr, "未知命令: %s\n", qPrintable(job.command));
+    return false;
+}
+
+Job jobFromJson(const QJsonObject &object)
+{
+    Job job;
+    job.command = object.value("command").toString();
+    job.input = object.value("input").toString();
+    job.output = object.value("output").toString();
+    job.audio = object.value("audio").toString();
+    job.position = object.value("position").toInteger();
+    job.start = object.value("start").toInteger();
+    job.end = object.value("end").toInteger();
+    for (const QJsonValue &value : object.value("inputs").toArray()) {
+        job.inputs.append(value.toString());
+    }
+    if (object.contains("frameFormat") && !FrameSink::parseFormat(object.value("frameFormat").toString(), &job.frames.format)) {
+        job.error = "未知的帧格式: " + object.value("frameFormat").toString();
+    }
+    job.frames.jpegQuality = object.value("jpegQuality").toInt(job.frames.jpegQuality);
+    job.frames.pngCompression = object.value("pngLevel").toInt(job.frames.pngCompression);
+    job.frames.rawRgb = object.value("rawRgb").toBool();
+    job.everyNth = object.value("everyNth").toInt(1);
+    job.interval = object.value("interval").toInteger();
+    job.keyframes = object.value("keyframesOnly").toBool();
+    job.resume = object.value("resume").toBool();
+    job.splitWorkers = object.value("splitWorkers").toInt();
+    job.mergeWorkers = object.value("mergeWorkers").toInt();
+    if (object.contains("profile") && !EncodeProfile::parseKind(object.value("profile").toString(), &job.profile)) {
+        job.error = "未知的编码配置: " + object.value("profile").toString();
+    }
+    return job;
+}
+
+// 读取任务文件: JSON数组，或每行一个JSON对象 (便于调度程序逐行追加)
+bool loadJobFile(const QString &path, QList<Job> &jobs)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "无法打开任务文件: %s\n", qPrintable(path));
+        return false;
+    }
+    
+    QByteArray content = file.readAll();
+    QJsonDocument document = QJsonDocument::fromJson(content);
+    if (document.isArray()) {
+        for (const QJsonValue &value : document.array()) {
+            jobs.append(jobFromJson(value.toObject()));
+        }
+        return true;
+    }
+    
+    int lineNumber = 0;
+    for (const QByteArray &line : content.split('\n')) {
+        lineNumber++;
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        
+        QJsonParseError parseError;
+        QJsonDocument lineDocument = QJsonDocument::fromJson(line, &parseError);
+        if (!lineDocument.isObject()) {
+            fprintf(stderr, "任务文件第%d行格式错误: %s\n", lineNumber, qPrintable(parseError.errorString()));
+            return false;
+        }
+        jobs.append(jobFromJson(lineDocument.object()));
+    }
+    return true;
+}
+
+// 按命令检查位置参数个数并组装任务
+bool jobFromArguments(const QStringList &arguments, Job &job)
+{
+    job.command = arguments.first();
+    
+    // concat <输出文件> <片段...>
+    if (job.command == "concat") {
+        if (arguments.size() < 4) {
+            return false;
+        }
+        job.output = arguments.at(1);
+        job.inputs = arguments.mid(2);
+        job.input = job.inputs.first();
+        return true;
+    }
+    
+    if (job.command != "split" && job.command != "merge"
+        && job.command != "cover" && job.command != "transcode" && job.command != "trim") {
+        return false;
+    }
+    if (arguments.size() != 3) {
+        return false;
+    }
+    
+    job.input = arguments.at(1);
+    job.output = arguments.at(2);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 只创建QCoreApplication，不加载平台插件，可在没有显示设备的服务器上运行
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("videoeditor-cli");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    QCoreApplication::setOrganizationName("VideoEditor");
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "视频剪辑助手命令行版\n\n"
+        "  split <视频文件> <输出文件夹>         拆分为帧序列 + 音频 (--frame-format 指定格式，--every/--interval/--keyframes/--start/--end 抽帧)\n"
+        "  merge <图片文件夹> <输出文件>         合成视频 (--audio 指定音频)\n"
+        "  cover <视频文件> <输出图片>           截取封面 (--time 指定时间)\n"
+        "  transcode <输入文件> <输出文件>       重新编码视频\n"
+        "  trim <输入文件> <输出文件>            无损裁剪片段 (--start/--end 指定区间)\n"
+        "  concat <输出文件> <片段...>           拼接多个片段 (参数一致时直接复制)\n"
+        "  jobs <任务文件>                       依次执行任务文件中的任务");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "split | merge | cover | transcode | trim | concat | jobs");
+    parser.addPositionalArgument("args", "命令参数", "[参数...]");
+    
+    QCommandLineOption audioOption(QStringList() << "a" << "audio", "合成时写入的音频文件", "file");
+    QCommandLineOption timeOption(QStringList() << "t" << "time", "封面截取时间 (毫秒)", "ms", "0");
+    QCommandLineOption startOption("start", "裁剪起点，拆分时为提取区间的起点 (毫秒)", "ms", "0");
+    QCommandLineOption endOption("end", "裁剪终点，拆分时为提取区间的终点 (毫秒)", "ms");
+    QCommandLineOption everyOption("every", "拆分时每N帧取一帧", "n", "1");
+    QCommandLineOption intervalOption("interval", "拆分时每隔一段时间取一帧 (毫秒)", "ms", "0");
+    QCommandLineOption keyframesOption("keyframes", "拆分时只提取关键帧");
+    QCommandLineOption resumeOption("resume", "拆分时校验已有的帧文件，从上次中断处继续");
+    QCommandLineOption splitWorkersOption("split-workers", "提取全部帧时按关键帧分段并行拆分的段数 (默认按核心数，1表示不分段)", "n", "0");
+    QCommandLineOption mergeWorkersOption("merge-workers", "合成时分段并行编码的段数 (默认按核心数，1表示不分段)", "n", "0");
+    QCommandLineOption profileOption("profile", "合成/转码的编码配置: throughput | archival | low-latency | size", "name", "throughput");
+    QCommandLineOption frameFormatOption("frame-format", "拆分时帧的输出格式: jpeg | png | raw | y4m | ffv1", "format", "jpeg");
+    QCommandLineOption jpegQualityOption("jpeg-quality", "jpeg质量 (1-100)", "n", "95");
+    QCommandLineOption pngLevelOption("png-level", "png压缩级别 (0-9)", "n", "3");
+    QCommandLineOption rawRgbOption("raw-rgb", "raw格式转换为RGB24 (默认保留YUV平面)");
+    QCommandLineOption coresOption("cores", "可使用的CPU核心数 (默认全部)", "n");
+    QCommandLineOption jobsOption("jobs", "同一台机器上同时运行的任务数，用于分配线程", "n");
+    QCommandLineOption quietOption(QStringList() << "q" << "quiet", "不输出进度");
+    QCommandLineOption traceOption("trace", "记录各阶段耗时并写出Chrome trace JSON (也可用环境变量VIDEOEDITOR_TRACE)", "file");
+    parser.addOption(audioOption);
+    parser.addOption(timeOption);
+    parser.addOption(startOption);
+    parser.addOption(endOption);
+    parser.addOption(everyOption);
+    parser.addOption(intervalOption);
+    parser.addOption(keyframesOption);
+    parser.addOption(resumeOption);
+    parser.addOption(splitWorkersOption);
+    parser.addOption(mergeWorkersOption);
+    parser.addOption(profileOption);
+    parser.addOption(frameFormatOption);
+    parser.addOption(jpegQualityOption);
+    parser.addOption(pngLevelOption);
+    parser.addOption(rawRgbOption);
+    parser.addOption(coresOption);
+    parser.addOption(jobsOption);
+    parser.addOption(quietOption);
+    parser.addOption(traceOption);
+    parser.process(app);
+    
+    QStringList arguments = parser.positionalArguments();
+    if (arguments.isEmpty()) {
+        fputs(qPrintable(parser.helpText()), stderr);
+        return ExitUsage;
+    }
+    
+    // 线程分配 (命令行参数优先于环境变量)
+    ThreadingPolicy &policy = ThreadingPolicy::instance();
+    if (parser.isSet(coresOption)) {
+        policy.setCoreCount(parser.value(coresOption).toInt());
+    }
+    if (parser.isSet(jobsOption)) {
+        policy.setConcurrentJobs(parser.value(jobsOption).toInt());
+    }
+    
+    QList<Job> jobs;
+    if (arguments.first() == "jobs") {
+        if (arguments.size() != 2 || !loadJobFile(arguments.at(1), jobs)) {
+            return ExitUsage;
+        }
+    } else {
+        Job job;
+        if (!jobFromArguments(arguments, job)) {
+            fputs(qPrintable(parser.helpText()), stderr);
+            return ExitUsage;
+        }
+        job.audio = parser.value(audioOption);
+        job.position = parser.value(timeOption).toLongLong();
+        job.start = parser.value(startOption).toLongLong();
+        job.end = parser.value(endOption).toLongLong();
+        job.everyNth = parser.value(everyOption).toInt();
+        job.interval = parser.value(intervalOption).toLongLong();
+        job.keyframes = parser.isSet(keyframesOption);
+        job.resume = parser.isSet(resumeOption);
+        job.splitWorkers = parser.value(splitWorkersOption).toInt();
+        job.mergeWorkers = parser.value(mergeWorkersOption).toInt();
+        if (!EncodeProfile::parseKind(parser.value(profileOption), &job.profile)) {
+            fprintf(stderr, "未知的编码配置: %s\n", qPrintable(parser.value(profileOption)));
+            return ExitUsage;
+        }
+        if (!FrameSink::parseFormat(parser.value(frameFormatOption), &job.frames.format)) {
+            fprintf(stderr, "未知的帧格式: %s\n", qPrintable(parser.value(frameFormatOption)));
+            return ExitUsage;
+        }
+        job.frames.jpegQuality = parser.value(jpegQualityOption).toInt();
+        job.frames.pngCompression = parser.value(pngLevelOption).toInt();
+        job.frames.rawRgb = parser.isSet(rawRgbOption);
+        jobs.append(job);
+    }
+    
+    if (parser.isSet(traceOption)) {
+        Trace::start(parser.value(traceOption));
+    } else {
+        Trace::startFromEnvironment();
+    }
+    
+    // 所有任务都在主线程同步执行，信号直接连接
+    VideoProcessor processor;
+    bool quiet = parser.isSet(quietOption);
+    int lastProgress = -1;
+    
+    QObject::connect(&processor, &VideoProcessor::progressUpdated, [&](int percentage) {
+        if (!quiet && percentage != lastProgress) {
+            lastProgress = percentage;
+            fprintf(stderr, "\r%3d%%", percentage);
+        }
+    });
+    QObject::connect(&processor, &VideoProcessor::error, [](const QString &errorMsg) {
+        fprintf(stderr, "\n错误: %s\n", qPrintable(errorMsg));
+    });
+    QObject::connect(&processor, &VideoProcessor::finished, [&](bool success, const QString &message) {
+        if (!quiet && lastProgress >= 0) {
+            fputc('\n', stderr);
+        }
+        fprintf(success ? stdout : stderr, "%s\n", qPrintable(message));
+        fflush(stdout);
+    });
+    
+    int failedCount = 0;
+    for (int i = 0; i < jobs.size(); i++) {
+        const Job &job = jobs.at(i);
+        if (jobs.size() > 1) {
+            fprintf(stdout, "[%d/%d] %s %s\n", i + 1, (int)jobs.size(), qPrintable(job.command), qPrintable(job.input));
+            fflush(stdout);
+        }
+        
+        lastProgress = -1;
+        if (!runJob(processor, job)) {
+            failedCount++;
+        }
+    }
+    
+    if (jobs.size() > 1) {
+        fprintf(stdout, "完成 %d 个任务，失败 %d 个\n", (int)jobs.size() - failedCount, failedCount);
+    }
+    
+    Trace::stop();
+    
+    return failedCount > 0 ? ExitJobFailed : ExitSuccess;
+}
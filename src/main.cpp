@@ -1,5 +1,6 @@
 #include <QApplication>
 #include "MainWindow.h"
+#include "Trace.h"
 
 int main(int argc, char *argv[])
 {
@@ -10,9 +11,14 @@ int main(int argc, char *argv[])
     QApplication::setApplicationVersion("1.0.0");
     QApplication::setOrganizationName("VideoEditor");
     
+    // VIDEOEDITOR_TRACE=文件路径 时记录各阶段耗时，退出时写出
+    Trace::startFromEnvironment();
+    
     // 创建并显示主窗口
     MainWindow mainWindow;
     mainWindow.show();
     
-    return app.exec();
+    int ret = app.exec();
+    Trace::stop();
+    return ret;
 }